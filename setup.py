@@ -13,6 +13,7 @@ libs = ["atomic"] if platform.machine() in need_latomic_arch else []
 ext = Extension(
     name="fastipc._primitives._primitives",
     sources=["src/fastipc/_primitives/_primitives.c"],
+    include_dirs=["src/fastipc/include"],
     define_macros=[("_GNU_SOURCE", "1")],
     extra_compile_args=[
         "-O3",
@@ -32,5 +33,6 @@ setup(
     ext_modules=[ext],
     package_dir={"": "src"},
     packages=find_packages(where="src"),
+    package_data={"fastipc": ["include/*.h"]},
     zip_safe=False,
 )
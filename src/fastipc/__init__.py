@@ -1,14 +1,26 @@
-from fastipc.utils import align_to_cacheline_size
+from fastipc.utils import align_to_cacheline_size, get_include
 from fastipc.guarded_shared_memory import GuardedSharedMemory
-from fastipc.sync import NamedEvent, NamedMutex, NamedSemaphore
+from fastipc.memfd_shared_memory import MemfdSharedMemory
+from fastipc.persistent_shared_memory import PersistentSharedMemory
+from fastipc.object_store import SharedObjectStore, SharedView
+from fastipc.rpc_channel import RpcChannel, RpcError
+from fastipc.sync import NamedEvent, NamedMutex, NamedRegistry, NamedSemaphore
 
 __all__ = [
     # Helper Functions
     "align_to_cacheline_size",
+    "get_include",
 
     # Battery-included Usages
     "GuardedSharedMemory",
+    "MemfdSharedMemory",
     "NamedEvent",
     "NamedMutex",
+    "NamedRegistry",
     "NamedSemaphore",
+    "PersistentSharedMemory",
+    "RpcChannel",
+    "RpcError",
+    "SharedObjectStore",
+    "SharedView",
 ]
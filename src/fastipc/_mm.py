@@ -0,0 +1,104 @@
+"""Best-effort memory placement helpers for shared mappings (Linux).
+
+Every helper returns True when the request took effect and False when the
+kernel, the build or the resource limits do not allow it; none of them raise
+for an unsupported option. ``start`` (a multiple of the page size) limits a
+helper to the mapping's tail, e.g. the part a grown segment added.
+"""
+
+import ctypes
+import mmap
+import platform
+from typing import Sequence, Union
+
+__all__ = ["advise_hugepages", "populate", "lock", "bind_numa"]
+
+_libc = ctypes.CDLL(None, use_errno=True)
+
+_libc.mlock.argtypes = [ctypes.c_void_p, ctypes.c_size_t]
+_libc.mlock.restype = ctypes.c_int
+
+_PAGE = mmap.PAGESIZE
+_MADV_HUGEPAGE = getattr(mmap, "MADV_HUGEPAGE", 14)
+_MADV_POPULATE_WRITE = getattr(mmap, "MADV_POPULATE_WRITE", 23)  # Linux 5.14+
+
+_SYS_MBIND = {"x86_64": 237, "aarch64": 235, "ppc64le": 259, "s390x": 268, "riscv64": 235}.get(
+    platform.machine()
+)
+_MPOL_BIND = 2
+_MPOL_INTERLEAVE = 3
+
+
+def _address(mm: mmap.mmap) -> int:
+    # The temporary ctypes export is dropped before returning, so mm can still be closed.
+    return ctypes.addressof(ctypes.c_char.from_buffer(mm))
+
+
+def _thp_shmem_enabled() -> bool:
+    try:
+        with open("/sys/kernel/mm/transparent_hugepage/shmem_enabled") as f:
+            mode = f.read()
+    except OSError:
+        return False
+    # The active mode is bracketed, e.g. "always within_size advise [never] deny force".
+    return "[never]" not in mode and "[deny]" not in mode
+
+
+def advise_hugepages(mm: mmap.mmap) -> bool:
+    """Ask for transparent huge pages on a shmem mapping (MADV_HUGEPAGE)."""
+    if not _thp_shmem_enabled():
+        return False
+    try:
+        mm.madvise(_MADV_HUGEPAGE)
+    except OSError:
+        return False
+    return True
+
+
+def populate(mm: mmap.mmap, start: int = 0) -> bool:
+    """Pre-fault every page of the mapping so first touches do not page-fault."""
+    if start >= len(mm):
+        return True
+    try:
+        mm.madvise(_MADV_POPULATE_WRITE, start, len(mm) - start)
+        return True
+    except OSError:
+        pass
+    # Older kernels: read one byte per page; the strided copy runs in C.
+    view = memoryview(mm)
+    try:
+        bytes(view[start::_PAGE])
+    finally:
+        view.release()
+    return True
+
+
+def lock(mm: mmap.mmap, start: int = 0) -> bool:
+    """mlock() the mapping; fails softly when RLIMIT_MEMLOCK is too small."""
+    if start >= len(mm):
+        return True
+    return _libc.mlock(_address(mm) + start, len(mm) - start) == 0
+
+
+def bind_numa(mm: mmap.mmap, nodes: Union[int, Sequence[int]], start: int = 0) -> bool:
+    """Bind the mapping to one NUMA node, or interleave it across several (mbind)."""
+    if _SYS_MBIND is None:
+        return False
+    node_list = [nodes] if isinstance(nodes, int) else list(nodes)
+    bits = 8 * ctypes.sizeof(ctypes.c_ulong)
+    mask = (ctypes.c_ulong * (max(node_list) // bits + 1))()
+    for n in node_list:
+        mask[n // bits] |= 1 << (n % bits)
+    mode = _MPOL_BIND if isinstance(nodes, int) else _MPOL_INTERLEAVE
+    if start >= len(mm):
+        return True
+    rc = _libc.syscall(
+        _SYS_MBIND,
+        ctypes.c_void_p(_address(mm) + start),
+        ctypes.c_ulong(len(mm) - start),
+        ctypes.c_int(mode),
+        mask,
+        ctypes.c_ulong(len(mask) * bits + 1),
+        ctypes.c_uint(0),
+    )
+    return rc == 0
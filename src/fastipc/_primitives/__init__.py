@@ -1,9 +1,20 @@
 from fastipc._primitives._primitives import (  # re-export
+    AtomicBitset,
     AtomicU32,
     AtomicU64,
+    BlockPool,
     FutexWord,
+    LeaseTable,
     Mutex,
+    Registry,
     Semaphore,
+    Sequencer,
+    ShardedCounter,
+    SharedHashMap,
+    SharedStruct,
+    StructLayout,
+    WorkStealingDeque,
+    _C_API,
 )
 
 __all__ = [
@@ -13,4 +24,14 @@ __all__ = [
     "AtomicU64",
     "Mutex",
     "Semaphore",
+    "ShardedCounter",
+    "Sequencer",
+    "LeaseTable",
+    "Registry",
+    "SharedHashMap",
+    "BlockPool",
+    "StructLayout",
+    "SharedStruct",
+    "WorkStealingDeque",
+    "AtomicBitset",
 ]
\ No newline at end of file
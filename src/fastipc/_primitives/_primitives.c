@@ -2,6 +2,7 @@
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE 1
 #endif
+#define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <linux/futex.h>
 #include <sys/syscall.h>
@@ -14,6 +15,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+
+#include "fastipc.h"
+#include "fastipc_capi.h"
+
+#if defined(__GLIBC__) && defined(__has_include)
+#if __has_include(<linux/rseq.h>)
+#include <linux/rseq.h>
+// glibc >= 2.35 registers an rseq area per thread; weak so older runtimes still load us.
+extern const ptrdiff_t __rseq_offset __attribute__((weak));
+extern const unsigned int __rseq_size __attribute__((weak));
+#if defined(__x86_64__) || defined(__aarch64__)
+#define FASTIPC_HAVE_RSEQ 1
+#endif
+#endif
+#endif
 
 #ifndef PyCFunction_CAST
 #define PyCFunction_CAST(func) ((PyCFunction)(void (*)(void))(func))
@@ -40,17 +59,33 @@ STATIC_ASSERT(__atomic_always_lock_free(8, 0), "64-bit atomics not lock-free on
 #define FASTIPC_TLS __thread
 #endif
 
-#if defined(__x86_64__) || defined(__i386__)
-#define CPU_RELAX() __asm__ __volatile__("pause")
-#elif defined(__aarch64__)
-#define CPU_RELAX() __asm__ __volatile__("yield")
+#if defined(Py_TPFLAGS_IMMUTABLETYPE)
+#define FASTIPC_TPFLAGS (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE)
 #else
-#define CPU_RELAX() \
-    do              \
-    {               \
-    } while (0)
+#define FASTIPC_TPFLAGS Py_TPFLAGS_DEFAULT
 #endif
 
+// Buffer-backed objects are immutable once initialized: a second __init__ racing with
+// GIL-free callers would swap the address they are using, so it is rejected.
+static int pin_owner(PyObject **slot, PyObject *buf_obj)
+{
+    PyObject *expected = NULL;
+    Py_INCREF(buf_obj);
+    if (!__atomic_compare_exchange_n(slot, &expected, buf_obj, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        Py_DECREF(buf_obj);
+        PyErr_SetString(PyExc_RuntimeError, "object is already initialized");
+        return -1;
+    }
+    return 0;
+}
+
+// True once `pid` names no live process. A recycled pid only makes callers wait longer.
+static inline int fipc_pid_gone(uint32_t pid)
+{
+    return pid != 0 && pid <= INT_MAX && kill((pid_t)pid, 0) != 0 && errno == ESRCH;
+}
+
 typedef struct
 {
     PyObject_HEAD uint32_t *uaddr;
@@ -76,10 +111,13 @@ static int FutexWord_init(FutexWord *self, PyObject *args, PyObject *kw)
         PyErr_SetString(PyExc_ValueError, "need 4-byte aligned >=4 buffer");
         return -1;
     }
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
     self->uaddr = (uint32_t *)view.buf;
     self->shared = shared ? 1 : 0;
-    self->owner = buf_obj;
-    Py_INCREF(self->owner);
     PyBuffer_Release(&view);
 
     return 0;
@@ -87,20 +125,10 @@ static int FutexWord_init(FutexWord *self, PyObject *args, PyObject *kw)
 
 static void FutexWord_dealloc(FutexWord *self)
 {
+    PyTypeObject *tp = Py_TYPE(self);
     Py_XDECREF(self->owner);
-    Py_TYPE(self)->tp_free((PyObject *)self);
-}
-
-static long futex_wait_sys(uint32_t *uaddr, uint32_t val, const struct timespec *ts, int shared)
-{
-    int op = shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
-    return syscall(SYS_futex, uaddr, op, val, ts, NULL, 0);
-}
-
-static long futex_wake_sys(uint32_t *uaddr, int n, int shared)
-{
-    int op = shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
-    return syscall(SYS_futex, uaddr, op, n, NULL, NULL, 0);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
 }
 
 static PyObject *FutexWord_wait(FutexWord *self, PyObject *args, PyObject *kw)
@@ -123,7 +151,7 @@ static PyObject *FutexWord_wait(FutexWord *self, PyObject *args, PyObject *kw)
     {
         int ret, err;
         Py_BEGIN_ALLOW_THREADS
-            ret = (int)futex_wait_sys(self->uaddr, expected, pts, self->shared);
+            ret = (int)fipc_futex_wait_sys(self->uaddr, expected, pts, self->shared);
         err = errno;
         Py_END_ALLOW_THREADS if (ret == 0) Py_RETURN_TRUE;
         if (err == EAGAIN)
@@ -151,7 +179,7 @@ static PyObject *FutexWord_wake(FutexWord *self, PyObject *args, PyObject *kw)
 
     int ret, err = 0;
     Py_BEGIN_ALLOW_THREADS
-        ret = (int)futex_wake_sys(self->uaddr, n, self->shared);
+        ret = (int)fipc_futex_wake_sys(self->uaddr, n, self->shared);
     err = errno;
     Py_END_ALLOW_THREADS
 
@@ -187,16 +215,19 @@ static PyObject *FutexWord_repr(PyObject *self)
     return PyUnicode_FromFormat("<fastipc.FutexWord addr=%p shared=%d>", (void *)s->uaddr, s->shared);
 }
 
-static PyTypeObject FutexWordType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-        .tp_name = "fastipc.FutexWord",
-    .tp_basicsize = sizeof(FutexWord),
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = PyType_GenericNew,
-    .tp_init = (initproc)FutexWord_init,
-    .tp_dealloc = (destructor)FutexWord_dealloc,
-    .tp_methods = FutexWord_methods,
-    .tp_repr = (reprfunc)FutexWord_repr,
+static PyType_Slot FutexWord_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)FutexWord_init},
+    {Py_tp_dealloc, (void *)FutexWord_dealloc},
+    {Py_tp_methods, FutexWord_methods},
+    {Py_tp_repr, (void *)FutexWord_repr},
+    {0, NULL}};
+
+static PyType_Spec FutexWord_spec = {
+    .name = "fastipc.FutexWord",
+    .basicsize = sizeof(FutexWord),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = FutexWord_type_slots,
 };
 
 static int check_aligned(void *buf, Py_ssize_t len, size_t sz, size_t align)
@@ -208,6 +239,22 @@ static int check_aligned(void *buf, Py_ssize_t len, size_t sz, size_t align)
     return 1;
 }
 
+// memoryview(owner)[start:start + len]: a zero-copy view that keeps the owner alive.
+static PyObject *owner_slice(PyObject *owner, Py_ssize_t start, Py_ssize_t len)
+{
+    PyObject *whole = PyMemoryView_FromObject(owner);
+    if (whole == NULL)
+        return NULL;
+    PyObject *lo = PyLong_FromSsize_t(start), *hi = PyLong_FromSsize_t(start + len);
+    PyObject *slice = (lo != NULL && hi != NULL) ? PySlice_New(lo, hi, NULL) : NULL;
+    PyObject *view = slice != NULL ? PyObject_GetItem(whole, slice) : NULL;
+    Py_XDECREF(slice);
+    Py_XDECREF(lo);
+    Py_XDECREF(hi);
+    Py_DECREF(whole);
+    return view;
+}
+
 // ---------- AtomicU32 ----------
 typedef struct
 {
@@ -240,17 +287,22 @@ static int AtomicU32_init(AtomicU32 *self, PyObject *args, PyObject *kw)
         return -1;
     }
 
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
     self->uaddr = (uint32_t *)view.buf;
-    self->owner = buf_obj;
-    Py_INCREF(self->owner);
     PyBuffer_Release(&view);
     return 0;
 }
 
 static void AtomicU32_dealloc(AtomicU32 *self)
 {
+    PyTypeObject *tp = Py_TYPE(self);
     Py_XDECREF(self->owner);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
 }
 
 static PyObject *AtomicU32_load(AtomicU32 *self, PyObject *Py_UNUSED(ignored))
@@ -316,16 +368,19 @@ static PyObject *AtomicU32_repr(PyObject *self)
     return PyUnicode_FromFormat("<fastipc.AtomicU32 addr=%p>", (void *)s->uaddr);
 }
 
-static PyTypeObject AtomicU32Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-        .tp_name = "fastipc.AtomicU32",
-    .tp_basicsize = sizeof(AtomicU32),
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = PyType_GenericNew,
-    .tp_init = (initproc)AtomicU32_init,
-    .tp_dealloc = (destructor)AtomicU32_dealloc,
-    .tp_methods = AtomicU32_methods,
-    .tp_repr = (reprfunc)AtomicU32_repr,
+static PyType_Slot AtomicU32_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)AtomicU32_init},
+    {Py_tp_dealloc, (void *)AtomicU32_dealloc},
+    {Py_tp_methods, AtomicU32_methods},
+    {Py_tp_repr, (void *)AtomicU32_repr},
+    {0, NULL}};
+
+static PyType_Spec AtomicU32_spec = {
+    .name = "fastipc.AtomicU32",
+    .basicsize = sizeof(AtomicU32),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = AtomicU32_type_slots,
 };
 
 // ---------- AtomicU64 ----------
@@ -360,17 +415,22 @@ static int AtomicU64_init(AtomicU64 *self, PyObject *args, PyObject *kw)
         return -1;
     }
 
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
     self->uaddr = (uint64_t *)view.buf;
-    self->owner = buf_obj;
-    Py_INCREF(self->owner);
     PyBuffer_Release(&view);
     return 0;
 }
 
 static void AtomicU64_dealloc(AtomicU64 *self)
 {
+    PyTypeObject *tp = Py_TYPE(self);
     Py_XDECREF(self->owner);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
 }
 
 static PyObject *AtomicU64_load(AtomicU64 *self, PyObject *Py_UNUSED(ignored))
@@ -418,85 +478,20 @@ static PyObject *AtomicU64_repr(PyObject *self)
     return PyUnicode_FromFormat("<fastipc.AtomicU64 addr=%p>", (void *)s->uaddr);
 }
 
-static PyTypeObject AtomicU64Type = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-        .tp_name = "fastipc.AtomicU64",
-    .tp_basicsize = sizeof(AtomicU64),
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = PyType_GenericNew,
-    .tp_init = (initproc)AtomicU64_init,
-    .tp_dealloc = (destructor)AtomicU64_dealloc,
-    .tp_methods = AtomicU64_methods,
-    .tp_repr = (reprfunc)AtomicU64_repr,
-};
-
-// 64B cacheline-aligned style headers for primitives
-// Layout (Mutex):
-//   0x00: u32 magic ('MUTX')
-//   0x04: u32 flags (reserved)
-//   0x08: u32 state (futex word; 0=unlocked,1=locked,2=contended)
-//   0x0C: u32 owner_pid (PID holding lock or 0)
-//   0x10: u64 last_acquired_ns (CLOCK_REALTIME in ns)
-//   0x18..0x3F: reserved
-#define MUTEX64_SIZE 64u
-#define MUTEX_MAGIC 0x4D555458u /* 'MUTX' */
-#define MUTEX_OFF_MAGIC 0u
-#define MUTEX_OFF_FLAGS 4u
-#define MUTEX_OFF_STATE 8u
-#define MUTEX_OFF_OWNER 12u
-#define MUTEX_OFF_LASTNS 16u
-
-// Layout (Semaphore):
-//   0x00: u32 magic ('SEMA')
-//   0x04: u32 flags (reserved)
-//   0x08: u32 count (futex word)
-//   0x0C: u32 last_pid (last successful waiter pid)
-//   0x10: u64 last_acquired_ns (CLOCK_REALTIME in ns)
-//   0x18..0x3F: reserved
-#define SEM64_SIZE 64u
-#define SEM_MAGIC 0x53454D41u /* 'SEMA' */
-#define SEM_OFF_MAGIC 0u
-#define SEM_OFF_FLAGS 4u
-#define SEM_OFF_COUNT 8u
-#define SEM_OFF_LASTPID 12u
-#define SEM_OFF_LASTNS 16u
-
-static inline uint64_t now_realtime_ns(void)
-{
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
-}
+static PyType_Slot AtomicU64_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)AtomicU64_init},
+    {Py_tp_dealloc, (void *)AtomicU64_dealloc},
+    {Py_tp_methods, AtomicU64_methods},
+    {Py_tp_repr, (void *)AtomicU64_repr},
+    {0, NULL}};
 
-static inline void u32_store_rel(void *base, size_t off, uint32_t v)
-{
-    atomic_store_explicit((_Atomic uint32_t *)((uint8_t *)base + off), v, memory_order_release);
-}
-static inline uint32_t u32_load_acq(void *base, size_t off)
-{
-    return atomic_load_explicit((_Atomic uint32_t *)((uint8_t *)base + off), memory_order_acquire);
-}
-static inline uint32_t u32_xchg_rel(void *base, size_t off, uint32_t v)
-{
-    return atomic_exchange_explicit((_Atomic uint32_t *)((uint8_t *)base + off), v, memory_order_release);
-}
-static inline bool u32_cas_acqrel(void *base, size_t off, uint32_t *expected, uint32_t desired)
-{
-    return atomic_compare_exchange_strong_explicit((_Atomic uint32_t *)((uint8_t *)base + off), expected, desired, memory_order_acq_rel, memory_order_acquire);
-}
-static inline void u64_store_rel_unaligned(void *base, size_t off, uint64_t v)
-{
-    // Store via memcpy to be safe on unaligned addresses
-    uint64_t tmp = v;
-    __atomic_store_n(&tmp, tmp, __ATOMIC_RELAXED); // no-op but placates -O0
-    memcpy((uint8_t *)base + off, &tmp, sizeof(tmp));
-}
-static inline uint64_t u64_load_acq_unaligned(void *base, size_t off)
-{
-    uint64_t v;
-    memcpy(&v, (uint8_t *)base + off, sizeof(v));
-    return v;
-}
+static PyType_Spec AtomicU64_spec = {
+    .name = "fastipc.AtomicU64",
+    .basicsize = sizeof(AtomicU64),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = AtomicU64_type_slots,
+};
 
 // Futex-based Mutex wrapper over 64B header
 typedef struct
@@ -516,134 +511,113 @@ static int FutexMutex_init(FutexMutex *self, PyObject *args, PyObject *kw)
     Py_buffer view;
     if (PyObject_GetBuffer(buf_obj, &view, PyBUF_SIMPLE) < 0)
         return -1;
-    if (view.len < (Py_ssize_t)MUTEX64_SIZE || ((uintptr_t)view.buf % 4) != 0)
+    if (view.len < (Py_ssize_t)FASTIPC_MUTEX_SIZE || ((uintptr_t)view.buf % 4) != 0)
     {
         PyBuffer_Release(&view);
         PyErr_SetString(PyExc_ValueError, "need 4-byte aligned >=64 buffer for Mutex");
         return -1;
     }
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
     self->base = (uint8_t *)view.buf;
     self->shared = shared ? 1 : 0;
-    self->owner = buf_obj;
-    Py_INCREF(self->owner);
-    // set magic and clear reserved fields (idempotent)
-    u32_store_rel(self->base, MUTEX_OFF_MAGIC, MUTEX_MAGIC);
+    // set magic (idempotent)
+    fipc_mutex_init(self->base);
     PyBuffer_Release(&view);
     return 0;
 }
 
 static void FutexMutex_dealloc(FutexMutex *self)
 {
+    PyTypeObject *tp = Py_TYPE(self);
     Py_XDECREF(self->owner);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
 }
 
-static PyObject *FutexMutex_release(FutexMutex *self, PyObject *Py_UNUSED(ignored))
+// Release the GIL around the futex wake only when a waiter flagged contention.
+static PyObject *mutex_unlock_result(FutexMutex *self, int force)
 {
-    // check owner pid and release only if we own the lock
-    if (u32_load_acq(self->base, MUTEX_OFF_OWNER) != (uint32_t)getpid())
+    int rc;
+    if (fipc_u32_load_acq(self->base, FASTIPC_MUTEX_OFF_STATE) == 2)
     {
-        PyErr_SetString(PyExc_RuntimeError, "cannot release a mutex not owned by this process");
-        return NULL;
+        Py_BEGIN_ALLOW_THREADS
+            rc = force ? fipc_mutex_force_release(self->base, self->shared) : fipc_mutex_release(self->base, self->shared);
+        Py_END_ALLOW_THREADS
     }
-
-    // Set state to 0; wake exactly one waiter only if we observed contended state (2)
-    uint32_t prev = u32_xchg_rel(self->base, MUTEX_OFF_STATE, 0);
-    // Clear owner
-    u32_store_rel(self->base, MUTEX_OFF_OWNER, 0);
-
-    if (prev == 2)
+    else
+        rc = force ? fipc_mutex_force_release(self->base, self->shared) : fipc_mutex_release(self->base, self->shared);
+    if (rc == -EPERM)
     {
-        int op_wake = self->shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
-        int ret;
-        Py_BEGIN_ALLOW_THREADS
-            ret = (int)syscall(SYS_futex, (uint32_t *)(self->base + MUTEX_OFF_STATE), op_wake, 1, NULL, NULL, 0);
-        Py_END_ALLOW_THREADS(void) ret;
+        PyErr_SetString(PyExc_RuntimeError, "cannot release a mutex not owned by this process");
+        return NULL;
     }
-    // If prev was 1, we transitioned 1->0 with no waiters: nothing to wake.
-    // If prev was 0, double-release: treat as no-op. (actually should not happen due to owner check above)
     Py_RETURN_NONE;
 }
 
+static PyObject *FutexMutex_release(FutexMutex *self, PyObject *Py_UNUSED(ignored))
+{
+    return mutex_unlock_result(self, 0);
+}
+
 static PyObject *FutexMutex_force_release(FutexMutex *self, PyObject *Py_UNUSED(ignored))
 {
     // Forcibly clear the lock to unlocked state; wake one waiter if needed
-    uint32_t prev = u32_xchg_rel(self->base, MUTEX_OFF_STATE, 0);
-
-    // Clear owner unconditionally
-    u32_store_rel(self->base, MUTEX_OFF_OWNER, 0);
-    if (prev == 2)
-    {
-        int op_wake = self->shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
-        int ret;
-        Py_BEGIN_ALLOW_THREADS
-            ret = (int)syscall(SYS_futex, (uint32_t *)(self->base + MUTEX_OFF_STATE), op_wake, 1, NULL, NULL, 0);
-        Py_END_ALLOW_THREADS(void) ret;
-    }
-    Py_RETURN_NONE;
+    return mutex_unlock_result(self, 1);
 }
 
 static PyObject *FutexMutex_owner_pid(FutexMutex *self, PyObject *Py_UNUSED(ignored))
 {
-    uint32_t v = u32_load_acq(self->base, MUTEX_OFF_OWNER);
+    uint32_t v = fipc_u32_load_acq(self->base, FASTIPC_MUTEX_OFF_OWNER);
     return PyLong_FromUnsignedLong(v);
 }
 static PyObject *FutexMutex_last_acquired_ns(FutexMutex *self, PyObject *Py_UNUSED(ignored))
 {
-    uint64_t v = u64_load_acq_unaligned(self->base, MUTEX_OFF_LASTNS);
+    uint64_t v = fipc_u64_load_unaligned(self->base, FASTIPC_MUTEX_OFF_LASTNS);
     return PyLong_FromUnsignedLongLong(v);
 }
 static PyObject *FutexMutex_magic(FutexMutex *self, PyObject *Py_UNUSED(ignored))
 {
-    uint32_t v = u32_load_acq(self->base, MUTEX_OFF_MAGIC);
+    uint32_t v = fipc_u32_load_acq(self->base, FASTIPC_MUTEX_OFF_MAGIC);
+    return PyLong_FromUnsignedLong(v);
+}
+static PyObject *FutexMutex_layout_version(FutexMutex *self, PyObject *Py_UNUSED(ignored))
+{
+    uint32_t v = fipc_u32_load_acq(self->base, FASTIPC_MUTEX_OFF_VERSION);
     return PyLong_FromUnsignedLong(v);
 }
 
 // Fast-path helpers to avoid vararg parsing overhead
 static PyObject *FutexMutex_try_acquire(FutexMutex *self, PyObject *Py_UNUSED(ignored))
 {
-    uint32_t expected = 0;
-    if (u32_cas_acqrel(self->base, MUTEX_OFF_STATE, &expected, 1))
-    {
-        u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-        u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
+    if (fipc_mutex_try_acquire(self->base) == 0)
         Py_RETURN_TRUE;
-    }
     Py_RETURN_FALSE;
 }
 
-static PyObject *FutexMutex_acquire_fast(FutexMutex *self, PyObject *Py_UNUSED(ignored))
+// Uncontended CAS with the GIL held; the spin/sleep path runs without it.
+static int mutex_lock(FutexMutex *self, long long timeout_ns, int spin)
 {
-    uint32_t expected = 0;
+    if (fipc_mutex_try_acquire(self->base) == 0)
+        return 0;
+    int rc;
+    Py_BEGIN_ALLOW_THREADS
+        rc = fipc_mutex_acquire_ns(self->base, self->shared, timeout_ns, spin);
+    Py_END_ALLOW_THREADS return rc;
+}
 
+static PyObject *FutexMutex_acquire_fast(FutexMutex *self, PyObject *Py_UNUSED(ignored))
+{
     // Check owner pid and raise if we already own the lock
-    if (u32_load_acq(self->base, MUTEX_OFF_OWNER) == (uint32_t)getpid())
+    if (fipc_u32_load_acq(self->base, FASTIPC_MUTEX_OFF_OWNER) == (uint32_t)getpid())
     {
         PyErr_SetString(PyExc_RuntimeError, "cannot re-acquire a mutex already owned by this process");
         return NULL;
     }
-
-    if (u32_cas_acqrel(self->base, MUTEX_OFF_STATE, &expected, 1))
-    {
-        u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-        u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
-        Py_RETURN_TRUE;
-    }
-
-    int op_wait = self->shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
-    for (;;)
-    {
-        uint32_t c = atomic_exchange_explicit((_Atomic uint32_t *)(self->base + MUTEX_OFF_STATE), 2, memory_order_acquire);
-        if (c == 0)
-            break;
-        int ret;
-        Py_BEGIN_ALLOW_THREADS
-            ret = (int)syscall(SYS_futex, (uint32_t *)(self->base + MUTEX_OFF_STATE), op_wait, 2, NULL, NULL, 0);
-        Py_END_ALLOW_THREADS(void) ret;
-    }
-    // We now hold the lock with state=2 (contended). Keep it 2 to preserve waiter flag.
-    u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-    u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
+    mutex_lock(self, -1, 0);
     Py_RETURN_TRUE;
 }
 
@@ -654,114 +628,15 @@ static PyObject *FutexMutex_acquire_ns(FutexMutex *self, PyObject *args, PyObjec
     int spin = 16;
     if (!PyArg_ParseTupleAndKeywords(args, kw, "|Li", kwlist, &timeout_ns, &spin))
         return NULL;
-
-    uint32_t expected = 0;
-    if (u32_cas_acqrel(self->base, MUTEX_OFF_STATE, &expected, 1))
-    {
-        u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-        u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
+    if (mutex_lock(self, timeout_ns, spin) == 0)
         Py_RETURN_TRUE;
-    }
-    // spin a bit
-    for (int i = 0; i < spin; i++)
-    {
-        uint32_t v = u32_load_acq(self->base, MUTEX_OFF_STATE);
-        if (v == 0)
-        {
-            uint32_t e2 = 0;
-            if (atomic_compare_exchange_weak_explicit((_Atomic uint32_t *)(self->base + MUTEX_OFF_STATE), &e2, 1, memory_order_acquire, memory_order_relaxed))
-            {
-                u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-                u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
-                Py_RETURN_TRUE;
-            }
-        }
-        CPU_RELAX();
-    }
-    if (timeout_ns == 0)
-        Py_RETURN_FALSE;
-
-    struct timespec ts, *pts = NULL;
-    if (timeout_ns > 0)
-    {
-        ts.tv_sec = timeout_ns / 1000000000LL;
-        ts.tv_nsec = timeout_ns % 1000000000LL;
-        pts = &ts;
-    }
-    int op_wait = self->shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
-    for (;;)
-    {
-        uint32_t c = atomic_exchange_explicit((_Atomic uint32_t *)(self->base + MUTEX_OFF_STATE), 2, memory_order_acquire);
-        if (c == 0)
-            break;
-        int ret, err;
-        Py_BEGIN_ALLOW_THREADS
-            ret = (int)syscall(SYS_futex, (uint32_t *)(self->base + MUTEX_OFF_STATE), op_wait, 2, pts, NULL, 0);
-        err = errno;
-        Py_END_ALLOW_THREADS if (ret == -1)
-        {
-            if (err == ETIMEDOUT)
-                Py_RETURN_FALSE;
-            if (err == EINTR)
-            {
-                if (pts != NULL)
-                    Py_RETURN_FALSE;
-                continue;
-            }
-        }
-        // otherwise, loop (spurious wake tolerated)
-    }
-    // Keep state=2 (contended) to ensure release will wake waiters.
-    u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-    u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
-    Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
 }
 
 static PyObject *FutexMutex_enter(FutexMutex *self, PyObject *Py_UNUSED(ignored))
 {
-    // Inline blocking acquire to avoid calling a METH_VARARGS function directly
-    uint32_t expected = 0;
-    if (u32_cas_acqrel(self->base, MUTEX_OFF_STATE, &expected, 1))
-    {
-        Py_INCREF(self);
-        u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-        u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
-        return (PyObject *)self;
-    }
     // small default spin before sleep
-    for (int i = 0; i < 16; i++)
-    {
-        uint32_t v = u32_load_acq(self->base, MUTEX_OFF_STATE);
-        if (v == 0)
-        {
-            uint32_t exp2 = 0;
-            if (atomic_compare_exchange_weak_explicit((_Atomic uint32_t *)(self->base + MUTEX_OFF_STATE), &exp2, 1, memory_order_acquire, memory_order_relaxed))
-            {
-                Py_INCREF(self);
-                u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-                u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
-                return (PyObject *)self;
-            }
-        }
-        CPU_RELAX();
-    }
-    int op_wait = self->shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
-    int c;
-    for (;;)
-    {
-        c = atomic_exchange_explicit((_Atomic uint32_t *)(self->base + MUTEX_OFF_STATE), 2, memory_order_acquire);
-        if (c == 0)
-            break;
-        int ret, err;
-        Py_BEGIN_ALLOW_THREADS
-            ret = (int)syscall(SYS_futex, (uint32_t *)(self->base + MUTEX_OFF_STATE), op_wait, 2, NULL, NULL, 0);
-        err = errno;
-        Py_END_ALLOW_THREADS(void) ret;
-        (void)err;
-    }
-    // Keep state=2 (contended) to ensure release will wake waiters.
-    u32_store_rel(self->base, MUTEX_OFF_OWNER, (uint32_t)getpid());
-    u64_store_rel_unaligned(self->base, MUTEX_OFF_LASTNS, now_realtime_ns());
+    mutex_lock(self, -1, 16);
     Py_INCREF(self);
     return (PyObject *)self;
 }
@@ -779,6 +654,7 @@ static PyMethodDef FutexMutex_methods[] = {
     {"owner_pid", (PyCFunction)FutexMutex_owner_pid, METH_NOARGS, "current owner PID or 0"},
     {"last_acquired_ns", (PyCFunction)FutexMutex_last_acquired_ns, METH_NOARGS, "last successful acquisition time (ns)"},
     {"magic", (PyCFunction)FutexMutex_magic, METH_NOARGS, "Get magic constant"},
+    {"layout_version", (PyCFunction)FutexMutex_layout_version, METH_NOARGS, "Get header layout version"},
     {"__enter__", (PyCFunction)FutexMutex_enter, METH_NOARGS, "ctx enter"},
     {"__exit__", (PyCFunction)FutexMutex_exit, METH_VARARGS, "ctx exit"},
     {NULL, NULL, 0, NULL}};
@@ -786,22 +662,25 @@ static PyMethodDef FutexMutex_methods[] = {
 static PyObject *FutexMutex_repr(PyObject *self)
 {
     FutexMutex *s = (FutexMutex *)self;
-    uint32_t owner = u32_load_acq(s->base, MUTEX_OFF_OWNER);
-    uint64_t ts = u64_load_acq_unaligned(s->base, MUTEX_OFF_LASTNS);
-    uint32_t st = u32_load_acq(s->base, MUTEX_OFF_STATE);
+    uint32_t owner = fipc_u32_load_acq(s->base, FASTIPC_MUTEX_OFF_OWNER);
+    uint64_t ts = fipc_u64_load_unaligned(s->base, FASTIPC_MUTEX_OFF_LASTNS);
+    uint32_t st = fipc_u32_load_acq(s->base, FASTIPC_MUTEX_OFF_STATE);
     return PyUnicode_FromFormat("<fastipc.Mutex buf=%p shared=%d state=%u owner=%u last_ns=%llu>", (void *)s->base, s->shared, (unsigned)st, (unsigned)owner, (unsigned long long)ts);
 }
 
-static PyTypeObject FutexMutexType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-        .tp_name = "fastipc.Mutex",
-    .tp_basicsize = sizeof(FutexMutex),
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = PyType_GenericNew,
-    .tp_init = (initproc)FutexMutex_init,
-    .tp_dealloc = (destructor)FutexMutex_dealloc,
-    .tp_methods = FutexMutex_methods,
-    .tp_repr = (reprfunc)FutexMutex_repr,
+static PyType_Slot FutexMutex_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)FutexMutex_init},
+    {Py_tp_dealloc, (void *)FutexMutex_dealloc},
+    {Py_tp_methods, FutexMutex_methods},
+    {Py_tp_repr, (void *)FutexMutex_repr},
+    {0, NULL}};
+
+static PyType_Spec FutexMutex_spec = {
+    .name = "fastipc.Mutex",
+    .basicsize = sizeof(FutexMutex),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = FutexMutex_type_slots,
 };
 
 // Futex-based counting semaphore with 64B header
@@ -823,18 +702,22 @@ static int FutexSemaphore_init(FutexSemaphore *self, PyObject *args, PyObject *k
     Py_buffer view;
     if (PyObject_GetBuffer(buf_obj, &view, PyBUF_SIMPLE) < 0)
         return -1;
-    if (view.len < (Py_ssize_t)SEM64_SIZE || ((uintptr_t)view.buf % 4) != 0)
+    if (view.len < (Py_ssize_t)FASTIPC_SEM_SIZE || ((uintptr_t)view.buf % 4) != 0)
     {
         PyBuffer_Release(&view);
         PyErr_SetString(PyExc_ValueError, "need 4-byte aligned >=64 buffer for Semaphore");
         return -1;
     }
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
     self->base = (uint8_t *)view.buf;
     self->shared = shared ? 1 : 0;
-    self->owner = buf_obj;
-    Py_INCREF(self->owner);
-    // Initialize magic and, if requested, initial count
-    u32_store_rel(self->base, SEM_OFF_MAGIC, SEM_MAGIC);
+    // Stamp magic/layout version and, if requested, the initial count
+    fipc_u32_store_rel(self->base, FASTIPC_SEM_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+    fipc_u32_store_rel(self->base, FASTIPC_SEM_OFF_MAGIC, FASTIPC_SEM_MAGIC);
     // Initialize only if an explicit initial value is provided (not None)
     if (init_obj && init_obj != Py_None)
     {
@@ -850,8 +733,7 @@ static int FutexSemaphore_init(FutexSemaphore *self, PyObject *args, PyObject *k
             PyErr_SetString(PyExc_OverflowError, "initial out of range for uint32");
             return -1;
         }
-        uint32_t init = (uint32_t)init_ul;
-        atomic_store_explicit((_Atomic uint32_t *)(self->base + SEM_OFF_COUNT), init, memory_order_release);
+        fipc_u32_store_rel(self->base, FASTIPC_SEM_OFF_COUNT, (uint32_t)init_ul);
     }
     PyBuffer_Release(&view);
     return 0;
@@ -859,51 +741,30 @@ static int FutexSemaphore_init(FutexSemaphore *self, PyObject *args, PyObject *k
 
 static void FutexSemaphore_dealloc(FutexSemaphore *self)
 {
+    PyTypeObject *tp = Py_TYPE(self);
     Py_XDECREF(self->owner);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
 }
 
-static int semaphore_add_tokens(FutexSemaphore *self, uint32_t add, uint32_t *prev_out)
+// Release the GIL around the post only when it may have to wake sleepers (count was 0).
+static PyObject *semaphore_post_result(FutexSemaphore *self, uint32_t add)
 {
-    _Atomic uint32_t *c = (_Atomic uint32_t *)(self->base + SEM_OFF_COUNT);
-    if (add == 0)
+    int rc;
+    if (fipc_u32_load_acq(self->base, FASTIPC_SEM_OFF_COUNT) == 0)
     {
-        if (prev_out)
-            *prev_out = atomic_load_explicit(c, memory_order_acquire);
-        return 0;
+        Py_BEGIN_ALLOW_THREADS
+            rc = fipc_semaphore_post(self->base, self->shared, add);
+        Py_END_ALLOW_THREADS
     }
-
-    for (;;)
+    else
+        rc = fipc_semaphore_post(self->base, self->shared, add);
+    if (rc == -EOVERFLOW)
     {
-        uint32_t cur = atomic_load_explicit(c, memory_order_acquire);
-        if (cur > UINT32_MAX - add)
-        {
-            PyErr_SetString(PyExc_OverflowError, "semaphore count overflow");
-            return -1;
-        }
-        if (atomic_compare_exchange_weak_explicit(c, &cur, cur + add, memory_order_release, memory_order_acquire))
-        {
-            if (prev_out)
-                *prev_out = cur;
-            return 0;
-        }
+        PyErr_SetString(PyExc_OverflowError, "semaphore count overflow");
+        return NULL;
     }
-}
-
-static void semaphore_wake_waiters(FutexSemaphore *self, uint32_t prev, uint32_t add)
-{
-    if (add == 0 || prev != 0)
-        return;
-
-    int wake_n = add > (uint32_t)INT_MAX ? INT_MAX : (int)add;
-    if (wake_n <= 0)
-        wake_n = INT_MAX;
-
-    int op_wake = self->shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
-    int ret;
-    Py_BEGIN_ALLOW_THREADS
-        ret = (int)syscall(SYS_futex, (uint32_t *)(self->base + SEM_OFF_COUNT), op_wake, wake_n, NULL, NULL, 0);
-    Py_END_ALLOW_THREADS(void) ret;
+    Py_RETURN_NONE;
 }
 
 static PyObject *FutexSemaphore_post(FutexSemaphore *self, PyObject *args, PyObject *kw)
@@ -917,21 +778,12 @@ static PyObject *FutexSemaphore_post(FutexSemaphore *self, PyObject *args, PyObj
         PyErr_SetString(PyExc_OverflowError, "semaphore increment out of range");
         return NULL;
     }
-    uint32_t add = (uint32_t)n_ull;
-    uint32_t prev = 0;
-    if (semaphore_add_tokens(self, add, &prev) < 0)
-        return NULL;
-    semaphore_wake_waiters(self, prev, add);
-    Py_RETURN_NONE;
+    return semaphore_post_result(self, (uint32_t)n_ull);
 }
 
 static PyObject *FutexSemaphore_post1(FutexSemaphore *self, PyObject *Py_UNUSED(ignored))
 {
-    uint32_t prev = 0;
-    if (semaphore_add_tokens(self, 1u, &prev) < 0)
-        return NULL;
-    semaphore_wake_waiters(self, prev, 1u);
-    Py_RETURN_NONE;
+    return semaphore_post_result(self, 1u);
 }
 
 static PyObject *FutexSemaphore_wait(FutexSemaphore *self, PyObject *args, PyObject *kw)
@@ -942,63 +794,40 @@ static PyObject *FutexSemaphore_wait(FutexSemaphore *self, PyObject *args, PyObj
     int spin = 16;
     if (!PyArg_ParseTupleAndKeywords(args, kw, "|pLi", kwlist, &blocking, &timeout_ns, &spin))
         return NULL;
-    _Atomic uint32_t *c = (_Atomic uint32_t *)(self->base + SEM_OFF_COUNT);
-    struct timespec ts, *pts = NULL;
-    if (timeout_ns >= 0)
-    {
-        ts.tv_sec = timeout_ns / 1000000000LL;
-        ts.tv_nsec = timeout_ns % 1000000000LL;
-        pts = &ts;
-    }
-    for (;;)
-    {
-        // spin attempts to acquire a token under light contention
-        for (int i = 0; i < spin; i++)
-        {
-            uint32_t v = atomic_load_explicit(c, memory_order_acquire);
-            if (v > 0)
-            {
-                uint32_t vv = v;
-                if (atomic_compare_exchange_weak_explicit(c, &vv, vv - 1, memory_order_acq_rel, memory_order_acquire))
-                {
-                    u32_store_rel(self->base, SEM_OFF_LASTPID, (uint32_t)getpid());
-                    u64_store_rel_unaligned(self->base, SEM_OFF_LASTNS, now_realtime_ns());
-                    Py_RETURN_TRUE;
-                }
-            }
-            CPU_RELAX();
-        }
-        if (!blocking)
-            Py_RETURN_FALSE;
-        int op_wait = self->shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
-        int ret, err;
-        Py_BEGIN_ALLOW_THREADS
-            ret = (int)syscall(SYS_futex, (uint32_t *)(self->base + SEM_OFF_COUNT), op_wait, 0, pts, NULL, 0);
-        err = errno;
-        Py_END_ALLOW_THREADS if (ret == -1 && err == ETIMEDOUT) Py_RETURN_FALSE;
-        // else loop (spurious wake-ups tolerated)
-    }
+    // Uncontended take with the GIL held; spin and sleep without it.
+    if (fipc_semaphore_try_take(self->base) == 0)
+        Py_RETURN_TRUE;
+    int rc;
+    Py_BEGIN_ALLOW_THREADS
+        rc = fipc_semaphore_wait(self->base, self->shared, blocking ? timeout_ns : 0, spin);
+    Py_END_ALLOW_THREADS if (rc == 0) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
 }
 
 static PyObject *FutexSemaphore_value(FutexSemaphore *self, PyObject *Py_UNUSED(ignored))
 {
-    uint32_t v = atomic_load_explicit((_Atomic uint32_t *)(self->base + SEM_OFF_COUNT), memory_order_acquire);
+    uint32_t v = fipc_u32_load_acq(self->base, FASTIPC_SEM_OFF_COUNT);
     return PyLong_FromUnsignedLong(v);
 }
 
 static PyObject *FutexSemaphore_last_acquired_ns(FutexSemaphore *self, PyObject *Py_UNUSED(ignored))
 {
-    uint64_t v = u64_load_acq_unaligned(self->base, SEM_OFF_LASTNS);
+    uint64_t v = fipc_u64_load_unaligned(self->base, FASTIPC_SEM_OFF_LASTNS);
     return PyLong_FromUnsignedLongLong(v);
 }
 static PyObject *FutexSemaphore_last_pid(FutexSemaphore *self, PyObject *Py_UNUSED(ignored))
 {
-    uint32_t v = u32_load_acq(self->base, SEM_OFF_LASTPID);
+    uint32_t v = fipc_u32_load_acq(self->base, FASTIPC_SEM_OFF_LASTPID);
     return PyLong_FromUnsignedLong(v);
 }
 static PyObject *FutexSemaphore_magic(FutexSemaphore *self, PyObject *Py_UNUSED(ignored))
 {
-    uint32_t v = u32_load_acq(self->base, SEM_OFF_MAGIC);
+    uint32_t v = fipc_u32_load_acq(self->base, FASTIPC_SEM_OFF_MAGIC);
+    return PyLong_FromUnsignedLong(v);
+}
+static PyObject *FutexSemaphore_layout_version(FutexSemaphore *self, PyObject *Py_UNUSED(ignored))
+{
+    uint32_t v = fipc_u32_load_acq(self->base, FASTIPC_SEM_OFF_VERSION);
     return PyLong_FromUnsignedLong(v);
 }
 
@@ -1010,66 +839,4411 @@ static PyMethodDef FutexSemaphore_methods[] = {
     {"last_acquired_ns", (PyCFunction)FutexSemaphore_last_acquired_ns, METH_NOARGS, "Get last successful wait time (ns)"},
     {"last_pid", (PyCFunction)FutexSemaphore_last_pid, METH_NOARGS, "Get last successful waiter PID"},
     {"magic", (PyCFunction)FutexSemaphore_magic, METH_NOARGS, "Get magic constant"},
+    {"layout_version", (PyCFunction)FutexSemaphore_layout_version, METH_NOARGS, "Get header layout version"},
     {NULL, NULL, 0, NULL}};
 
 static PyObject *FutexSemaphore_repr(PyObject *self)
 {
     FutexSemaphore *s = (FutexSemaphore *)self;
-    uint32_t v = atomic_load_explicit((_Atomic uint32_t *)(s->base + SEM_OFF_COUNT), memory_order_acquire);
-    uint32_t pid = u32_load_acq(s->base, SEM_OFF_LASTPID);
-    uint64_t ts = u64_load_acq_unaligned(s->base, SEM_OFF_LASTNS);
+    uint32_t v = fipc_u32_load_acq(s->base, FASTIPC_SEM_OFF_COUNT);
+    uint32_t pid = fipc_u32_load_acq(s->base, FASTIPC_SEM_OFF_LASTPID);
+    uint64_t ts = fipc_u64_load_unaligned(s->base, FASTIPC_SEM_OFF_LASTNS);
     return PyUnicode_FromFormat("<fastipc.Semaphore buf=%p shared=%d value=%u last_pid=%u last_ns=%llu>", (void *)s->base, s->shared, (unsigned)v, (unsigned)pid, (unsigned long long)ts);
 }
 
-static PyTypeObject FutexSemaphoreType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-        .tp_name = "fastipc.Semaphore",
-    .tp_basicsize = sizeof(FutexSemaphore),
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = PyType_GenericNew,
-    .tp_init = (initproc)FutexSemaphore_init,
-    .tp_dealloc = (destructor)FutexSemaphore_dealloc,
-    .tp_methods = FutexSemaphore_methods,
-    .tp_repr = (reprfunc)FutexSemaphore_repr,
-};
+static PyType_Slot FutexSemaphore_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)FutexSemaphore_init},
+    {Py_tp_dealloc, (void *)FutexSemaphore_dealloc},
+    {Py_tp_methods, FutexSemaphore_methods},
+    {Py_tp_repr, (void *)FutexSemaphore_repr},
+    {0, NULL}};
 
-static PyModuleDef futexmod = {
-    PyModuleDef_HEAD_INIT,
-    .m_name = "fastipc._primitives",
-    .m_doc = NULL,
-    .m_size = -1,
-    .m_methods = NULL,
-    .m_slots = NULL,
-    .m_traverse = NULL,
-    .m_clear = NULL,
-    .m_free = NULL,
+static PyType_Spec FutexSemaphore_spec = {
+    .name = "fastipc.Semaphore",
+    .basicsize = sizeof(FutexSemaphore),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = FutexSemaphore_type_slots,
 };
 
-PyMODINIT_FUNC PyInit__primitives(void)
+// ---------- ShardedCounter ----------
+// Layout: nslots u64 counters, one per `stride` bytes (default one cache line),
+// so writers on different CPUs never share a line.
+#define SHARDED_DEFAULT_STRIDE 64u
+
+#ifdef FASTIPC_HAVE_RSEQ
+static inline void *fastipc_thread_pointer(void)
 {
-    PyObject *m = PyModule_Create(&futexmod);
-    if (!m)
-        return NULL;
-    // Initialize adaptive flag from environment
-    if (PyType_Ready(&FutexWordType) < 0)
-        return NULL;
-    Py_INCREF(&FutexWordType);
-    PyModule_AddObject(m, "FutexWord", (PyObject *)&FutexWordType);
-    if (PyType_Ready(&AtomicU32Type) < 0)
-        return NULL;
-    Py_INCREF(&AtomicU32Type);
-    PyModule_AddObject(m, "AtomicU32", (PyObject *)&AtomicU32Type);
-    if (PyType_Ready(&AtomicU64Type) < 0)
-        return NULL;
-    Py_INCREF(&AtomicU64Type);
-    PyModule_AddObject(m, "AtomicU64", (PyObject *)&AtomicU64Type);
-    if (PyType_Ready(&FutexMutexType) < 0)
-        return NULL;
-    Py_INCREF(&FutexMutexType);
-    PyModule_AddObject(m, "Mutex", (PyObject *)&FutexMutexType);
-    if (PyType_Ready(&FutexSemaphoreType) < 0)
-        return NULL;
-    Py_INCREF(&FutexSemaphoreType);
-    PyModule_AddObject(m, "Semaphore", (PyObject *)&FutexSemaphoreType);
-    return m;
+    void *tp;
+#if defined(__x86_64__)
+    __asm__("mov %%fs:0, %0" : "=r"(tp));
+#else
+    __asm__("mrs %0, tpidr_el0" : "=r"(tp));
+#endif
+    return tp;
+}
+#endif
+
+static FASTIPC_TLS uint32_t fastipc_fallback_slot = UINT32_MAX;
+
+// Current CPU: rseq cpu_id (plain load) when glibc registered it, else vDSO sched_getcpu,
+// else a per-thread hash. Result is only a placement hint; writers still use atomic adds.
+static inline uint32_t fastipc_current_cpu(void)
+{
+#ifdef FASTIPC_HAVE_RSEQ
+    if (&__rseq_size != NULL && __rseq_size > 0)
+    {
+        const struct rseq *rs = (const struct rseq *)((uint8_t *)fastipc_thread_pointer() + __rseq_offset);
+        int32_t cpu = (int32_t)__atomic_load_n(&rs->cpu_id, __ATOMIC_RELAXED);
+        if (cpu >= 0)
+            return (uint32_t)cpu;
+    }
+#endif
+    int cpu = sched_getcpu();
+    if (cpu >= 0)
+        return (uint32_t)cpu;
+    if (fastipc_fallback_slot == UINT32_MAX)
+        fastipc_fallback_slot = (uint32_t)syscall(SYS_gettid) * 2654435761u;
+    return fastipc_fallback_slot;
+}
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    uint32_t nslots;
+    uint32_t stride;
+    PyObject *owner;
+} ShardedCounter;
+
+static int ShardedCounter_init(ShardedCounter *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "slots", "stride", NULL};
+    PyObject *buf_obj;
+    Py_ssize_t nslots = 0;
+    Py_ssize_t stride = SHARDED_DEFAULT_STRIDE;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|nn", kwlist, &buf_obj, &nslots, &stride))
+        return -1;
+    if (stride < 8 || (stride % 8) != 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "stride must be a positive multiple of 8");
+        return -1;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_SIMPLE) < 0)
+        return -1;
+    if (nslots <= 0)
+        nslots = view.len / stride;
+    if (nslots <= 0 || nslots > UINT32_MAX || !check_aligned(view.buf, view.len, (size_t)nslots * (size_t)stride, 8))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "need 8-byte aligned buffer of at least slots*stride bytes");
+        return -1;
+    }
+
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
+    self->base = (uint8_t *)view.buf;
+    self->nslots = (uint32_t)nslots;
+    self->stride = (uint32_t)stride;
+    PyBuffer_Release(&view);
+    return 0;
+}
+
+static void ShardedCounter_dealloc(ShardedCounter *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+static inline uint64_t *sharded_slot(ShardedCounter *self, uint32_t i)
+{
+    return (uint64_t *)(self->base + (size_t)i * self->stride);
+}
+
+static PyObject *ShardedCounter_add(ShardedCounter *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    unsigned long long n = 1;
+    if (nargs > 1)
+    {
+        PyErr_SetString(PyExc_TypeError, "add() takes at most 1 argument");
+        return NULL;
+    }
+    if (nargs == 1)
+    {
+        n = PyLong_AsUnsignedLongLong(args[0]);
+        if (n == (unsigned long long)-1 && PyErr_Occurred())
+            return NULL;
+    }
+    uint32_t slot = fastipc_current_cpu() % self->nslots;
+    // Slot is owned by this CPU in the common case; the RMW stays uncontended on its line.
+    __atomic_fetch_add(sharded_slot(self, slot), (uint64_t)n, __ATOMIC_RELAXED);
+    Py_RETURN_NONE;
+}
+
+static uint64_t sharded_sum(ShardedCounter *self, int order)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < self->nslots; i++)
+        total += __atomic_load_n(sharded_slot(self, i), order);
+    return total;
+}
+
+static PyObject *ShardedCounter_read_approx(ShardedCounter *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLongLong(sharded_sum(self, __ATOMIC_RELAXED));
+}
+
+#define SHARDED_EXACT_MAX_PASSES 64
+
+static PyObject *ShardedCounter_read_exact(ShardedCounter *self, PyObject *Py_UNUSED(ignored))
+{
+    // Rescan until two consecutive passes agree; exact once writers are quiesced. Under steady
+    // writers passes may never agree, so give up after a bounded number and return the last sum.
+    uint64_t cur;
+    Py_BEGIN_ALLOW_THREADS
+    uint64_t prev = sharded_sum(self, __ATOMIC_ACQUIRE);
+    for (int pass = 0;; pass++)
+    {
+        cur = sharded_sum(self, __ATOMIC_ACQUIRE);
+        if (cur == prev || pass >= SHARDED_EXACT_MAX_PASSES)
+            break;
+        prev = cur;
+        FASTIPC_CPU_RELAX();
+    }
+    Py_END_ALLOW_THREADS
+    return PyLong_FromUnsignedLongLong(cur);
+}
+
+static PyObject *ShardedCounter_reset(ShardedCounter *self, PyObject *Py_UNUSED(ignored))
+{
+    for (uint32_t i = 0; i < self->nslots; i++)
+        __atomic_store_n(sharded_slot(self, i), 0, __ATOMIC_RELEASE);
+    Py_RETURN_NONE;
+}
+
+static PyObject *ShardedCounter_slots(ShardedCounter *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(self->nslots);
+}
+
+static PyMethodDef ShardedCounter_methods[] = {
+    {"add", PyCFunction_CAST(ShardedCounter_add), METH_FASTCALL, "relaxed add to this CPU's slot"},
+    {"read_approx", (PyCFunction)ShardedCounter_read_approx, METH_NOARGS, "sum of all slots (relaxed)"},
+    {"read_exact", (PyCFunction)ShardedCounter_read_exact, METH_NOARGS, "stable sum of all slots (acquire)"},
+    {"reset", (PyCFunction)ShardedCounter_reset, METH_NOARGS, "zero all slots"},
+    {"slots", (PyCFunction)ShardedCounter_slots, METH_NOARGS, "number of slots"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *ShardedCounter_repr(PyObject *self)
+{
+    ShardedCounter *s = (ShardedCounter *)self;
+    return PyUnicode_FromFormat("<fastipc.ShardedCounter buf=%p slots=%u stride=%u value=%llu>", (void *)s->base, (unsigned)s->nslots, (unsigned)s->stride, (unsigned long long)sharded_sum(s, __ATOMIC_RELAXED));
+}
+
+static PyType_Slot ShardedCounter_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)ShardedCounter_init},
+    {Py_tp_dealloc, (void *)ShardedCounter_dealloc},
+    {Py_tp_methods, ShardedCounter_methods},
+    {Py_tp_repr, (void *)ShardedCounter_repr},
+    {0, NULL}};
+
+static PyType_Spec ShardedCounter_spec = {
+    .name = "fastipc.ShardedCounter",
+    .basicsize = sizeof(ShardedCounter),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = ShardedCounter_type_slots,
+};
+
+// ---------- Sequencer ----------
+// Layout (Sequencer):
+//   0x00: u32 magic ('SEQR')
+//   0x04: u32 nslots (waiter table capacity, fixed by whoever formats the header)
+//   0x08: u64 published sequence
+//   0x10: u32 overflow_waiters (waiters that found the table full)
+//   0x14: u32 overflow_gen (futex word for overflow waiters; bumped by every waking publish)
+//   0x18..0x3F: reserved
+//   0x40: waiter table, 16B per slot:
+//         +0x00 u64 target (0=free, SEQ_TARGET_WOKEN=claimed by publisher)
+//         +0x08 u32 gen (per-slot futex word)
+//         +0x0C u32 reserved
+#define SEQ_HDR_SIZE 64u
+#define SEQ_MAGIC 0x53455152u /* 'SEQR' */
+#define SEQ_OFF_MAGIC 0u
+#define SEQ_OFF_NSLOTS 4u
+#define SEQ_OFF_VALUE 8u
+#define SEQ_OFF_OVERFLOW 16u
+#define SEQ_OFF_OVERFLOW_GEN 20u
+#define SEQ_SLOT_SIZE 16u
+#define SEQ_SLOT_OFF_TARGET 0u
+#define SEQ_SLOT_OFF_GEN 8u
+#define SEQ_TARGET_WOKEN UINT64_MAX
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    uint32_t nslots;
+    int shared;
+    PyObject *owner;
+} Sequencer;
+
+static inline uint64_t *seq_value(uint8_t *base)
+{
+    return (uint64_t *)(base + SEQ_OFF_VALUE);
+}
+static inline uint64_t *seq_slot_target(uint8_t *base, uint32_t i)
+{
+    return (uint64_t *)(base + SEQ_HDR_SIZE + (size_t)i * SEQ_SLOT_SIZE + SEQ_SLOT_OFF_TARGET);
+}
+static inline uint32_t *seq_slot_gen(uint8_t *base, uint32_t i)
+{
+    return (uint32_t *)(base + SEQ_HDR_SIZE + (size_t)i * SEQ_SLOT_SIZE + SEQ_SLOT_OFF_GEN);
+}
+
+static int Sequencer_init(Sequencer *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "initial", "shared", NULL};
+    PyObject *buf_obj;
+    PyObject *init_obj = NULL;
+    int shared = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|Op", kwlist, &buf_obj, &init_obj, &shared))
+        return -1;
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_SIMPLE) < 0)
+        return -1;
+    if (!check_aligned(view.buf, view.len, SEQ_HDR_SIZE, 8))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "need 8-byte aligned >=64 buffer for Sequencer");
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)view.buf;
+    size_t nslots;
+    if (fipc_u32_load_acq(base, SEQ_OFF_MAGIC) == SEQ_MAGIC)
+    {
+        // Attach: every handle must agree on the table size the formatter chose.
+        nslots = fipc_u32_load_acq(base, SEQ_OFF_NSLOTS);
+        if ((size_t)view.len < SEQ_HDR_SIZE + nslots * SEQ_SLOT_SIZE)
+        {
+            PyBuffer_Release(&view);
+            PyErr_Format(PyExc_ValueError, "buffer too small for Sequencer with %zu waiter slots", nslots);
+            return -1;
+        }
+    }
+    else
+    {
+        nslots = ((size_t)view.len - SEQ_HDR_SIZE) / SEQ_SLOT_SIZE;
+        if (nslots > UINT32_MAX)
+            nslots = UINT32_MAX;
+        fipc_u32_store_rel(base, SEQ_OFF_NSLOTS, (uint32_t)nslots);
+        fipc_u32_store_rel(base, SEQ_OFF_MAGIC, SEQ_MAGIC);
+    }
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
+    self->base = base;
+    self->nslots = (uint32_t)nslots;
+    self->shared = shared ? 1 : 0;
+    // Initialize only if an explicit initial value is provided (not None)
+    if (init_obj && init_obj != Py_None)
+    {
+        unsigned long long init = PyLong_AsUnsignedLongLong(init_obj);
+        if (PyErr_Occurred())
+        {
+            PyBuffer_Release(&view);
+            return -1;
+        }
+        __atomic_store_n(seq_value(self->base), (uint64_t)init, __ATOMIC_RELEASE);
+    }
+    PyBuffer_Release(&view);
+    return 0;
+}
+
+static void Sequencer_dealloc(Sequencer *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+// Wait (without the GIL) until the published value reaches target.
+// Returns 1 when reached, 0 on timeout. timeout_ns < 0 means infinite.
+static int sequencer_wait_slow(uint8_t *base, uint32_t nslots, int shared, uint64_t target, long long timeout_ns, int spin)
+{
+    uint64_t *val = seq_value(base);
+    for (int i = 0; i < spin; i++)
+    {
+        if (__atomic_load_n(val, __ATOMIC_ACQUIRE) >= target)
+            return 1;
+        FASTIPC_CPU_RELAX();
+    }
+    if (timeout_ns == 0)
+        return __atomic_load_n(val, __ATOMIC_ACQUIRE) >= target;
+
+    uint64_t deadline = timeout_ns > 0 ? fipc_now_monotonic_ns() + (uint64_t)timeout_ns : 0;
+    struct timespec ts, *pts = NULL;
+    int op_wait = shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+
+    // Register our target in a free slot; the publisher wakes only slots it has reached.
+    uint32_t slot = UINT32_MAX;
+    if (nslots > 0 && target != SEQ_TARGET_WOKEN)
+    {
+        uint32_t start = ((uint32_t)syscall(SYS_gettid) * 2654435761u) % nslots;
+        for (uint32_t k = 0; k < nslots; k++)
+        {
+            uint32_t i = (start + k) % nslots;
+            uint64_t expected = 0;
+            if (__atomic_compare_exchange_n(seq_slot_target(base, i), &expected, target, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            {
+                slot = i;
+                break;
+            }
+        }
+    }
+
+    int reached = 0;
+    if (slot != UINT32_MAX)
+    {
+        uint32_t *gen = seq_slot_gen(base, slot);
+        for (;;)
+        {
+            uint32_t g = __atomic_load_n(gen, __ATOMIC_ACQUIRE);
+            // Pairs with the publisher's store-then-scan (SEQ_CST on both sides).
+            if (__atomic_load_n(val, __ATOMIC_SEQ_CST) >= target)
+            {
+                reached = 1;
+                break;
+            }
+            if (deadline)
+            {
+                if (!fipc_deadline_remaining(deadline, &ts))
+                    break;
+                pts = &ts;
+            }
+            syscall(SYS_futex, gen, op_wait, g, pts, NULL, 0);
+        }
+        __atomic_store_n(seq_slot_target(base, slot), 0, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        // Table full: fall back to the shared overflow generation, bumped by every waking publish.
+        uint32_t *overflow = (uint32_t *)(base + SEQ_OFF_OVERFLOW);
+        uint32_t *ogen = (uint32_t *)(base + SEQ_OFF_OVERFLOW_GEN);
+        __atomic_fetch_add(overflow, 1, __ATOMIC_SEQ_CST);
+        for (;;)
+        {
+            uint32_t g = __atomic_load_n(ogen, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(val, __ATOMIC_SEQ_CST) >= target)
+            {
+                reached = 1;
+                break;
+            }
+            if (deadline)
+            {
+                if (!fipc_deadline_remaining(deadline, &ts))
+                    break;
+                pts = &ts;
+            }
+            syscall(SYS_futex, ogen, op_wait, g, pts, NULL, 0);
+        }
+        __atomic_fetch_sub(overflow, 1, __ATOMIC_RELEASE);
+    }
+    if (!reached)
+        reached = __atomic_load_n(val, __ATOMIC_ACQUIRE) >= target;
+    return reached;
+}
+
+// Raise the published value to at least v. Returns the value now published.
+static inline uint64_t sequencer_advance(uint8_t *base, uint64_t v, int *advanced)
+{
+    uint64_t *val = seq_value(base);
+    uint64_t cur = __atomic_load_n(val, __ATOMIC_RELAXED);
+    *advanced = 0;
+    while (cur < v)
+    {
+        if (__atomic_compare_exchange_n(val, &cur, v, true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        {
+            *advanced = 1;
+            return v;
+        }
+    }
+    return cur;
+}
+
+static inline int sequencer_needs_wake(uint8_t *base, uint32_t nslots, uint64_t v)
+{
+    if (__atomic_load_n((uint32_t *)(base + SEQ_OFF_OVERFLOW), __ATOMIC_SEQ_CST) != 0)
+        return 1;
+    for (uint32_t i = 0; i < nslots; i++)
+    {
+        uint64_t t = __atomic_load_n(seq_slot_target(base, i), __ATOMIC_SEQ_CST);
+        if (t != 0 && t != SEQ_TARGET_WOKEN && t <= v)
+            return 1;
+    }
+    return 0;
+}
+
+// Wake every registered waiter whose target is <= v, plus all overflow waiters.
+static long sequencer_wake_reached(uint8_t *base, uint32_t nslots, int shared, uint64_t v)
+{
+    int op_wake = shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    long woken = 0;
+    for (uint32_t i = 0; i < nslots; i++)
+    {
+        uint64_t *tp = seq_slot_target(base, i);
+        uint64_t t = __atomic_load_n(tp, __ATOMIC_SEQ_CST);
+        if (t == 0 || t == SEQ_TARGET_WOKEN || t > v)
+            continue;
+        // Claim the wake so later publishes skip this slot until the waiter leaves.
+        if (!__atomic_compare_exchange_n(tp, &t, SEQ_TARGET_WOKEN, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            continue;
+        uint32_t *gen = seq_slot_gen(base, i);
+        __atomic_fetch_add(gen, 1, __ATOMIC_RELEASE);
+        long r = syscall(SYS_futex, gen, op_wake, 1, NULL, NULL, 0);
+        if (r > 0)
+            woken += r;
+    }
+    if (__atomic_load_n((uint32_t *)(base + SEQ_OFF_OVERFLOW), __ATOMIC_SEQ_CST) != 0)
+    {
+        uint32_t *ogen = (uint32_t *)(base + SEQ_OFF_OVERFLOW_GEN);
+        __atomic_fetch_add(ogen, 1, __ATOMIC_SEQ_CST);
+        long r = syscall(SYS_futex, ogen, op_wake, INT_MAX, NULL, NULL, 0);
+        if (r > 0)
+            woken += r;
+    }
+    return woken;
+}
+
+static PyObject *sequencer_publish_and_wake(Sequencer *self, uint64_t v)
+{
+    int advanced;
+    uint64_t cur = sequencer_advance(self->base, v, &advanced);
+    long woken = 0;
+    if (advanced && sequencer_needs_wake(self->base, self->nslots, cur))
+    {
+        Py_BEGIN_ALLOW_THREADS
+            woken = sequencer_wake_reached(self->base, self->nslots, self->shared, cur);
+        Py_END_ALLOW_THREADS
+    }
+    return PyLong_FromLong(woken);
+}
+
+static PyObject *Sequencer_publish(Sequencer *self, PyObject *args)
+{
+    unsigned long long v;
+    if (!PyArg_ParseTuple(args, "K", &v))
+        return NULL;
+    return sequencer_publish_and_wake(self, (uint64_t)v);
+}
+
+static PyObject *Sequencer_publish_range(Sequencer *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"first", "last", "timeout_ns", NULL};
+    unsigned long long first, last;
+    long long timeout_ns = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "KK|L", kwlist, &first, &last, &timeout_ns))
+        return NULL;
+    if (last < first)
+    {
+        PyErr_SetString(PyExc_ValueError, "last must be >= first");
+        return NULL;
+    }
+    // Ordered commit: the batch [first, last] becomes visible only after first-1 is published.
+    if (first > 0 && __atomic_load_n(seq_value(self->base), __ATOMIC_ACQUIRE) < first - 1)
+    {
+        int reached;
+        Py_BEGIN_ALLOW_THREADS
+            reached = sequencer_wait_slow(self->base, self->nslots, self->shared, first - 1, timeout_ns, 128);
+        Py_END_ALLOW_THREADS if (!reached) Py_RETURN_FALSE;
+    }
+    PyObject *woken = sequencer_publish_and_wake(self, (uint64_t)last);
+    if (woken == NULL)
+        return NULL;
+    Py_DECREF(woken);
+    Py_RETURN_TRUE;
+}
+
+static PyObject *Sequencer_wait_until(Sequencer *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"target", "timeout_ns", "spin", NULL};
+    unsigned long long target;
+    long long timeout_ns = -1;
+    int spin = 128;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "K|Li", kwlist, &target, &timeout_ns, &spin))
+        return NULL;
+    if (__atomic_load_n(seq_value(self->base), __ATOMIC_ACQUIRE) >= target)
+        Py_RETURN_TRUE;
+    int reached;
+    Py_BEGIN_ALLOW_THREADS
+        reached = sequencer_wait_slow(self->base, self->nslots, self->shared, (uint64_t)target, timeout_ns, spin);
+    Py_END_ALLOW_THREADS if (reached) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+static PyObject *Sequencer_value(Sequencer *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLongLong(__atomic_load_n(seq_value(self->base), __ATOMIC_ACQUIRE));
+}
+
+static PyObject *Sequencer_waiter_slots(Sequencer *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(self->nslots);
+}
+
+static PyObject *Sequencer_magic(Sequencer *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(fipc_u32_load_acq(self->base, SEQ_OFF_MAGIC));
+}
+
+static PyMethodDef Sequencer_methods[] = {
+    {"publish", (PyCFunction)Sequencer_publish, METH_VARARGS, "raise the published sequence and wake reached waiters"},
+    {"publish_range", PyCFunction_CAST(Sequencer_publish_range), METH_VARARGS | METH_KEYWORDS, "publish [first, last] once first-1 is published"},
+    {"wait_until", PyCFunction_CAST(Sequencer_wait_until), METH_VARARGS | METH_KEYWORDS, "wait until published >= target"},
+    {"value", (PyCFunction)Sequencer_value, METH_NOARGS, "Get published sequence"},
+    {"waiter_slots", (PyCFunction)Sequencer_waiter_slots, METH_NOARGS, "Get waiter table capacity"},
+    {"magic", (PyCFunction)Sequencer_magic, METH_NOARGS, "Get magic constant"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *Sequencer_repr(PyObject *self)
+{
+    Sequencer *s = (Sequencer *)self;
+    uint64_t v = __atomic_load_n(seq_value(s->base), __ATOMIC_ACQUIRE);
+    return PyUnicode_FromFormat("<fastipc.Sequencer buf=%p shared=%d value=%llu waiter_slots=%u>", (void *)s->base, s->shared, (unsigned long long)v, (unsigned)s->nslots);
+}
+
+static PyType_Slot Sequencer_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)Sequencer_init},
+    {Py_tp_dealloc, (void *)Sequencer_dealloc},
+    {Py_tp_methods, Sequencer_methods},
+    {Py_tp_repr, (void *)Sequencer_repr},
+    {0, NULL}};
+
+static PyType_Spec Sequencer_spec = {
+    .name = "fastipc.Sequencer",
+    .basicsize = sizeof(Sequencer),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = Sequencer_type_slots,
+};
+
+// ---------- LeaseTable ----------
+// Attachment bookkeeping for a shared segment, kept inside the segment itself.
+// Layout (LeaseTable):
+//   0x00: u32 magic ('LEAS')
+//   0x04: u32 layout version
+//   0x08: u32 nslots
+//   0x0C: u32 state (0=unformatted, 1=live, 2=retired: the last holder is tearing it down)
+//   0x10..0x3F: reserved (GuardedSharedMemory keeps its u32 resize generation at 0x10 and
+//               the u64 lease key of the closer retiring the segment at 0x18)
+//   0x40: u64 lease[nslots] (0=free, otherwise an opaque non-zero holder key)
+// claim() and retire() form a Dekker pair: a claimer publishes its lease then reads state, a
+// retirer publishes state then rescans the leases (both SEQ_CST), so they cannot both proceed.
+#define LEASE_MAGIC 0x4C454153u /* 'LEAS' */
+#define LEASE_OFF_VERSION 4u
+#define LEASE_OFF_NSLOTS 8u
+#define LEASE_OFF_STATE 12u
+#define LEASE_OFF_SLOTS 64u
+#define LEASE_STATE_LIVE 1u
+#define LEASE_STATE_RETIRED 2u
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    uint32_t nslots;
+    PyObject *owner;
+} LeaseTable;
+
+static inline uint64_t *lease_slot(LeaseTable *self, uint32_t i)
+{
+    return (uint64_t *)(self->base + LEASE_OFF_SLOTS) + i;
+}
+
+static inline uint32_t *lease_state(LeaseTable *self)
+{
+    return fipc_u32_at(self->base, LEASE_OFF_STATE);
+}
+
+static int LeaseTable_init(LeaseTable *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "slots", NULL};
+    PyObject *buf_obj;
+    Py_ssize_t nslots = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|n", kwlist, &buf_obj, &nslots))
+        return -1;
+    if (nslots < 0 || nslots > UINT32_MAX)
+    {
+        PyErr_SetString(PyExc_ValueError, "slots out of range");
+        return -1;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_SIMPLE) < 0)
+        return -1;
+    if (!check_aligned(view.buf, view.len, LEASE_OFF_SLOTS, 8))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "need 8-byte aligned >=64 buffer for LeaseTable");
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)view.buf;
+    // slots > 0 formats a fresh table; slots == 0 attaches to one formatted by someone else.
+    int format = nslots > 0;
+    if (!format)
+    {
+        if (fipc_u32_load_acq(base, LEASE_OFF_STATE) == 0 || fipc_header_check(base, LEASE_MAGIC) != 0)
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "buffer does not hold a formatted lease table");
+            return -1;
+        }
+        nslots = fipc_u32_load_acq(base, LEASE_OFF_NSLOTS);
+    }
+    if (nslots == 0 || (size_t)view.len < LEASE_OFF_SLOTS + (size_t)nslots * 8)
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer too small for lease table slots");
+        return -1;
+    }
+
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
+    self->base = base;
+    self->nslots = (uint32_t)nslots;
+    if (format)
+    {
+        memset(base + LEASE_OFF_SLOTS, 0, (size_t)nslots * 8);
+        fipc_u32_store_rel(base, LEASE_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+        fipc_u32_store_rel(base, LEASE_OFF_NSLOTS, (uint32_t)nslots);
+        fipc_u32_store_rel(base, 0, LEASE_MAGIC);
+        // Publishing state last makes the table visible to attachers only once complete.
+        fipc_u32_store_rel(base, LEASE_OFF_STATE, LEASE_STATE_LIVE);
+    }
+    PyBuffer_Release(&view);
+    return 0;
+}
+
+static void LeaseTable_dealloc(LeaseTable *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+static int lease_key_arg(PyObject *obj, uint64_t *key)
+{
+    unsigned long long v = PyLong_AsUnsignedLongLong(obj);
+    if (v == (unsigned long long)-1 && PyErr_Occurred())
+        return -1;
+    if (v == 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "lease key must be non-zero");
+        return -1;
+    }
+    *key = (uint64_t)v;
+    return 0;
+}
+
+static PyObject *LeaseTable_claim(LeaseTable *self, PyObject *arg)
+{
+    uint64_t key;
+    if (lease_key_arg(arg, &key) < 0)
+        return NULL;
+    // Start at a key-derived slot so concurrent attachers rarely collide on the same word.
+    uint32_t start = (uint32_t)(key % self->nslots);
+    for (uint32_t n = 0; n < self->nslots; n++)
+    {
+        uint32_t i = (start + n) % self->nslots;
+        uint64_t expected = 0;
+        if (__atomic_load_n(lease_slot(self, i), __ATOMIC_RELAXED) != 0)
+            continue;
+        if (!__atomic_compare_exchange_n(lease_slot(self, i), &expected, key, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            continue;
+        if (__atomic_load_n(lease_state(self), __ATOMIC_SEQ_CST) == LEASE_STATE_RETIRED)
+        {
+            __atomic_store_n(lease_slot(self, i), 0, __ATOMIC_RELEASE);
+            return PyLong_FromLong(-1);
+        }
+        return PyLong_FromUnsignedLong(i);
+    }
+    PyErr_SetString(PyExc_RuntimeError, "lease table is full");
+    return NULL;
+}
+
+static PyObject *LeaseTable_release(LeaseTable *self, PyObject *args)
+{
+    Py_ssize_t index;
+    PyObject *key_obj;
+    uint64_t key;
+    if (!PyArg_ParseTuple(args, "nO", &index, &key_obj) || lease_key_arg(key_obj, &key) < 0)
+        return NULL;
+    if (index < 0 || index >= (Py_ssize_t)self->nslots)
+    {
+        PyErr_SetString(PyExc_IndexError, "lease index out of range");
+        return NULL;
+    }
+    uint64_t expected = key;
+    bool ok = __atomic_compare_exchange_n(lease_slot(self, (uint32_t)index), &expected, 0, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    return PyBool_FromLong(ok);
+}
+
+static PyObject *LeaseTable_evict(LeaseTable *self, PyObject *arg)
+{
+    uint64_t key;
+    if (lease_key_arg(arg, &key) < 0)
+        return NULL;
+    long evicted = 0;
+    for (uint32_t i = 0; i < self->nslots; i++)
+    {
+        uint64_t expected = key;
+        if (__atomic_compare_exchange_n(lease_slot(self, i), &expected, 0, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            evicted++;
+    }
+    return PyLong_FromLong(evicted);
+}
+
+static PyObject *LeaseTable_holders(LeaseTable *self, PyObject *Py_UNUSED(ignored))
+{
+    PyObject *out = PyList_New(0);
+    if (out == NULL)
+        return NULL;
+    for (uint32_t i = 0; i < self->nslots; i++)
+    {
+        uint64_t k = __atomic_load_n(lease_slot(self, i), __ATOMIC_SEQ_CST);
+        if (k == 0)
+            continue;
+        PyObject *v = PyLong_FromUnsignedLongLong(k);
+        if (v == NULL || PyList_Append(out, v) < 0)
+        {
+            Py_XDECREF(v);
+            Py_DECREF(out);
+            return NULL;
+        }
+        Py_DECREF(v);
+    }
+    return out;
+}
+
+static uint32_t lease_count(LeaseTable *self)
+{
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < self->nslots; i++)
+        n += __atomic_load_n(lease_slot(self, i), __ATOMIC_SEQ_CST) != 0;
+    return n;
+}
+
+static PyObject *LeaseTable_count(LeaseTable *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(lease_count(self));
+}
+
+static PyObject *LeaseTable_retire(LeaseTable *self, PyObject *Py_UNUSED(ignored))
+{
+    uint32_t expected = LEASE_STATE_LIVE;
+    if (!__atomic_compare_exchange_n(lease_state(self), &expected, LEASE_STATE_RETIRED, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        Py_RETURN_FALSE;
+    if (lease_count(self) != 0)
+    {
+        // Someone claimed after our caller's scan: hand the table back to them.
+        __atomic_store_n(lease_state(self), LEASE_STATE_LIVE, __ATOMIC_SEQ_CST);
+        Py_RETURN_FALSE;
+    }
+    Py_RETURN_TRUE;
+}
+
+static PyObject *LeaseTable_state(LeaseTable *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(__atomic_load_n(lease_state(self), __ATOMIC_ACQUIRE));
+}
+
+static PyObject *LeaseTable_slots(LeaseTable *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(self->nslots);
+}
+
+static PyMethodDef LeaseTable_methods[] = {
+    {"claim", (PyCFunction)LeaseTable_claim, METH_O, "claim a free slot for key; returns its index, or -1 if retired"},
+    {"release", (PyCFunction)LeaseTable_release, METH_VARARGS, "release slot index if it still holds key"},
+    {"evict", (PyCFunction)LeaseTable_evict, METH_O, "clear every slot holding key; returns the number cleared"},
+    {"holders", (PyCFunction)LeaseTable_holders, METH_NOARGS, "snapshot of the non-zero lease keys"},
+    {"count", (PyCFunction)LeaseTable_count, METH_NOARGS, "number of held slots"},
+    {"retire", (PyCFunction)LeaseTable_retire, METH_NOARGS, "mark retired if no slot is held"},
+    {"state", (PyCFunction)LeaseTable_state, METH_NOARGS, "table state (1=live, 2=retired)"},
+    {"slots", (PyCFunction)LeaseTable_slots, METH_NOARGS, "number of slots"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *LeaseTable_repr(PyObject *self)
+{
+    LeaseTable *s = (LeaseTable *)self;
+    return PyUnicode_FromFormat("<fastipc.LeaseTable buf=%p slots=%u held=%u state=%u>", (void *)s->base, (unsigned)s->nslots, (unsigned)lease_count(s), (unsigned)__atomic_load_n(lease_state(s), __ATOMIC_ACQUIRE));
+}
+
+static PyType_Slot LeaseTable_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)LeaseTable_init},
+    {Py_tp_dealloc, (void *)LeaseTable_dealloc},
+    {Py_tp_methods, LeaseTable_methods},
+    {Py_tp_repr, (void *)LeaseTable_repr},
+    {0, NULL}};
+
+static PyType_Spec LeaseTable_spec = {
+    .name = "fastipc.LeaseTable",
+    .basicsize = sizeof(LeaseTable),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = LeaseTable_type_slots,
+};
+
+// ---------- Registry ----------
+// Name -> 64B slot directory so many small named primitives share one mapping.
+// Layout (Registry):
+//   0x00: u32 magic ('REGY')
+//   0x04: u32 layout version
+//   0x08: u32 nslots
+//   0x0C: u32 state (0=unformatted, 1=live)
+//   0x10: u32 entries in use
+//   0x14..0x3F: reserved
+//   0x40: entries, 128B each (open addressing, linear probing, never deleted):
+//     +0x00: u64 claim = creator pid << 32 | 32-bit hash (0=free; claimed by CAS, hash top
+//            bit always set). Waiters that find the creator dead CAS in their own pid and
+//            finish the entry themselves.
+//     +0x08: u32 state (futex; 0=claimed, 1=named, 2=ready: payload initialized)
+//     +0x0C: u32 name length
+//     +0x10: name bytes (up to 48, UTF-8)
+//     +0x40: 64B payload handed out to the primitive
+#define REGISTRY_MAGIC 0x52454759u /* 'REGY' */
+#define REGISTRY_OFF_VERSION 4u
+#define REGISTRY_OFF_NSLOTS 8u
+#define REGISTRY_OFF_STATE 12u
+#define REGISTRY_OFF_COUNT 16u
+#define REGISTRY_OFF_ENTRIES 64u
+#define REGISTRY_ENTRY_SIZE 128u
+#define REGISTRY_ENTRY_STATE 8u
+#define REGISTRY_ENTRY_NAMELEN 12u
+#define REGISTRY_ENTRY_NAME 16u
+#define REGISTRY_ENTRY_PAYLOAD 64u
+#define REGISTRY_NAME_MAX 48u
+#define REGISTRY_NAMED 1u
+#define REGISTRY_READY 2u
+#define REGISTRY_POLL_NS 50000000ull // how often a waiter checks that the creator is alive
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    uint32_t nslots;
+    int shared;
+    PyObject *owner;
+} Registry;
+
+static inline uint8_t *registry_entry(Registry *self, uint32_t i)
+{
+    return self->base + REGISTRY_OFF_ENTRIES + (size_t)i * REGISTRY_ENTRY_SIZE;
+}
+
+static inline size_t registry_required_size(size_t nslots)
+{
+    return REGISTRY_OFF_ENTRIES + nslots * REGISTRY_ENTRY_SIZE;
+}
+
+static int Registry_init(Registry *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "slots", "shared", NULL};
+    PyObject *buf_obj;
+    Py_ssize_t nslots = 0;
+    int shared = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|np", kwlist, &buf_obj, &nslots, &shared))
+        return -1;
+    if (nslots < 0 || nslots > UINT32_MAX)
+    {
+        PyErr_SetString(PyExc_ValueError, "slots out of range");
+        return -1;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_SIMPLE) < 0)
+        return -1;
+    if (!check_aligned(view.buf, view.len, REGISTRY_OFF_ENTRIES, 8))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "need 8-byte aligned >=64 buffer for Registry");
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)view.buf;
+    // slots > 0 formats a fresh registry; slots == 0 attaches to one formatted by someone else.
+    int format = nslots > 0;
+    if (!format)
+    {
+        if (fipc_u32_load_acq(base, REGISTRY_OFF_STATE) == 0 || fipc_header_check(base, REGISTRY_MAGIC) != 0)
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "buffer does not hold a formatted registry");
+            return -1;
+        }
+        nslots = fipc_u32_load_acq(base, REGISTRY_OFF_NSLOTS);
+    }
+    if (nslots == 0 || (size_t)view.len < registry_required_size((size_t)nslots))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer too small for registry slots");
+        return -1;
+    }
+
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
+    self->base = base;
+    self->nslots = (uint32_t)nslots;
+    self->shared = shared ? 1 : 0;
+    if (format)
+    {
+        memset(base + REGISTRY_OFF_ENTRIES, 0, (size_t)nslots * REGISTRY_ENTRY_SIZE);
+        fipc_u32_store_rel(base, REGISTRY_OFF_COUNT, 0);
+        fipc_u32_store_rel(base, REGISTRY_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+        fipc_u32_store_rel(base, REGISTRY_OFF_NSLOTS, (uint32_t)nslots);
+        fipc_u32_store_rel(base, 0, REGISTRY_MAGIC);
+        fipc_u32_store_rel(base, REGISTRY_OFF_STATE, 1);
+    }
+    PyBuffer_Release(&view);
+    return 0;
+}
+
+static void Registry_dealloc(Registry *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+static inline uint32_t registry_hash(const char *name, Py_ssize_t len)
+{
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for (Py_ssize_t i = 0; i < len; i++)
+    {
+        h ^= (uint8_t)name[i];
+        h *= 1099511628211ull;
+    }
+    return (uint32_t)(h ^ (h >> 32)) | 0x80000000u;
+}
+
+// Block (GIL released by the caller) until an entry's state reaches `want`. Returns 0,
+// -ETIMEDOUT, or -EOWNERDEAD once the process that claimed the entry is gone.
+static int registry_wait_state(uint8_t *e, uint32_t want, uint64_t deadline, int shared)
+{
+    uint32_t *state = fipc_u32_at(e, REGISTRY_ENTRY_STATE);
+    struct timespec ts;
+    for (int spin = 0;; spin++)
+    {
+        uint32_t cur = __atomic_load_n(state, __ATOMIC_ACQUIRE);
+        if (cur >= want)
+            return 0;
+        if (spin < 64)
+        {
+            FASTIPC_CPU_RELAX();
+            continue;
+        }
+        if (fipc_pid_gone((uint32_t)(__atomic_load_n((uint64_t *)e, __ATOMIC_ACQUIRE) >> 32)))
+            return -EOWNERDEAD;
+        // Sleep in slices so a creator that died without publishing is noticed.
+        uint64_t until = fipc_now_monotonic_ns() + REGISTRY_POLL_NS;
+        if (deadline && deadline < until)
+            until = deadline;
+        if (!fipc_deadline_remaining(until, &ts))
+            return -ETIMEDOUT;
+        fipc_futex_wait_sys(state, cur, &ts, shared);
+    }
+}
+
+static inline void registry_name_entry(Registry *self, uint8_t *e, const char *name, Py_ssize_t len)
+{
+    fipc_u32_store_rel(e, REGISTRY_ENTRY_NAMELEN, (uint32_t)len);
+    memcpy(e + REGISTRY_ENTRY_NAME, name, (size_t)len);
+    __atomic_store_n(fipc_u32_at(e, REGISTRY_ENTRY_STATE), REGISTRY_NAMED, __ATOMIC_RELEASE);
+    fipc_futex_wake_sys(fipc_u32_at(e, REGISTRY_ENTRY_STATE), INT_MAX, self->shared);
+}
+
+// Find `name`, claiming a free entry for it when `create` is set. Returns the entry index,
+// -ENOENT (not found and !create), -ENOSPC or -ETIMEDOUT; *created tells a claim from a hit.
+// A creator that died before publishing hands its entry to the next get_or_create, which
+// then reports it as created and runs init again. Runs without the GIL.
+static int64_t registry_find(Registry *self, const char *name, Py_ssize_t len, int create, uint64_t deadline, int *created)
+{
+    uint32_t h = registry_hash(name, len);
+    uint64_t mine = ((uint64_t)(uint32_t)getpid() << 32) | h;
+    *created = 0;
+    for (uint32_t n = 0; n < self->nslots; n++)
+    {
+        uint32_t i = (uint32_t)(((uint64_t)h + n) % self->nslots);
+        uint8_t *e = registry_entry(self, i);
+        uint64_t *hp = (uint64_t *)e;
+        uint64_t k = __atomic_load_n(hp, __ATOMIC_ACQUIRE);
+        if (k == 0)
+        {
+            if (!create)
+                return -ENOENT;
+            uint64_t expected = 0;
+            if (__atomic_compare_exchange_n(hp, &expected, mine, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                __atomic_fetch_add(fipc_u32_at(self->base, REGISTRY_OFF_COUNT), 1, __ATOMIC_RELAXED);
+                registry_name_entry(self, e, name, len);
+                *created = 1;
+                return i;
+            }
+            k = expected; // lost the race: the winner's hash decides whether this is our name
+        }
+        for (;;)
+        {
+            if ((uint32_t)k != h)
+                break;
+            int rc = registry_wait_state(e, REGISTRY_NAMED, deadline, self->shared);
+            if (rc == -ETIMEDOUT)
+                return rc;
+            int named = rc == 0;
+            if (named && (fipc_u32_load_acq(e, REGISTRY_ENTRY_NAMELEN) != (uint32_t)len || memcmp(e + REGISTRY_ENTRY_NAME, name, (size_t)len) != 0))
+                break;
+            if (named && (rc = registry_wait_state(e, REGISTRY_READY, deadline, self->shared)) == 0)
+                return i;
+            if (rc == -ETIMEDOUT)
+                return rc;
+            // The creator died before naming (the entry may have been someone else's name with
+            // the same hash) or before publishing ours. get_or_create takes it over.
+            if (!create)
+            {
+                if (named)
+                    return -ENOENT;
+                break;
+            }
+            if (__atomic_compare_exchange_n(hp, &k, mine, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                if (!named)
+                    registry_name_entry(self, e, name, len);
+                *created = 1;
+                return i;
+            }
+            // Another waiter took it over first; wait on the new creator.
+        }
+    }
+    return create ? -ENOSPC : -ENOENT;
+}
+
+static PyObject *registry_lookup_impl(Registry *self, PyObject *args, PyObject *kw, int create)
+{
+    static char *kwlist[] = {"name", "timeout_ns", NULL};
+    const char *name;
+    Py_ssize_t len;
+    long long timeout_ns = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "s#|L", kwlist, &name, &len, &timeout_ns))
+        return NULL;
+    if (len == 0 || len > (Py_ssize_t)REGISTRY_NAME_MAX)
+    {
+        PyErr_Format(PyExc_ValueError, "registry names must be 1..%u bytes of UTF-8", REGISTRY_NAME_MAX);
+        return NULL;
+    }
+    uint64_t deadline = timeout_ns >= 0 ? fipc_now_monotonic_ns() + (uint64_t)timeout_ns : 0;
+    int created;
+    int64_t rc;
+    Py_BEGIN_ALLOW_THREADS
+        rc = registry_find(self, name, len, create, deadline, &created);
+    Py_END_ALLOW_THREADS if (rc == -ENOSPC)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "registry is full");
+        return NULL;
+    }
+    if (rc == -ETIMEDOUT)
+    {
+        PyErr_SetString(PyExc_TimeoutError, "registry entry is still being initialized");
+        return NULL;
+    }
+    long long offset = rc < 0 ? -1 : (long long)(REGISTRY_OFF_ENTRIES + (size_t)rc * REGISTRY_ENTRY_SIZE + REGISTRY_ENTRY_PAYLOAD);
+    if (!create)
+        return PyLong_FromLongLong(offset);
+    return Py_BuildValue("(LO)", offset, created ? Py_True : Py_False);
+}
+
+static PyObject *Registry_get_or_create(Registry *self, PyObject *args, PyObject *kw)
+{
+    return registry_lookup_impl(self, args, kw, 1);
+}
+
+static PyObject *Registry_lookup(Registry *self, PyObject *args, PyObject *kw)
+{
+    return registry_lookup_impl(self, args, kw, 0);
+}
+
+static PyObject *Registry_publish(Registry *self, PyObject *arg)
+{
+    Py_ssize_t offset = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+    if (offset == -1 && PyErr_Occurred())
+        return NULL;
+    Py_ssize_t rel = offset - (Py_ssize_t)(REGISTRY_OFF_ENTRIES + REGISTRY_ENTRY_PAYLOAD);
+    if (rel < 0 || rel % REGISTRY_ENTRY_SIZE != 0 || rel / REGISTRY_ENTRY_SIZE >= (Py_ssize_t)self->nslots)
+    {
+        PyErr_SetString(PyExc_ValueError, "not a registry payload offset");
+        return NULL;
+    }
+    uint32_t *state = fipc_u32_at(registry_entry(self, (uint32_t)(rel / REGISTRY_ENTRY_SIZE)), REGISTRY_ENTRY_STATE);
+    __atomic_store_n(state, REGISTRY_READY, __ATOMIC_RELEASE);
+    fipc_futex_wake_sys(state, INT_MAX, self->shared);
+    Py_RETURN_NONE;
+}
+
+static PyObject *Registry_count(Registry *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(fipc_u32_load_acq(self->base, REGISTRY_OFF_COUNT));
+}
+
+static PyObject *Registry_slots(Registry *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(self->nslots);
+}
+
+static PyObject *Registry_required_size(PyObject *Py_UNUSED(cls), PyObject *arg)
+{
+    Py_ssize_t nslots = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+    if (nslots == -1 && PyErr_Occurred())
+        return NULL;
+    if (nslots <= 0 || nslots > UINT32_MAX)
+    {
+        PyErr_SetString(PyExc_ValueError, "slots out of range");
+        return NULL;
+    }
+    return PyLong_FromSize_t(registry_required_size((size_t)nslots));
+}
+
+static PyMethodDef Registry_methods[] = {
+    {"get_or_create", PyCFunction_CAST(Registry_get_or_create), METH_VARARGS | METH_KEYWORDS, "(offset, created) of the payload for name; creators must publish()"},
+    {"lookup", PyCFunction_CAST(Registry_lookup), METH_VARARGS | METH_KEYWORDS, "payload offset for name, or -1"},
+    {"publish", (PyCFunction)Registry_publish, METH_O, "mark a created payload initialized and wake lookups"},
+    {"count", (PyCFunction)Registry_count, METH_NOARGS, "number of registered names"},
+    {"slots", (PyCFunction)Registry_slots, METH_NOARGS, "number of entries"},
+    {"required_size", (PyCFunction)Registry_required_size, METH_O | METH_STATIC, "buffer bytes needed for slots entries"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *Registry_repr(PyObject *self)
+{
+    Registry *s = (Registry *)self;
+    return PyUnicode_FromFormat("<fastipc.Registry buf=%p slots=%u names=%u>", (void *)s->base, (unsigned)s->nslots, (unsigned)fipc_u32_load_acq(s->base, REGISTRY_OFF_COUNT));
+}
+
+static PyType_Slot Registry_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)Registry_init},
+    {Py_tp_dealloc, (void *)Registry_dealloc},
+    {Py_tp_methods, Registry_methods},
+    {Py_tp_repr, (void *)Registry_repr},
+    {0, NULL}};
+
+static PyType_Spec Registry_spec = {
+    .name = "fastipc.Registry",
+    .basicsize = sizeof(Registry),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = Registry_type_slots,
+};
+
+// ---------- SharedHashMap ----------
+// Fixed-size key -> fixed-size value table; readers never write shared memory.
+// Layout (SharedHashMap):
+//   0x00: u32 magic ('HMAP')
+//   0x04: u32 layout version
+//   0x08: u32 capacity (buckets, a power of two)
+//   0x0C: u32 state (0=unformatted, 1=live)
+//   0x10: u32 key size
+//   0x14: u32 value size
+//   0x18: u32 live entries
+//   0x1C: u32 tombstones
+//   0x20..0x3F: reserved
+//   0x40: buckets, each round_up(8 + key + value, 8) bytes:
+//     +0x00: u64 meta: bits 0-1 state (0=empty, 1=busy, 2=full, 3=tombstone),
+//            bits 2-3 the state a busy bucket came from, bits 4-31 version,
+//            bits 32-63 the writer's pid while busy (0 otherwise)
+//     +0x08: key bytes, then value bytes
+// Linear probing. The meta word is a seqlock over key and value: writers CAS it to BUSY
+// (version + 1), write, then release-store FULL or TOMB (version + 2), and readers compare
+// keys and copy values without locks, re-checking meta afterwards. All writes are
+// lock-free. Storing a key that is not live CAS-claims the first tombstone or empty bucket
+// on the probe path, so deleting and inserting fresh keys never runs the table out of
+// buckets; it then scans the path for a copy of the key stored concurrently, and of two
+// copies the one nearer the home bucket survives (see hmap_insert). Tombstones keep their
+// key bytes, so searches go on past them until an empty bucket. If a writer dies while
+// BUSY its bucket is retired as a tombstone (the value may be torn).
+#define HMAP_MAGIC 0x484D4150u /* 'HMAP' */
+#define HMAP_OFF_VERSION 4u
+#define HMAP_OFF_CAPACITY 8u
+#define HMAP_OFF_STATE 12u
+#define HMAP_OFF_KEYSIZE 16u
+#define HMAP_OFF_VALUESIZE 20u
+#define HMAP_OFF_COUNT 24u
+#define HMAP_OFF_TOMBSTONES 28u
+#define HMAP_OFF_BUCKETS 64u
+#define HMAP_EMPTY 0u
+#define HMAP_BUSY 1u
+#define HMAP_FULL 2u
+#define HMAP_TOMB 3u
+#define HMAP_VER_MASK 0x0FFFFFFFu
+#define HMAP_KEY_MAX 1024u
+#define HMAP_VALUE_MAX 65536u
+#define HMAP_CAPACITY_MAX (1u << 31)
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    uint32_t capacity;
+    uint32_t key_size;
+    uint32_t value_size;
+    uint32_t stride;
+    PyObject *owner;
+} SharedHashMap;
+
+static inline size_t hmap_stride(size_t key_size, size_t value_size)
+{
+    return (8 + key_size + value_size + 7) & ~(size_t)7;
+}
+
+static inline size_t hmap_required_size(size_t key_size, size_t value_size, size_t capacity)
+{
+    return HMAP_OFF_BUCKETS + capacity * hmap_stride(key_size, value_size);
+}
+
+static inline uint32_t hmap_round_capacity(Py_ssize_t n)
+{
+    uint32_t c = 1;
+    while (c < (uint64_t)n)
+        c <<= 1;
+    return c;
+}
+
+static inline uint8_t *hmap_bucket(SharedHashMap *self, uint32_t i)
+{
+    return self->base + HMAP_OFF_BUCKETS + (size_t)i * self->stride;
+}
+
+static inline uint64_t hmap_meta(uint32_t ver, uint32_t st)
+{
+    return ((uint64_t)(ver & HMAP_VER_MASK) << 4) | st;
+}
+
+static inline uint64_t hmap_meta_busy(uint32_t ver, uint32_t prev, uint32_t pid)
+{
+    return ((uint64_t)pid << 32) | hmap_meta(ver, HMAP_BUSY) | ((uint64_t)prev << 2);
+}
+
+static inline uint32_t hmap_ver(uint64_t m)
+{
+    return (uint32_t)(m >> 4) & HMAP_VER_MASK;
+}
+
+static inline uint64_t hmap_hash(const uint8_t *key, uint32_t len)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, key + i, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, key + i, len - i);
+    h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 29);
+}
+
+// Spin briefly, then yield. Returns -EAGAIN instead of yielding when `block` is 0, so
+// callers holding the GIL can retry without it. Every 256 yields it checks `pid`; returns
+// 1 once that process is gone.
+static inline int hmap_backoff(int *spins, int block, uint32_t pid)
+{
+    if (++*spins < 128)
+    {
+        FASTIPC_CPU_RELAX();
+        return 0;
+    }
+    if (!block)
+        return -EAGAIN;
+    if ((*spins & 255) == 0 && fipc_pid_gone(pid))
+        return 1;
+    sched_yield();
+    return 0;
+}
+
+// Wait out a BUSY bucket (meta `m`); a bucket whose writer died is retired as a tombstone.
+// Returns 0 when the caller should re-read the bucket, or -EAGAIN.
+static int hmap_wait_busy(SharedHashMap *self, uint64_t *meta, uint64_t m, int *spins, int block)
+{
+    int rc = hmap_backoff(spins, block, (uint32_t)(m >> 32));
+    if (rc <= 0)
+        return rc;
+    uint32_t prev = (uint32_t)(m >> 2) & 3;
+    if (__atomic_compare_exchange_n(meta, &m, hmap_meta(hmap_ver(m) + 1, HMAP_TOMB), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        if (prev == HMAP_FULL)
+            __atomic_fetch_sub(fipc_u32_at(self->base, HMAP_OFF_COUNT), 1, __ATOMIC_RELAXED);
+        if (prev != HMAP_TOMB)
+            __atomic_fetch_add(fipc_u32_at(self->base, HMAP_OFF_TOMBSTONES), 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+static int SharedHashMap_init(SharedHashMap *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "key_size", "value_size", "capacity", NULL};
+    PyObject *buf_obj;
+    Py_ssize_t key_size = 0, value_size = 0, capacity = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|nnn", kwlist, &buf_obj, &key_size, &value_size, &capacity))
+        return -1;
+    // capacity > 0 formats a fresh map; capacity == 0 attaches to one formatted by someone else.
+    int format = capacity > 0;
+    if (format && (key_size <= 0 || key_size > HMAP_KEY_MAX || value_size < 0 || value_size > HMAP_VALUE_MAX || capacity > HMAP_CAPACITY_MAX))
+    {
+        PyErr_Format(PyExc_ValueError, "need 1 <= key_size <= %u, 0 <= value_size <= %u and capacity <= 2**31",
+                     HMAP_KEY_MAX, HMAP_VALUE_MAX);
+        return -1;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_WRITABLE) < 0)
+        return -1;
+    if (!check_aligned(view.buf, view.len, HMAP_OFF_BUCKETS, 8))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "need 8-byte aligned >=64 buffer for SharedHashMap");
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)view.buf;
+    if (format)
+        capacity = hmap_round_capacity(capacity);
+    else
+    {
+        if (fipc_u32_load_acq(base, HMAP_OFF_STATE) == 0 || fipc_header_check(base, HMAP_MAGIC) != 0)
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "buffer does not hold a formatted SharedHashMap");
+            return -1;
+        }
+        capacity = fipc_u32_load_acq(base, HMAP_OFF_CAPACITY);
+        key_size = fipc_u32_load_acq(base, HMAP_OFF_KEYSIZE);
+        value_size = fipc_u32_load_acq(base, HMAP_OFF_VALUESIZE);
+    }
+    if ((size_t)view.len < hmap_required_size((size_t)key_size, (size_t)value_size, (size_t)capacity))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer too small for SharedHashMap capacity");
+        return -1;
+    }
+
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
+    self->base = base;
+    self->capacity = (uint32_t)capacity;
+    self->key_size = (uint32_t)key_size;
+    self->value_size = (uint32_t)value_size;
+    self->stride = (uint32_t)hmap_stride((size_t)key_size, (size_t)value_size);
+    if (format)
+    {
+        memset(base + HMAP_OFF_BUCKETS, 0, (size_t)capacity * self->stride);
+        fipc_u32_store_rel(base, HMAP_OFF_COUNT, 0);
+        fipc_u32_store_rel(base, HMAP_OFF_TOMBSTONES, 0);
+        fipc_u32_store_rel(base, HMAP_OFF_KEYSIZE, (uint32_t)key_size);
+        fipc_u32_store_rel(base, HMAP_OFF_VALUESIZE, (uint32_t)value_size);
+        fipc_u32_store_rel(base, HMAP_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+        fipc_u32_store_rel(base, HMAP_OFF_CAPACITY, (uint32_t)capacity);
+        fipc_u32_store_rel(base, 0, HMAP_MAGIC);
+        fipc_u32_store_rel(base, HMAP_OFF_STATE, 1);
+    }
+    PyBuffer_Release(&view);
+    return 0;
+}
+
+static void SharedHashMap_dealloc(SharedHashMap *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+// Copy the value for `key` into `out`; returns 1 if found, 0 if not, or -EAGAIN (see
+// hmap_backoff). Lock-free; readers never write shared memory unless a writer died.
+static int hmap_get(SharedHashMap *self, const uint8_t *key, uint8_t *out, int block)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t i = (uint32_t)hmap_hash(key, self->key_size) & mask;
+    for (uint32_t n = 0; n < self->capacity; n++, i = (i + 1) & mask)
+    {
+        uint8_t *b = hmap_bucket(self, i);
+        uint64_t *meta = (uint64_t *)b;
+        int spins = 0;
+        for (;;)
+        {
+            uint64_t m = __atomic_load_n(meta, __ATOMIC_ACQUIRE);
+            uint32_t st = (uint32_t)(m & 3);
+            if (st == HMAP_EMPTY)
+                return 0;
+            if (st == HMAP_BUSY)
+            {
+                int rc = hmap_wait_busy(self, meta, m, &spins, block);
+                if (rc < 0)
+                    return rc;
+                continue;
+            }
+            if (st == HMAP_TOMB || memcmp(b + 8, key, self->key_size) != 0)
+                break;
+            memcpy(out, b + 8 + self->key_size, self->value_size);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(meta, __ATOMIC_RELAXED) == m)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// Overwrite the value of a live key in place; returns 0 when done, 1 when the key is not
+// live, or -EAGAIN.
+static int hmap_overwrite(SharedHashMap *self, const uint8_t *key, const uint8_t *value, uint32_t me, int block)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t i = (uint32_t)hmap_hash(key, self->key_size) & mask;
+    for (uint32_t n = 0; n < self->capacity; n++, i = (i + 1) & mask)
+    {
+        uint8_t *b = hmap_bucket(self, i);
+        uint64_t *meta = (uint64_t *)b;
+        int spins = 0;
+        for (;;)
+        {
+            uint64_t m = __atomic_load_n(meta, __ATOMIC_ACQUIRE);
+            uint32_t st = (uint32_t)(m & 3);
+            if (st == HMAP_EMPTY)
+                return 1;
+            if (st == HMAP_BUSY)
+            {
+                int rc = hmap_wait_busy(self, meta, m, &spins, block);
+                if (rc < 0)
+                    return rc;
+                continue;
+            }
+            if (st == HMAP_TOMB || memcmp(b + 8, key, self->key_size) != 0)
+                break;
+            uint32_t ver = hmap_ver(m);
+            if (!__atomic_compare_exchange_n(meta, &m, hmap_meta_busy(ver + 1, HMAP_FULL, me), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                continue;
+            memcpy(b + 8 + self->key_size, value, self->value_size);
+            __atomic_store_n(meta, hmap_meta(ver + 2, HMAP_FULL), __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Tombstone bucket `i` if it still holds a live copy of `key`.
+static void hmap_retire(SharedHashMap *self, uint32_t i, const uint8_t *key)
+{
+    uint8_t *b = hmap_bucket(self, i);
+    uint64_t *meta = (uint64_t *)b;
+    int spins = 0;
+    for (;;)
+    {
+        uint64_t m = __atomic_load_n(meta, __ATOMIC_ACQUIRE);
+        uint32_t st = (uint32_t)(m & 3);
+        if (st == HMAP_BUSY)
+        {
+            hmap_wait_busy(self, meta, m, &spins, 1);
+            continue;
+        }
+        if (st != HMAP_FULL || memcmp(b + 8, key, self->key_size) != 0)
+            return;
+        if (__atomic_compare_exchange_n(meta, &m, hmap_meta(hmap_ver(m) + 1, HMAP_TOMB), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            __atomic_fetch_sub(fipc_u32_at(self->base, HMAP_OFF_COUNT), 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(fipc_u32_at(self->base, HMAP_OFF_TOMBSTONES), 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
+
+// Store a key that was not live: CAS-claim the first tombstone or empty bucket on the probe
+// path, write and publish it, then scan the whole path for another live copy stored by a
+// concurrent put of the same key. Both puts publish before they scan (with a full fence
+// between), so at least one sees the other: the copy nearer the home bucket survives, the
+// farther one is retired, and a put whose own copy lost writes its value into the
+// survivor. The scan only waits on buckets mid-memcpy, never on another scan, so it cannot
+// deadlock. Returns as hmap_put.
+static int hmap_insert(SharedHashMap *self, const uint8_t *key, const uint8_t *value, uint32_t me, int block)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t home = (uint32_t)hmap_hash(key, self->key_size) & mask;
+    uint32_t i = home, n = 0;
+    uint64_t m = 0;
+    uint8_t *b = NULL;
+    for (;; n++, i = (i + 1) & mask)
+    {
+        if (n == self->capacity)
+            return -ENOSPC;
+        b = hmap_bucket(self, i);
+        uint64_t *meta = (uint64_t *)b;
+        int spins = 0, claimed = 0;
+        for (;;)
+        {
+            m = __atomic_load_n(meta, __ATOMIC_ACQUIRE);
+            uint32_t st = (uint32_t)(m & 3);
+            if (st == HMAP_BUSY)
+            {
+                int rc = hmap_wait_busy(self, meta, m, &spins, block);
+                if (rc < 0)
+                    return rc;
+                continue;
+            }
+            if (st == HMAP_FULL)
+            {
+                if (memcmp(b + 8, key, self->key_size) != 0)
+                    break;
+                // Stored by another process since our look: overwrite it instead.
+                int rc = hmap_overwrite(self, key, value, me, block);
+                return rc != 1 ? rc : hmap_insert(self, key, value, me, block);
+            }
+            if (__atomic_compare_exchange_n(meta, &m, hmap_meta_busy(hmap_ver(m) + 1, st, me), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                claimed = 1;
+                break;
+            }
+        }
+        if (claimed)
+            break;
+    }
+    uint32_t prev = (uint32_t)(m & 3), ver = hmap_ver(m);
+    memcpy(b + 8, key, self->key_size);
+    memcpy(b + 8 + self->key_size, value, self->value_size);
+    __atomic_store_n((uint64_t *)b, hmap_meta(ver + 2, HMAP_FULL), __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (prev == HMAP_TOMB)
+        __atomic_fetch_sub(fipc_u32_at(self->base, HMAP_OFF_TOMBSTONES), 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(fipc_u32_at(self->base, HMAP_OFF_COUNT), 1, __ATOMIC_RELAXED);
+
+    int nearer = 0; // set once the scan has passed our own bucket
+    uint32_t j = home;
+    for (n = 0; n < self->capacity; n++, j = (j + 1) & mask)
+    {
+        if (j == i)
+        {
+            nearer = 1;
+            continue;
+        }
+        uint8_t *c = hmap_bucket(self, j);
+        uint64_t *meta = (uint64_t *)c;
+        int spins = 0;
+        uint64_t cm;
+        while (((cm = __atomic_load_n(meta, __ATOMIC_ACQUIRE)) & 3) == HMAP_BUSY)
+            hmap_wait_busy(self, meta, cm, &spins, 1);
+        if ((cm & 3) == HMAP_EMPTY)
+            break;
+        if ((cm & 3) != HMAP_FULL || memcmp(c + 8, key, self->key_size) != 0)
+            continue;
+        if (nearer)
+        {
+            hmap_retire(self, j, key);
+            continue;
+        }
+        hmap_retire(self, i, key);
+        int rc = hmap_overwrite(self, key, value, me, 1);
+        return rc != 1 ? rc : hmap_insert(self, key, value, me, block);
+    }
+    return 1;
+}
+
+// Insert or overwrite; returns 1 for a new key, 0 for an update, -ENOSPC when no bucket is
+// left, or -EAGAIN when `block` is 0 and another writer holds things up. Two concurrent
+// puts of the same new key may both return 1; the map keeps one copy.
+static int hmap_put(SharedHashMap *self, const uint8_t *key, const uint8_t *value, int block)
+{
+    uint32_t me = (uint32_t)getpid();
+    int rc = hmap_overwrite(self, key, value, me, block);
+    if (rc != 1)
+        return rc;
+    return hmap_insert(self, key, value, me, block);
+}
+
+// Tombstone `key`; returns 1 if it was present, 0 if not, or -EAGAIN. Every live copy on
+// the probe path is removed, including one left behind by a put that died mid-insert.
+static int hmap_delete(SharedHashMap *self, const uint8_t *key, int block)
+{
+    uint32_t mask = self->capacity - 1;
+    uint32_t i = (uint32_t)hmap_hash(key, self->key_size) & mask;
+    int found = 0;
+    for (uint32_t n = 0; n < self->capacity; n++, i = (i + 1) & mask)
+    {
+        uint8_t *b = hmap_bucket(self, i);
+        uint64_t *meta = (uint64_t *)b;
+        int spins = 0;
+        for (;;)
+        {
+            uint64_t m = __atomic_load_n(meta, __ATOMIC_ACQUIRE);
+            uint32_t st = (uint32_t)(m & 3);
+            if (st == HMAP_EMPTY)
+                return found;
+            if (st == HMAP_BUSY)
+            {
+                int rc = hmap_wait_busy(self, meta, m, &spins, block);
+                if (rc < 0)
+                    return found ? found : rc;
+                continue;
+            }
+            if (st == HMAP_TOMB || memcmp(b + 8, key, self->key_size) != 0)
+                break;
+            if (!__atomic_compare_exchange_n(meta, &m, hmap_meta(hmap_ver(m) + 1, HMAP_TOMB), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                continue;
+            __atomic_fetch_sub(fipc_u32_at(self->base, HMAP_OFF_COUNT), 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(fipc_u32_at(self->base, HMAP_OFF_TOMBSTONES), 1, __ATOMIC_RELAXED);
+            found = 1;
+            break;
+        }
+    }
+    return found;
+}
+
+// Borrow a bytes-like argument whose length must be a multiple of `unit` (exactly `unit`
+// when `single`); sets *n to the element count.
+static int hmap_arg(PyObject *obj, Py_buffer *view, uint32_t unit, int single, Py_ssize_t *n, const char *what)
+{
+    if (PyObject_GetBuffer(obj, view, PyBUF_SIMPLE) < 0)
+        return -1;
+    if (single ? view->len != (Py_ssize_t)unit : (unit == 0 ? view->len != 0 : view->len % unit != 0))
+    {
+        PyErr_Format(PyExc_ValueError, single ? "%s must be exactly %u bytes" : "%s length must be a multiple of %u bytes", what, (unsigned)unit);
+        PyBuffer_Release(view);
+        return -1;
+    }
+    if (n)
+        *n = unit ? view->len / unit : 0;
+    return 0;
+}
+
+static PyObject *SharedHashMap_get(SharedHashMap *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"key", "default", NULL};
+    PyObject *key_obj, *dflt = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|O", kwlist, &key_obj, &dflt))
+        return NULL;
+    Py_buffer key;
+    if (hmap_arg(key_obj, &key, self->key_size, 1, NULL, "key") < 0)
+        return NULL;
+    PyObject *out = PyBytes_FromStringAndSize(NULL, self->value_size);
+    if (out == NULL)
+    {
+        PyBuffer_Release(&key);
+        return NULL;
+    }
+    int found = hmap_get(self, (const uint8_t *)key.buf, (uint8_t *)PyBytes_AS_STRING(out), 0);
+    if (found == -EAGAIN)
+    {
+        Py_BEGIN_ALLOW_THREADS
+            found = hmap_get(self, (const uint8_t *)key.buf, (uint8_t *)PyBytes_AS_STRING(out), 1);
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release(&key);
+    if (found)
+        return out;
+    Py_DECREF(out);
+    Py_INCREF(dflt);
+    return dflt;
+}
+
+static PyObject *SharedHashMap_put(SharedHashMap *self, PyObject *args)
+{
+    PyObject *key_obj, *value_obj;
+    if (!PyArg_ParseTuple(args, "OO", &key_obj, &value_obj))
+        return NULL;
+    Py_buffer key, value;
+    if (hmap_arg(key_obj, &key, self->key_size, 1, NULL, "key") < 0)
+        return NULL;
+    if (hmap_arg(value_obj, &value, self->value_size, 1, NULL, "value") < 0)
+    {
+        PyBuffer_Release(&key);
+        return NULL;
+    }
+    int rc = hmap_put(self, (const uint8_t *)key.buf, (const uint8_t *)value.buf, 0);
+    if (rc == -EAGAIN)
+    {
+        Py_BEGIN_ALLOW_THREADS
+            rc = hmap_put(self, (const uint8_t *)key.buf, (const uint8_t *)value.buf, 1);
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release(&key);
+    PyBuffer_Release(&value);
+    if (rc == -ENOSPC)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "hash map is full");
+        return NULL;
+    }
+    return PyBool_FromLong(rc);
+}
+
+static PyObject *SharedHashMap_delete(SharedHashMap *self, PyObject *arg)
+{
+    Py_buffer key;
+    if (hmap_arg(arg, &key, self->key_size, 1, NULL, "key") < 0)
+        return NULL;
+    int rc = hmap_delete(self, (const uint8_t *)key.buf, 0);
+    if (rc == -EAGAIN)
+    {
+        Py_BEGIN_ALLOW_THREADS
+            rc = hmap_delete(self, (const uint8_t *)key.buf, 1);
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release(&key);
+    return PyBool_FromLong(rc);
+}
+
+static PyObject *SharedHashMap_get_many(SharedHashMap *self, PyObject *arg)
+{
+    Py_buffer keys;
+    Py_ssize_t n;
+    if (hmap_arg(arg, &keys, self->key_size, 0, &n, "keys") < 0)
+        return NULL;
+    PyObject *values = PyBytes_FromStringAndSize(NULL, n * (Py_ssize_t)self->value_size);
+    PyObject *found = PyBytes_FromStringAndSize(NULL, n);
+    if (values == NULL || found == NULL)
+    {
+        Py_XDECREF(values);
+        Py_XDECREF(found);
+        PyBuffer_Release(&keys);
+        return NULL;
+    }
+    uint8_t *vp = (uint8_t *)PyBytes_AS_STRING(values);
+    uint8_t *fp = (uint8_t *)PyBytes_AS_STRING(found);
+    const uint8_t *kp = (const uint8_t *)keys.buf;
+    Py_BEGIN_ALLOW_THREADS for (Py_ssize_t j = 0; j < n; j++)
+    {
+        uint8_t *v = vp + (size_t)j * self->value_size;
+        fp[j] = (uint8_t)hmap_get(self, kp + (size_t)j * self->key_size, v, 1);
+        if (!fp[j])
+            memset(v, 0, self->value_size);
+    }
+    Py_END_ALLOW_THREADS PyBuffer_Release(&keys);
+    return Py_BuildValue("(NN)", values, found);
+}
+
+static PyObject *SharedHashMap_put_many(SharedHashMap *self, PyObject *args)
+{
+    PyObject *keys_obj, *values_obj;
+    if (!PyArg_ParseTuple(args, "OO", &keys_obj, &values_obj))
+        return NULL;
+    Py_buffer keys, values;
+    Py_ssize_t n, nv;
+    if (hmap_arg(keys_obj, &keys, self->key_size, 0, &n, "keys") < 0)
+        return NULL;
+    if (hmap_arg(values_obj, &values, self->value_size, 0, &nv, "values") < 0)
+    {
+        PyBuffer_Release(&keys);
+        return NULL;
+    }
+    if (self->value_size != 0 && nv != n)
+    {
+        PyBuffer_Release(&keys);
+        PyBuffer_Release(&values);
+        PyErr_SetString(PyExc_ValueError, "keys and values hold a different number of entries");
+        return NULL;
+    }
+    const uint8_t *kp = (const uint8_t *)keys.buf, *vp = (const uint8_t *)values.buf;
+    Py_ssize_t inserted = 0, j = 0;
+    int rc = 0;
+    Py_BEGIN_ALLOW_THREADS for (; j < n; j++)
+    {
+        rc = hmap_put(self, kp + (size_t)j * self->key_size, vp + (size_t)j * self->value_size, 1);
+        if (rc < 0)
+            break;
+        inserted += rc;
+    }
+    Py_END_ALLOW_THREADS PyBuffer_Release(&keys);
+    PyBuffer_Release(&values);
+    if (rc == -ENOSPC)
+    {
+        PyErr_Format(PyExc_RuntimeError, "hash map is full (stored %zd of %zd entries)", j, n);
+        return NULL;
+    }
+    return PyLong_FromSsize_t(inserted);
+}
+
+static PyObject *SharedHashMap_count(SharedHashMap *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(fipc_u32_load_acq(self->base, HMAP_OFF_COUNT));
+}
+
+static PyObject *SharedHashMap_capacity(SharedHashMap *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(self->capacity);
+}
+
+static PyObject *SharedHashMap_stats(SharedHashMap *self, PyObject *Py_UNUSED(ignored))
+{
+    uint32_t count = fipc_u32_load_acq(self->base, HMAP_OFF_COUNT);
+    uint32_t tombs = fipc_u32_load_acq(self->base, HMAP_OFF_TOMBSTONES);
+    return Py_BuildValue("{sIsIsIsIsIsd}", "capacity", self->capacity, "count", count, "tombstones", tombs,
+                         "key_size", self->key_size, "value_size", self->value_size,
+                         "load_factor", (double)(count + tombs) / self->capacity);
+}
+
+static PyObject *SharedHashMap_required_size(PyObject *Py_UNUSED(cls), PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"key_size", "value_size", "capacity", NULL};
+    Py_ssize_t key_size, value_size, capacity;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "nnn", kwlist, &key_size, &value_size, &capacity))
+        return NULL;
+    if (key_size <= 0 || key_size > HMAP_KEY_MAX || value_size < 0 || value_size > HMAP_VALUE_MAX || capacity <= 0 || capacity > HMAP_CAPACITY_MAX)
+    {
+        PyErr_SetString(PyExc_ValueError, "key_size, value_size or capacity out of range");
+        return NULL;
+    }
+    return PyLong_FromSize_t(hmap_required_size((size_t)key_size, (size_t)value_size, hmap_round_capacity(capacity)));
+}
+
+static PyMethodDef SharedHashMap_methods[] = {
+    {"get", PyCFunction_CAST(SharedHashMap_get), METH_VARARGS | METH_KEYWORDS, "value bytes for key, or default"},
+    {"put", (PyCFunction)SharedHashMap_put, METH_VARARGS, "insert or overwrite; True if the key is new"},
+    {"delete", (PyCFunction)SharedHashMap_delete, METH_O, "remove key; True if it was present"},
+    {"get_many", (PyCFunction)SharedHashMap_get_many, METH_O, "(values, found) for a packed array of keys"},
+    {"put_many", (PyCFunction)SharedHashMap_put_many, METH_VARARGS, "store packed keys/values; returns the number of new keys"},
+    {"count", (PyCFunction)SharedHashMap_count, METH_NOARGS, "number of live entries"},
+    {"capacity", (PyCFunction)SharedHashMap_capacity, METH_NOARGS, "number of buckets"},
+    {"stats", (PyCFunction)SharedHashMap_stats, METH_NOARGS, "capacity, count, tombstones and load factor"},
+    {"required_size", PyCFunction_CAST(SharedHashMap_required_size), METH_VARARGS | METH_KEYWORDS | METH_STATIC, "buffer bytes needed for a map"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *SharedHashMap_repr(PyObject *self)
+{
+    SharedHashMap *s = (SharedHashMap *)self;
+    return PyUnicode_FromFormat("<fastipc.SharedHashMap buf=%p capacity=%u count=%u>", (void *)s->base, (unsigned)s->capacity, (unsigned)fipc_u32_load_acq(s->base, HMAP_OFF_COUNT));
+}
+
+static PyType_Slot SharedHashMap_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)SharedHashMap_init},
+    {Py_tp_dealloc, (void *)SharedHashMap_dealloc},
+    {Py_tp_methods, SharedHashMap_methods},
+    {Py_tp_repr, (void *)SharedHashMap_repr},
+    {0, NULL}};
+
+static PyType_Spec SharedHashMap_spec = {
+    .name = "fastipc.SharedHashMap",
+    .basicsize = sizeof(SharedHashMap),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = SharedHashMap_type_slots,
+};
+
+// ---------- BlockPool ----------
+// Fixed-size blocks handed out by index, with a lock-free free list.
+// Layout (BlockPool):
+//   0x00: u32 magic ('BPOL')
+//   0x04: u32 layout version
+//   0x08: u32 blocks
+//   0x0C: u32 state (0=unformatted, 1=live)
+//   0x10: u32 block size
+//   0x14: u32 free blocks on the shared list (approximate)
+//   0x18: u64 head = tag << 32 | (index + 1), 0 = empty; the tag changes on every CAS (ABA)
+//   0x20..0x3F: reserved
+//   0x40: u32 next[blocks]: successor (index + 1) while on the free list,
+//         BPOOL_TAKEN while handed out, BPOOL_CACHED while in a process cache
+//   then, 64-byte aligned: the blocks, each block size rounded up to 64 bytes
+#define BPOOL_MAGIC 0x42504F4Cu /* 'BPOL' */
+#define BPOOL_OFF_VERSION 4u
+#define BPOOL_OFF_BLOCKS 8u
+#define BPOOL_OFF_STATE 12u
+#define BPOOL_OFF_BLOCKSIZE 16u
+#define BPOOL_OFF_FREE 20u
+#define BPOOL_OFF_HEAD 24u
+#define BPOOL_OFF_NEXT 64u
+#define BPOOL_TAKEN 0xFFFFFFFFu
+#define BPOOL_CACHED 0xFFFFFFFEu
+#define BPOOL_MAX_BLOCKS 0xFFFFFFF0u
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    uint8_t *data;
+    uint32_t nblocks;
+    uint32_t block_size;
+    size_t stride;
+    // Process-local cache of free blocks, in front of the shared head. Dropped (not returned)
+    // in a forked child, whose copy would alias the parent's blocks.
+    uint32_t *cache;
+    uint32_t cache_len;
+    uint32_t cache_cap;
+    pid_t cache_pid;
+    uint32_t cache_lock;
+    PyObject *owner;
+} BlockPool;
+
+static inline size_t bpool_stride(size_t block_size)
+{
+    return (block_size + 63) & ~(size_t)63;
+}
+
+static inline size_t bpool_data_offset(size_t nblocks)
+{
+    return (BPOOL_OFF_NEXT + 4 * nblocks + 63) & ~(size_t)63;
+}
+
+static inline size_t bpool_required_size(size_t block_size, size_t nblocks)
+{
+    return bpool_data_offset(nblocks) + nblocks * bpool_stride(block_size);
+}
+
+static inline uint32_t *bpool_next(BlockPool *self, uint32_t i)
+{
+    return fipc_u32_at(self->base, BPOOL_OFF_NEXT + 4u * i);
+}
+
+static inline uint64_t *bpool_head(BlockPool *self)
+{
+    return (uint64_t *)(self->base + BPOOL_OFF_HEAD);
+}
+
+// Pop one block off the shared list; returns its index or -1 when empty.
+static int64_t bpool_pop(BlockPool *self)
+{
+    uint64_t *head = bpool_head(self);
+    uint64_t h = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+    for (;;)
+    {
+        uint32_t top = (uint32_t)h;
+        if (top == 0)
+            return -1;
+        // May read a stale successor if `top` was popped meanwhile; the tag then fails the CAS.
+        uint32_t next = __atomic_load_n(bpool_next(self, top - 1), __ATOMIC_ACQUIRE);
+        uint64_t nh = (((h >> 32) + 1) << 32) | (next >= BPOOL_CACHED ? 0 : next);
+        if (__atomic_compare_exchange_n(head, &h, nh, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            __atomic_store_n(bpool_next(self, top - 1), BPOOL_TAKEN, __ATOMIC_RELAXED);
+            __atomic_fetch_sub(fipc_u32_at(self->base, BPOOL_OFF_FREE), 1, __ATOMIC_RELAXED);
+            return top - 1;
+        }
+    }
+}
+
+// Push a pre-linked chain first..last (`count` blocks) onto the shared list.
+static void bpool_push_chain(BlockPool *self, uint32_t first, uint32_t last, uint32_t count)
+{
+    uint64_t *head = bpool_head(self);
+    uint64_t h = __atomic_load_n(head, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        __atomic_store_n(bpool_next(self, last), (uint32_t)h, __ATOMIC_RELAXED);
+        uint64_t nh = (((h >> 32) + 1) << 32) | (first + 1);
+        if (__atomic_compare_exchange_n(head, &h, nh, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            break;
+    }
+    __atomic_fetch_add(fipc_u32_at(self->base, BPOOL_OFF_FREE), count, __ATOMIC_RELAXED);
+}
+
+static void bpool_cache_lock(BlockPool *self)
+{
+    while (__atomic_exchange_n(&self->cache_lock, 1, __ATOMIC_ACQUIRE))
+        FASTIPC_CPU_RELAX();
+    if (self->cache_pid != getpid())
+    {
+        self->cache_len = 0;
+        self->cache_pid = getpid();
+    }
+}
+
+static void bpool_cache_unlock(BlockPool *self)
+{
+    __atomic_store_n(&self->cache_lock, 0, __ATOMIC_RELEASE);
+}
+
+// Return the newest `n` cached blocks to the shared list (cache lock held).
+static void bpool_cache_spill(BlockPool *self, uint32_t n)
+{
+    if (n == 0)
+        return;
+    uint32_t *c = self->cache + self->cache_len - n;
+    for (uint32_t j = 0; j + 1 < n; j++)
+        __atomic_store_n(bpool_next(self, c[j]), c[j + 1] + 1, __ATOMIC_RELAXED);
+    bpool_push_chain(self, c[0], c[n - 1], n);
+    self->cache_len -= n;
+}
+
+static int64_t bpool_alloc(BlockPool *self)
+{
+    if (self->cache_cap == 0)
+        return bpool_pop(self);
+    bpool_cache_lock(self);
+    if (self->cache_len == 0)
+    {
+        // Refill half the cache so the next allocations skip the shared head.
+        for (uint32_t want = self->cache_cap / 2 + 1; self->cache_len < want;)
+        {
+            int64_t i = bpool_pop(self);
+            if (i < 0)
+                break;
+            __atomic_store_n(bpool_next(self, (uint32_t)i), BPOOL_CACHED, __ATOMIC_RELAXED);
+            self->cache[self->cache_len++] = (uint32_t)i;
+        }
+    }
+    int64_t i = -1;
+    if (self->cache_len > 0)
+    {
+        i = self->cache[--self->cache_len];
+        __atomic_store_n(bpool_next(self, (uint32_t)i), BPOOL_TAKEN, __ATOMIC_RELAXED);
+    }
+    bpool_cache_unlock(self);
+    return i;
+}
+
+// Returns 0, or -EINVAL for a handle that is not currently allocated (double free).
+static int bpool_free(BlockPool *self, uint32_t i)
+{
+    uint32_t expected = BPOOL_TAKEN;
+    if (!__atomic_compare_exchange_n(bpool_next(self, i), &expected, BPOOL_CACHED, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return -EINVAL;
+    if (self->cache_cap == 0)
+    {
+        bpool_push_chain(self, i, i, 1);
+        return 0;
+    }
+    bpool_cache_lock(self);
+    if (self->cache_len == self->cache_cap)
+        bpool_cache_spill(self, self->cache_cap / 2 + 1);
+    self->cache[self->cache_len++] = i;
+    bpool_cache_unlock(self);
+    return 0;
+}
+
+static int BlockPool_init(BlockPool *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "block_size", "cache_size", NULL};
+    PyObject *buf_obj;
+    Py_ssize_t block_size = 0, cache_size = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|nn", kwlist, &buf_obj, &block_size, &cache_size))
+        return -1;
+    if (block_size < 0 || block_size > UINT32_MAX || cache_size < 0 || cache_size > 65536)
+    {
+        PyErr_SetString(PyExc_ValueError, "block_size or cache_size out of range");
+        return -1;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_WRITABLE) < 0)
+        return -1;
+    if (!check_aligned(view.buf, view.len, BPOOL_OFF_NEXT, 64))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "need 64-byte aligned >=64 buffer for BlockPool");
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)view.buf;
+    // block_size > 0 formats a fresh pool over the whole buffer; 0 attaches to a formatted one.
+    int format = block_size > 0;
+    size_t nblocks;
+    if (format)
+    {
+        size_t stride = bpool_stride((size_t)block_size);
+        nblocks = ((size_t)view.len - BPOOL_OFF_NEXT) / (stride + 4);
+        while (nblocks > 0 && bpool_required_size((size_t)block_size, nblocks) > (size_t)view.len)
+            nblocks--;
+        if (nblocks > BPOOL_MAX_BLOCKS)
+            nblocks = BPOOL_MAX_BLOCKS;
+    }
+    else
+    {
+        if (fipc_u32_load_acq(base, BPOOL_OFF_STATE) == 0 || fipc_header_check(base, BPOOL_MAGIC) != 0)
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "buffer does not hold a formatted BlockPool");
+            return -1;
+        }
+        nblocks = fipc_u32_load_acq(base, BPOOL_OFF_BLOCKS);
+        block_size = fipc_u32_load_acq(base, BPOOL_OFF_BLOCKSIZE);
+    }
+    if (nblocks == 0 || (size_t)view.len < bpool_required_size((size_t)block_size, nblocks))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer too small for a BlockPool block");
+        return -1;
+    }
+
+    uint32_t *cache = NULL;
+    if (cache_size > 0 && (cache = PyMem_Calloc((size_t)cache_size, sizeof(uint32_t))) == NULL)
+    {
+        PyBuffer_Release(&view);
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyMem_Free(cache);
+        PyBuffer_Release(&view);
+        return -1;
+    }
+    self->base = base;
+    self->data = base + bpool_data_offset(nblocks);
+    self->nblocks = (uint32_t)nblocks;
+    self->block_size = (uint32_t)block_size;
+    self->stride = bpool_stride((size_t)block_size);
+    self->cache = cache;
+    self->cache_cap = (uint32_t)cache_size;
+    self->cache_len = 0;
+    self->cache_pid = getpid();
+    if (format)
+    {
+        // Initially every block is on the list, in index order.
+        for (uint32_t i = 0; i < (uint32_t)nblocks; i++)
+            fipc_u32_store_rel(base, BPOOL_OFF_NEXT + 4u * i, i + 1 < nblocks ? i + 2 : 0);
+        __atomic_store_n(bpool_head(self), 1, __ATOMIC_RELEASE);
+        fipc_u32_store_rel(base, BPOOL_OFF_FREE, (uint32_t)nblocks);
+        fipc_u32_store_rel(base, BPOOL_OFF_BLOCKSIZE, (uint32_t)block_size);
+        fipc_u32_store_rel(base, BPOOL_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+        fipc_u32_store_rel(base, BPOOL_OFF_BLOCKS, (uint32_t)nblocks);
+        fipc_u32_store_rel(base, 0, BPOOL_MAGIC);
+        fipc_u32_store_rel(base, BPOOL_OFF_STATE, 1);
+    }
+    PyBuffer_Release(&view);
+    return 0;
+}
+
+static void BlockPool_dealloc(BlockPool *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    if (self->cache != NULL)
+    {
+        // Hand cached blocks back, unless the owner's mapping is already gone (closed mmap).
+        if (self->cache_len > 0 && self->cache_pid == getpid())
+        {
+            PyObject *et, *ev, *tb;
+            Py_buffer view;
+            PyErr_Fetch(&et, &ev, &tb);
+            if (PyObject_GetBuffer(self->owner, &view, PyBUF_SIMPLE) == 0)
+            {
+                bpool_cache_spill(self, self->cache_len);
+                PyBuffer_Release(&view);
+            }
+            PyErr_Restore(et, ev, tb);
+        }
+        PyMem_Free(self->cache);
+    }
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+static int bpool_handle(BlockPool *self, PyObject *obj, uint32_t *out)
+{
+    Py_ssize_t i = PyNumber_AsSsize_t(obj, PyExc_OverflowError);
+    if (i == -1 && PyErr_Occurred())
+        return -1;
+    if (i < 0 || i >= (Py_ssize_t)self->nblocks)
+    {
+        PyErr_SetString(PyExc_ValueError, "not a BlockPool handle");
+        return -1;
+    }
+    *out = (uint32_t)i;
+    return 0;
+}
+
+static PyObject *BlockPool_alloc(BlockPool *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromLongLong(bpool_alloc(self));
+}
+
+static PyObject *BlockPool_free(BlockPool *self, PyObject *arg)
+{
+    uint32_t i;
+    if (bpool_handle(self, arg, &i) < 0)
+        return NULL;
+    if (bpool_free(self, i) < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "block is not allocated (double free?)");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *BlockPool_alloc_many(BlockPool *self, PyObject *arg)
+{
+    Py_ssize_t n = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+    if (n == -1 && PyErr_Occurred())
+        return NULL;
+    if (n < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "n must be >= 0");
+        return NULL;
+    }
+    PyObject *out = PyList_New(0);
+    if (out == NULL)
+        return NULL;
+    for (Py_ssize_t j = 0; j < n; j++)
+    {
+        int64_t i = bpool_alloc(self);
+        if (i < 0)
+            break;
+        PyObject *h = PyLong_FromLongLong(i);
+        if (h == NULL || PyList_Append(out, h) < 0)
+        {
+            Py_XDECREF(h);
+            bpool_free(self, (uint32_t)i);
+            Py_DECREF(out);
+            return NULL;
+        }
+        Py_DECREF(h);
+    }
+    return out;
+}
+
+static PyObject *BlockPool_free_many(BlockPool *self, PyObject *arg)
+{
+    PyObject *seq = PySequence_Fast(arg, "free_many() expects an iterable of handles");
+    if (seq == NULL)
+        return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t j = 0; j < n; j++)
+    {
+        uint32_t i;
+        if (bpool_handle(self, PySequence_Fast_GET_ITEM(seq, j), &i) < 0)
+            goto fail;
+        if (bpool_free(self, i) < 0)
+        {
+            PyErr_Format(PyExc_ValueError, "block %u is not allocated (double free?)", (unsigned)i);
+            goto fail;
+        }
+    }
+    Py_DECREF(seq);
+    Py_RETURN_NONE;
+fail:
+    Py_DECREF(seq);
+    return NULL;
+}
+
+static PyObject *BlockPool_view(BlockPool *self, PyObject *arg)
+{
+    uint32_t i;
+    if (bpool_handle(self, arg, &i) < 0)
+        return NULL;
+    Py_ssize_t start = (Py_ssize_t)((self->data - self->base) + (size_t)i * self->stride);
+    return owner_slice(self->owner, start, self->block_size);
+}
+
+static PyObject *BlockPool_offset(BlockPool *self, PyObject *arg)
+{
+    uint32_t i;
+    if (bpool_handle(self, arg, &i) < 0)
+        return NULL;
+    return PyLong_FromSize_t((size_t)(self->data - self->base) + (size_t)i * self->stride);
+}
+
+static PyObject *BlockPool_flush(BlockPool *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->cache_cap > 0)
+    {
+        bpool_cache_lock(self);
+        bpool_cache_spill(self, self->cache_len);
+        bpool_cache_unlock(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *BlockPool_available(BlockPool *self, PyObject *Py_UNUSED(ignored))
+{
+    uint32_t n = fipc_u32_load_acq(self->base, BPOOL_OFF_FREE);
+    if (self->cache_pid == getpid())
+        n += __atomic_load_n(&self->cache_len, __ATOMIC_RELAXED);
+    return PyLong_FromUnsignedLong(n);
+}
+
+static PyObject *BlockPool_blocks(BlockPool *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(self->nblocks);
+}
+
+static PyObject *BlockPool_block_size(BlockPool *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromUnsignedLong(self->block_size);
+}
+
+static PyObject *BlockPool_required_size(PyObject *Py_UNUSED(cls), PyObject *args)
+{
+    Py_ssize_t block_size, nblocks;
+    if (!PyArg_ParseTuple(args, "nn", &block_size, &nblocks))
+        return NULL;
+    if (block_size <= 0 || block_size > UINT32_MAX || nblocks <= 0 || (size_t)nblocks > BPOOL_MAX_BLOCKS)
+    {
+        PyErr_SetString(PyExc_ValueError, "block_size or blocks out of range");
+        return NULL;
+    }
+    return PyLong_FromSize_t(bpool_required_size((size_t)block_size, (size_t)nblocks));
+}
+
+static PyMethodDef BlockPool_methods[] = {
+    {"alloc", (PyCFunction)BlockPool_alloc, METH_NOARGS, "take a block; returns its handle or -1 when exhausted"},
+    {"free", (PyCFunction)BlockPool_free, METH_O, "return a block"},
+    {"alloc_many", (PyCFunction)BlockPool_alloc_many, METH_O, "take up to n blocks; returns a list of handles"},
+    {"free_many", (PyCFunction)BlockPool_free_many, METH_O, "return several blocks"},
+    {"view", (PyCFunction)BlockPool_view, METH_O, "zero-copy memoryview of a block"},
+    {"offset", (PyCFunction)BlockPool_offset, METH_O, "byte offset of a block in the buffer"},
+    {"flush", (PyCFunction)BlockPool_flush, METH_NOARGS, "return this process's cached blocks to the shared list"},
+    {"available", (PyCFunction)BlockPool_available, METH_NOARGS, "approximate number of free blocks"},
+    {"blocks", (PyCFunction)BlockPool_blocks, METH_NOARGS, "number of blocks"},
+    {"block_size", (PyCFunction)BlockPool_block_size, METH_NOARGS, "usable bytes per block"},
+    {"required_size", (PyCFunction)BlockPool_required_size, METH_VARARGS | METH_STATIC, "buffer bytes needed for blocks of block_size"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *BlockPool_repr(PyObject *self)
+{
+    BlockPool *s = (BlockPool *)self;
+    return PyUnicode_FromFormat("<fastipc.BlockPool buf=%p blocks=%u block_size=%u>", (void *)s->base, (unsigned)s->nblocks, (unsigned)s->block_size);
+}
+
+static PyType_Slot BlockPool_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)BlockPool_init},
+    {Py_tp_dealloc, (void *)BlockPool_dealloc},
+    {Py_tp_methods, BlockPool_methods},
+    {Py_tp_repr, (void *)BlockPool_repr},
+    {0, NULL}};
+
+static PyType_Spec BlockPool_spec = {
+    .name = "fastipc.BlockPool",
+    .basicsize = sizeof(BlockPool),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = BlockPool_type_slots,
+};
+
+// ---------- StructLayout / SharedStruct ----------
+// A declared list of fields compiled once into offsets, and a typed view over a buffer.
+// Placement (after a 64B header):
+//   1. mutex / semaphore fields: whole cache lines, one 64B header per element
+//   2. atomic_u32 / atomic_u64 / futex fields: each field starts its own cache line so hot
+//      words written by different processes never share one
+//   3. plain numbers: packed together by descending alignment, starting on a fresh line
+// Header (SharedStruct):
+//   0x00: u32 magic ('SSTR')
+//   0x04: u32 layout version
+//   0x08: u64 layout hash (names, kinds, counts and offsets)
+//   0x10: u32 struct size
+//   0x14: u32 state (0=unformatted, 2=ready; while formatting: formatter pid << 2 | 1, so an
+//         attacher can take over from a formatter that died)
+#define SSTRUCT_MAGIC 0x53535452u /* 'SSTR' */
+#define SSTRUCT_OFF_VERSION 4u
+#define SSTRUCT_OFF_HASH 8u
+#define SSTRUCT_OFF_SIZE 16u
+#define SSTRUCT_OFF_STATE 20u
+#define SSTRUCT_HDR 64u
+#define SSTRUCT_FORMATTING 1u
+#define SSTRUCT_READY 2u
+
+enum
+{
+    SF_U8,
+    SF_U16,
+    SF_U32,
+    SF_U64,
+    SF_I8,
+    SF_I16,
+    SF_I32,
+    SF_I64,
+    SF_F32,
+    SF_F64,
+    SF_ATOMIC_U32,
+    SF_ATOMIC_U64,
+    SF_FUTEX,
+    SF_MUTEX,
+    SF_SEMAPHORE,
+    SF_NKINDS
+};
+
+static const struct
+{
+    const char *name;
+    uint32_t size;
+    char format; // memoryview format of one element
+} sfield_kinds[SF_NKINDS] = {
+    [SF_U8] = {"u8", 1, 'B'},
+    [SF_U16] = {"u16", 2, 'H'},
+    [SF_U32] = {"u32", 4, 'I'},
+    [SF_U64] = {"u64", 8, 'Q'},
+    [SF_I8] = {"i8", 1, 'b'},
+    [SF_I16] = {"i16", 2, 'h'},
+    [SF_I32] = {"i32", 4, 'i'},
+    [SF_I64] = {"i64", 8, 'q'},
+    [SF_F32] = {"f32", 4, 'f'},
+    [SF_F64] = {"f64", 8, 'd'},
+    [SF_ATOMIC_U32] = {"atomic_u32", 4, 'I'},
+    [SF_ATOMIC_U64] = {"atomic_u64", 8, 'Q'},
+    [SF_FUTEX] = {"futex", 4, 'I'},
+    [SF_MUTEX] = {"mutex", 64, 'B'},
+    [SF_SEMAPHORE] = {"semaphore", 64, 'B'},
+};
+
+// Names that would shadow SharedStruct methods.
+static const char *const sstruct_reserved[] = {"load", "store", "fetch_add", "cas", "wait", "wake",
+                                               "load_fields", "store_fields", "layout", NULL};
+
+static inline int sfield_is_sync(int kind) { return kind == SF_MUTEX || kind == SF_SEMAPHORE; }
+static inline int sfield_is_word(int kind) { return kind == SF_ATOMIC_U32 || kind == SF_ATOMIC_U64 || kind == SF_FUTEX; }
+static inline size_t align64(size_t n) { return (n + 63) & ~(size_t)63; }
+
+typedef struct
+{
+    PyObject *name;
+    int kind;
+    uint32_t count;
+    uint32_t offset;
+} sfield;
+
+typedef struct
+{
+    PyObject_HEAD sfield *fields;
+    Py_ssize_t nfields;
+    PyObject *index; // name -> field number
+    uint32_t size;
+    uint64_t hash;
+} StructLayout;
+
+static void StructLayout_clear_fields(StructLayout *self)
+{
+    for (Py_ssize_t i = 0; i < self->nfields; i++)
+        Py_XDECREF(self->fields[i].name);
+    PyMem_Free(self->fields);
+    self->fields = NULL;
+    self->nfields = 0;
+    Py_CLEAR(self->index);
+}
+
+static inline uint64_t sstruct_fnv(uint64_t h, const void *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        h ^= ((const uint8_t *)p)[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static int StructLayout_init(StructLayout *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"fields", NULL};
+    PyObject *spec;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O", kwlist, &spec))
+        return -1;
+    if (self->index != NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "object is already initialized");
+        return -1;
+    }
+    PyObject *seq = PySequence_Fast(spec, "fields must be a sequence of (name, kind[, count]) tuples");
+    if (seq == NULL)
+        return -1;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    if (n == 0)
+    {
+        Py_DECREF(seq);
+        PyErr_SetString(PyExc_ValueError, "a layout needs at least one field");
+        return -1;
+    }
+    self->fields = PyMem_Calloc((size_t)n, sizeof(sfield));
+    self->index = PyDict_New();
+    if (self->fields == NULL || self->index == NULL)
+    {
+        Py_DECREF(seq);
+        StructLayout_clear_fields(self);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < n; i++)
+    {
+        PyObject *name;
+        const char *kind;
+        Py_ssize_t count = 1;
+        if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "Us|n;fields must be (name, kind[, count]) tuples", &name, &kind, &count))
+            goto fail;
+        sfield *f = &self->fields[i];
+        self->nfields = i + 1;
+        f->kind = -1;
+        for (int k = 0; k < SF_NKINDS; k++)
+            if (strcmp(kind, sfield_kinds[k].name) == 0)
+                f->kind = k;
+        if (f->kind < 0)
+        {
+            PyErr_Format(PyExc_ValueError, "field %R: unknown kind '%s'", name, kind);
+            goto fail;
+        }
+        if (count < 1 || count > 1 << 20)
+        {
+            PyErr_Format(PyExc_ValueError, "field %R: count must be 1..%d", name, 1 << 20);
+            goto fail;
+        }
+        if (!PyUnicode_IsIdentifier(name) || PyUnicode_READ_CHAR(name, 0) == '_')
+        {
+            PyErr_Format(PyExc_ValueError, "field %R: names must be identifiers not starting with '_'", name);
+            goto fail;
+        }
+        for (const char *const *r = sstruct_reserved; *r != NULL; r++)
+            if (PyUnicode_CompareWithASCIIString(name, *r) == 0)
+            {
+                PyErr_Format(PyExc_ValueError, "field %R: name is reserved", name);
+                goto fail;
+            }
+        if (PyDict_GetItemWithError(self->index, name) != NULL || PyErr_Occurred())
+        {
+            if (!PyErr_Occurred())
+                PyErr_Format(PyExc_ValueError, "field %R is declared twice", name);
+            goto fail;
+        }
+        PyObject *num = PyLong_FromSsize_t(i);
+        if (num == NULL || PyDict_SetItem(self->index, name, num) < 0)
+        {
+            Py_XDECREF(num);
+            goto fail;
+        }
+        Py_DECREF(num);
+        Py_INCREF(name);
+        f->name = name;
+        f->count = (uint32_t)count;
+    }
+    Py_DECREF(seq);
+
+    // Place fields group by group (see the layout comment above).
+    size_t off = SSTRUCT_HDR;
+    for (Py_ssize_t i = 0; i < n; i++)
+        if (sfield_is_sync(self->fields[i].kind))
+        {
+            self->fields[i].offset = (uint32_t)off;
+            off += 64u * self->fields[i].count;
+        }
+    for (Py_ssize_t i = 0; i < n; i++)
+        if (sfield_is_word(self->fields[i].kind))
+        {
+            sfield *f = &self->fields[i];
+            f->offset = (uint32_t)off;
+            off = align64(off + (size_t)sfield_kinds[f->kind].size * f->count);
+        }
+    for (uint32_t size = 8; size >= 1; size >>= 1)
+        for (Py_ssize_t i = 0; i < n; i++)
+        {
+            sfield *f = &self->fields[i];
+            if (!sfield_is_sync(f->kind) && !sfield_is_word(f->kind) && sfield_kinds[f->kind].size == size)
+            {
+                f->offset = (uint32_t)off;
+                off += (size_t)size * f->count;
+            }
+        }
+    off = align64(off);
+    if (off > UINT32_MAX)
+    {
+        StructLayout_clear_fields(self);
+        PyErr_SetString(PyExc_ValueError, "layout is too large");
+        return -1;
+    }
+    self->size = (uint32_t)off;
+
+    uint64_t h = 1469598103934665603ull;
+    uint32_t version = FASTIPC_LAYOUT_VERSION;
+    h = sstruct_fnv(h, &version, 4);
+    for (Py_ssize_t i = 0; i < n; i++)
+    {
+        sfield *f = &self->fields[i];
+        Py_ssize_t len;
+        const char *s = PyUnicode_AsUTF8AndSize(f->name, &len);
+        if (s == NULL)
+        {
+            StructLayout_clear_fields(self);
+            return -1;
+        }
+        uint32_t meta[3] = {(uint32_t)f->kind, f->count, f->offset};
+        h = sstruct_fnv(h, s, (size_t)len + 1);
+        h = sstruct_fnv(h, meta, sizeof(meta));
+    }
+    self->hash = h;
+    return 0;
+
+fail:
+    Py_DECREF(seq);
+    StructLayout_clear_fields(self);
+    return -1;
+}
+
+static void StructLayout_dealloc(StructLayout *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    StructLayout_clear_fields(self);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+static int layout_ready(StructLayout *self)
+{
+    if (self->index == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "StructLayout is not initialized");
+        return 0;
+    }
+    return 1;
+}
+
+static sfield *layout_field(StructLayout *self, PyObject *name)
+{
+    PyObject *num = PyDict_GetItemWithError(self->index, name);
+    if (num == NULL)
+    {
+        if (!PyErr_Occurred())
+            PyErr_Format(PyExc_AttributeError, "no field %R", name);
+        return NULL;
+    }
+    return &self->fields[PyLong_AsSsize_t(num)];
+}
+
+static PyObject *StructLayout_size(StructLayout *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!layout_ready(self))
+        return NULL;
+    return PyLong_FromUnsignedLong(self->size);
+}
+
+static PyObject *StructLayout_hash(StructLayout *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!layout_ready(self))
+        return NULL;
+    return PyLong_FromUnsignedLongLong(self->hash);
+}
+
+static PyObject *StructLayout_offset(StructLayout *self, PyObject *name)
+{
+    if (!layout_ready(self))
+        return NULL;
+    sfield *f = layout_field(self, name);
+    return f == NULL ? NULL : PyLong_FromUnsignedLong(f->offset);
+}
+
+static PyObject *StructLayout_fields(StructLayout *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!layout_ready(self))
+        return NULL;
+    PyObject *out = PyList_New(self->nfields);
+    if (out == NULL)
+        return NULL;
+    for (Py_ssize_t i = 0; i < self->nfields; i++)
+    {
+        sfield *f = &self->fields[i];
+        PyObject *t = Py_BuildValue("(OsII)", f->name, sfield_kinds[f->kind].name, (unsigned)f->count, (unsigned)f->offset);
+        if (t == NULL)
+        {
+            Py_DECREF(out);
+            return NULL;
+        }
+        PyList_SET_ITEM(out, i, t);
+    }
+    return out;
+}
+
+static PyMethodDef StructLayout_methods[] = {
+    {"size", (PyCFunction)StructLayout_size, METH_NOARGS, "bytes a SharedStruct with this layout needs"},
+    {"hash", (PyCFunction)StructLayout_hash, METH_NOARGS, "64-bit layout hash checked on attach"},
+    {"offset", (PyCFunction)StructLayout_offset, METH_O, "byte offset of a field"},
+    {"fields", (PyCFunction)StructLayout_fields, METH_NOARGS, "list of (name, kind, count, offset)"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *StructLayout_repr(PyObject *self)
+{
+    StructLayout *s = (StructLayout *)self;
+    return PyUnicode_FromFormat("<fastipc.StructLayout fields=%zd size=%u>", s->nfields, (unsigned)s->size);
+}
+
+static PyType_Slot StructLayout_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)StructLayout_init},
+    {Py_tp_dealloc, (void *)StructLayout_dealloc},
+    {Py_tp_methods, StructLayout_methods},
+    {Py_tp_repr, (void *)StructLayout_repr},
+    {0, NULL}};
+
+static PyType_Spec StructLayout_spec = {
+    .name = "fastipc.StructLayout",
+    .basicsize = sizeof(StructLayout),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = StructLayout_type_slots,
+};
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    StructLayout *layout;
+    int shared;
+    PyObject *prims; // tuple: per field, None or the Mutex/Semaphore object(s), built in __init__
+    PyObject *owner;
+} SharedStruct;
+
+// Build Mutex/Semaphore objects over the struct's embedded headers (done once, in __init__).
+static PyObject *sstruct_make_prims(SharedStruct *self, StructLayout *L, int shared, PyObject *owner)
+{
+    PyObject *module = PyType_GetModule(Py_TYPE(self));
+    if (module == NULL)
+        return NULL;
+    PyObject *prims = PyTuple_New(L->nfields);
+    if (prims == NULL)
+        return NULL;
+    for (Py_ssize_t i = 0; i < L->nfields; i++)
+    {
+        sfield *f = &L->fields[i];
+        if (!sfield_is_sync(f->kind))
+        {
+            Py_INCREF(Py_None);
+            PyTuple_SET_ITEM(prims, i, Py_None);
+            continue;
+        }
+        PyObject *tp = PyObject_GetAttrString(module, f->kind == SF_MUTEX ? "Mutex" : "Semaphore");
+        PyObject *items = tp != NULL ? PyTuple_New(f->count) : NULL;
+        for (uint32_t j = 0; items != NULL && j < f->count; j++)
+        {
+            PyObject *view = owner_slice(owner, (Py_ssize_t)f->offset + 64 * (Py_ssize_t)j, 64);
+            PyObject *obj = view != NULL ? (f->kind == SF_MUTEX ? PyObject_CallFunction(tp, "Oi", view, shared)
+                                                                     : PyObject_CallFunction(tp, "OOi", view, Py_None, shared)) : NULL;
+            Py_XDECREF(view);
+            if (obj == NULL)
+                Py_CLEAR(items);
+            else
+                PyTuple_SET_ITEM(items, j, obj);
+        }
+        Py_XDECREF(tp);
+        if (items == NULL)
+        {
+            Py_DECREF(prims);
+            return NULL;
+        }
+        if (f->count == 1)
+        {
+            PyObject *only = PyTuple_GET_ITEM(items, 0);
+            Py_INCREF(only);
+            Py_DECREF(items);
+            items = only;
+        }
+        PyTuple_SET_ITEM(prims, i, items);
+    }
+    return prims;
+}
+
+static void sstruct_format(uint8_t *base, StructLayout *L)
+{
+    memset(base + SSTRUCT_HDR, 0, L->size - SSTRUCT_HDR);
+    for (Py_ssize_t i = 0; i < L->nfields; i++)
+    {
+        sfield *f = &L->fields[i];
+        for (uint32_t j = 0; sfield_is_sync(f->kind) && j < f->count; j++)
+        {
+            if (f->kind == SF_MUTEX)
+                fipc_mutex_init(base + f->offset + 64u * j);
+            else
+                fipc_semaphore_init(base + f->offset + 64u * j, 0);
+        }
+    }
+    fipc_u64_store_unaligned(base, SSTRUCT_OFF_HASH, L->hash);
+    fipc_u32_store_rel(base, SSTRUCT_OFF_SIZE, L->size);
+    fipc_u32_store_rel(base, SSTRUCT_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+    fipc_u32_store_rel(base, 0, SSTRUCT_MAGIC);
+    __atomic_store_n(fipc_u32_at(base, SSTRUCT_OFF_STATE), SSTRUCT_READY, __ATOMIC_RELEASE);
+}
+
+static int SharedStruct_init(SharedStruct *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "layout", "shared", NULL};
+    PyObject *buf_obj, *layout_obj;
+    int shared = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "OO|p", kwlist, &buf_obj, &layout_obj, &shared))
+        return -1;
+    PyObject *module = PyType_GetModule(Py_TYPE(self));
+    if (module == NULL)
+        return -1;
+    PyObject *layout_tp = PyObject_GetAttrString(module, "StructLayout");
+    if (layout_tp == NULL)
+        return -1;
+    int ok = PyObject_TypeCheck(layout_obj, (PyTypeObject *)layout_tp);
+    Py_DECREF(layout_tp);
+    if (!ok)
+    {
+        PyErr_SetString(PyExc_TypeError, "layout must be a StructLayout");
+        return -1;
+    }
+    StructLayout *L = (StructLayout *)layout_obj;
+    if (!layout_ready(L))
+        return -1;
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_WRITABLE) < 0)
+        return -1;
+    if (!check_aligned(view.buf, view.len, L->size, 64))
+    {
+        PyBuffer_Release(&view);
+        PyErr_Format(PyExc_ValueError, "need a 64-byte aligned buffer of at least %u bytes for this layout", (unsigned)L->size);
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)view.buf;
+    PyBuffer_Release(&view);
+
+    // The first attacher formats; everyone else waits for it and checks the layout hash.
+    uint32_t *state = fipc_u32_at(base, SSTRUCT_OFF_STATE);
+    uint32_t forming = ((uint32_t)getpid() << 2) | SSTRUCT_FORMATTING;
+    uint32_t cur = 0;
+    if (__atomic_compare_exchange_n(state, &cur, forming, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        sstruct_format(base, L);
+    else
+    {
+        uint64_t deadline = fipc_now_monotonic_ns() + 5000000000ull;
+        while ((cur & 3) == SSTRUCT_FORMATTING)
+        {
+            // A formatter that died part way is replaced by the first attacher to notice.
+            if (fipc_pid_gone(cur >> 2) && __atomic_compare_exchange_n(state, &cur, forming, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                sstruct_format(base, L);
+                break;
+            }
+            if (fipc_now_monotonic_ns() > deadline)
+            {
+                PyErr_SetString(PyExc_TimeoutError, "SharedStruct is still being formatted");
+                return -1;
+            }
+            sched_yield();
+            cur = __atomic_load_n(state, __ATOMIC_ACQUIRE);
+        }
+        if (fipc_header_check(base, SSTRUCT_MAGIC) != 0)
+        {
+            PyErr_SetString(PyExc_ValueError, "buffer does not hold a SharedStruct");
+            return -1;
+        }
+        if (fipc_u64_load_unaligned(base, SSTRUCT_OFF_HASH) != L->hash)
+        {
+            PyErr_SetString(PyExc_ValueError, "SharedStruct layout hash mismatch: the buffer was formatted with a different layout");
+            return -1;
+        }
+    }
+
+    // Everything that can fail happens before the object is committed to this buffer.
+    PyObject *prims = sstruct_make_prims(self, L, shared ? 1 : 0, buf_obj);
+    if (prims == NULL)
+        return -1;
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        Py_DECREF(prims);
+        return -1;
+    }
+    self->base = base;
+    self->shared = shared ? 1 : 0;
+    self->prims = prims;
+    Py_INCREF(L);
+    self->layout = L;
+    return 0;
+}
+
+static void SharedStruct_dealloc(SharedStruct *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_XDECREF(self->prims);
+    Py_XDECREF(self->layout);
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+static inline uint8_t *sstruct_elem(SharedStruct *self, sfield *f, uint32_t j)
+{
+    return self->base + f->offset + (size_t)j * sfield_kinds[f->kind].size;
+}
+
+// Look up a numeric field element; sets an exception and returns NULL on a bad name/index.
+static sfield *sstruct_numeric(SharedStruct *self, PyObject *name, Py_ssize_t index, uint8_t **p)
+{
+    if (self->layout == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "SharedStruct is not initialized");
+        return NULL;
+    }
+    sfield *f = layout_field(self->layout, name);
+    if (f == NULL)
+        return NULL;
+    if (sfield_is_sync(f->kind))
+    {
+        PyErr_Format(PyExc_TypeError, "field %R is a %s, not a number", name, sfield_kinds[f->kind].name);
+        return NULL;
+    }
+    if (index < 0 || index >= (Py_ssize_t)f->count)
+    {
+        PyErr_Format(PyExc_IndexError, "index out of range for field %R", name);
+        return NULL;
+    }
+    *p = sstruct_elem(self, f, (uint32_t)index);
+    return f;
+}
+
+static PyObject *sstruct_read(int kind, const uint8_t *p)
+{
+    switch (kind)
+    {
+    case SF_U8:
+        return PyLong_FromUnsignedLong(*p);
+    case SF_I8:
+        return PyLong_FromLong(*(const int8_t *)p);
+    case SF_U16:
+    {
+        uint16_t v;
+        memcpy(&v, p, 2);
+        return PyLong_FromUnsignedLong(v);
+    }
+    case SF_I16:
+    {
+        int16_t v;
+        memcpy(&v, p, 2);
+        return PyLong_FromLong(v);
+    }
+    case SF_U32:
+    {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return PyLong_FromUnsignedLong(v);
+    }
+    case SF_I32:
+    {
+        int32_t v;
+        memcpy(&v, p, 4);
+        return PyLong_FromLong(v);
+    }
+    case SF_U64:
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return PyLong_FromUnsignedLongLong(v);
+    }
+    case SF_I64:
+    {
+        int64_t v;
+        memcpy(&v, p, 8);
+        return PyLong_FromLongLong(v);
+    }
+    case SF_F32:
+    {
+        float v;
+        memcpy(&v, p, 4);
+        return PyFloat_FromDouble(v);
+    }
+    case SF_F64:
+    {
+        double v;
+        memcpy(&v, p, 8);
+        return PyFloat_FromDouble(v);
+    }
+    case SF_ATOMIC_U32:
+    case SF_FUTEX:
+        return PyLong_FromUnsignedLong(__atomic_load_n((const uint32_t *)p, __ATOMIC_ACQUIRE));
+    case SF_ATOMIC_U64:
+        return PyLong_FromUnsignedLongLong(__atomic_load_n((const uint64_t *)p, __ATOMIC_ACQUIRE));
+    }
+    Py_RETURN_NONE;
+}
+
+// Convert `v` for an integer kind of `size` bytes; unsigned kinds wrap-check against their width.
+static int sstruct_int(PyObject *v, int is_signed, uint32_t size, uint64_t *out)
+{
+    if (is_signed)
+    {
+        long long x = PyLong_AsLongLong(v);
+        if (x == -1 && PyErr_Occurred())
+            return -1;
+        long long lim = size == 8 ? LLONG_MAX : (1LL << (8 * size - 1)) - 1;
+        if (x > lim || x < -lim - 1)
+            goto range;
+        *out = (uint64_t)x;
+        return 0;
+    }
+    unsigned long long x = PyLong_AsUnsignedLongLong(v);
+    if (x == (unsigned long long)-1 && PyErr_Occurred())
+        return -1;
+    if (size < 8 && x >> (8 * size))
+        goto range;
+    *out = x;
+    return 0;
+range:
+    PyErr_Format(PyExc_OverflowError, "value out of range for a %u-byte field", (unsigned)size);
+    return -1;
+}
+
+static int sstruct_write(int kind, uint8_t *p, PyObject *v)
+{
+    uint32_t size = sfield_kinds[kind].size;
+    if (kind == SF_F32 || kind == SF_F64)
+    {
+        double d = PyFloat_AsDouble(v);
+        if (d == -1.0 && PyErr_Occurred())
+            return -1;
+        if (kind == SF_F32)
+        {
+            float f = (float)d;
+            memcpy(p, &f, 4);
+        }
+        else
+            memcpy(p, &d, 8);
+        return 0;
+    }
+    uint64_t x;
+    int is_signed = kind == SF_I8 || kind == SF_I16 || kind == SF_I32 || kind == SF_I64;
+    if (sstruct_int(v, is_signed, size, &x) < 0)
+        return -1;
+    if (kind == SF_ATOMIC_U32 || kind == SF_FUTEX)
+        __atomic_store_n((uint32_t *)p, (uint32_t)x, __ATOMIC_RELEASE);
+    else if (kind == SF_ATOMIC_U64)
+        __atomic_store_n((uint64_t *)p, x, __ATOMIC_RELEASE);
+    else
+        switch (size)
+        {
+        case 1:
+            *p = (uint8_t)x;
+            break;
+        case 2:
+        {
+            uint16_t w = (uint16_t)x;
+            memcpy(p, &w, 2);
+            break;
+        }
+        case 4:
+        {
+            uint32_t w = (uint32_t)x;
+            memcpy(p, &w, 4);
+            break;
+        }
+        default:
+            memcpy(p, &x, 8);
+        }
+    return 0;
+}
+
+static PyObject *SharedStruct_getattro(SharedStruct *self, PyObject *name)
+{
+    if (self->layout != NULL && PyUnicode_Check(name))
+    {
+        PyObject *num = PyDict_GetItemWithError(self->layout->index, name);
+        if (num != NULL)
+        {
+            Py_ssize_t i = PyLong_AsSsize_t(num);
+            sfield *f = &self->layout->fields[i];
+            if (sfield_is_sync(f->kind))
+            {
+                PyObject *obj = PyTuple_GET_ITEM(self->prims, i);
+                Py_INCREF(obj);
+                return obj;
+            }
+            if (f->count == 1)
+                return sstruct_read(f->kind, sstruct_elem(self, f, 0));
+            if (sfield_is_word(f->kind))
+            {
+                PyObject *t = PyTuple_New(f->count);
+                for (uint32_t j = 0; t != NULL && j < f->count; j++)
+                {
+                    PyObject *v = sstruct_read(f->kind, sstruct_elem(self, f, j));
+                    if (v == NULL)
+                        Py_CLEAR(t);
+                    else
+                        PyTuple_SET_ITEM(t, j, v);
+                }
+                return t;
+            }
+            // Plain arrays: a writable, zero-copy typed view.
+            PyObject *raw = owner_slice(self->owner, f->offset, (Py_ssize_t)sfield_kinds[f->kind].size * f->count);
+            if (raw == NULL)
+                return NULL;
+            char fmt[2] = {sfield_kinds[f->kind].format, 0};
+            PyObject *typed = PyObject_CallMethod(raw, "cast", "s", fmt);
+            Py_DECREF(raw);
+            return typed;
+        }
+        if (PyErr_Occurred())
+            return NULL;
+    }
+    return PyObject_GenericGetAttr((PyObject *)self, name);
+}
+
+static int SharedStruct_setattro(SharedStruct *self, PyObject *name, PyObject *value)
+{
+    if (self->layout != NULL && PyUnicode_Check(name))
+    {
+        PyObject *num = PyDict_GetItemWithError(self->layout->index, name);
+        if (num != NULL)
+        {
+            sfield *f = &self->layout->fields[PyLong_AsSsize_t(num)];
+            if (value == NULL || sfield_is_sync(f->kind) || f->count != 1)
+            {
+                PyErr_Format(PyExc_AttributeError, "field %R cannot be assigned (use store() or its view)", name);
+                return -1;
+            }
+            return sstruct_write(f->kind, sstruct_elem(self, f, 0), value);
+        }
+        if (PyErr_Occurred())
+            return -1;
+    }
+    return PyObject_GenericSetAttr((PyObject *)self, name, value);
+}
+
+static PyObject *SharedStruct_load(SharedStruct *self, PyObject *args)
+{
+    PyObject *name;
+    Py_ssize_t index = 0;
+    uint8_t *p;
+    if (!PyArg_ParseTuple(args, "U|n", &name, &index))
+        return NULL;
+    sfield *f = sstruct_numeric(self, name, index, &p);
+    return f == NULL ? NULL : sstruct_read(f->kind, p);
+}
+
+static PyObject *SharedStruct_store(SharedStruct *self, PyObject *args)
+{
+    PyObject *name, *value;
+    Py_ssize_t index = 0;
+    uint8_t *p;
+    if (!PyArg_ParseTuple(args, "UO|n", &name, &value, &index))
+        return NULL;
+    sfield *f = sstruct_numeric(self, name, index, &p);
+    if (f == NULL || sstruct_write(f->kind, p, value) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static sfield *sstruct_atomic(SharedStruct *self, PyObject *name, Py_ssize_t index, uint8_t **p)
+{
+    sfield *f = sstruct_numeric(self, name, index, p);
+    if (f != NULL && !sfield_is_word(f->kind))
+    {
+        PyErr_Format(PyExc_TypeError, "field %R is not an atomic or futex field", name);
+        return NULL;
+    }
+    return f;
+}
+
+static PyObject *SharedStruct_fetch_add(SharedStruct *self, PyObject *args)
+{
+    PyObject *name, *delta;
+    Py_ssize_t index = 0;
+    uint8_t *p;
+    if (!PyArg_ParseTuple(args, "UO|n", &name, &delta, &index))
+        return NULL;
+    sfield *f = sstruct_atomic(self, name, index, &p);
+    if (f == NULL)
+        return NULL;
+    // Deltas wrap modulo the field width, so negative values subtract.
+    unsigned long long d = PyLong_AsUnsignedLongLongMask(delta);
+    if (d == (unsigned long long)-1 && PyErr_Occurred())
+        return NULL;
+    if (f->kind == SF_ATOMIC_U64)
+        return PyLong_FromUnsignedLongLong(__atomic_fetch_add((uint64_t *)p, (uint64_t)d, __ATOMIC_ACQ_REL));
+    return PyLong_FromUnsignedLong(__atomic_fetch_add((uint32_t *)p, (uint32_t)d, __ATOMIC_ACQ_REL));
+}
+
+static PyObject *SharedStruct_cas(SharedStruct *self, PyObject *args)
+{
+    PyObject *name;
+    unsigned long long expected, desired;
+    Py_ssize_t index = 0;
+    uint8_t *p;
+    if (!PyArg_ParseTuple(args, "UKK|n", &name, &expected, &desired, &index))
+        return NULL;
+    sfield *f = sstruct_atomic(self, name, index, &p);
+    if (f == NULL)
+        return NULL;
+    bool ok;
+    if (f->kind == SF_ATOMIC_U64)
+    {
+        uint64_t e = expected;
+        ok = __atomic_compare_exchange_n((uint64_t *)p, &e, (uint64_t)desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+    else
+    {
+        if (expected > UINT32_MAX || desired > UINT32_MAX)
+        {
+            PyErr_SetString(PyExc_OverflowError, "value out of range for a 4-byte field");
+            return NULL;
+        }
+        uint32_t e = (uint32_t)expected;
+        ok = __atomic_compare_exchange_n((uint32_t *)p, &e, (uint32_t)desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+    return PyBool_FromLong(ok);
+}
+
+static PyObject *SharedStruct_wait(SharedStruct *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"name", "expected", "timeout_ns", "index", NULL};
+    PyObject *name;
+    uint32_t expected;
+    long long timeout_ns = -1;
+    Py_ssize_t index = 0;
+    uint8_t *p;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UI|Ln", kwlist, &name, &expected, &timeout_ns, &index))
+        return NULL;
+    sfield *f = sstruct_atomic(self, name, index, &p);
+    if (f == NULL)
+        return NULL;
+    if (f->kind == SF_ATOMIC_U64)
+    {
+        PyErr_Format(PyExc_TypeError, "field %R is 64-bit; futex waits need a 32-bit word", name);
+        return NULL;
+    }
+    // Same contract as FutexWord.wait: True only when woken.
+    for (;;)
+    {
+        int rc;
+        Py_BEGIN_ALLOW_THREADS
+        rc = fipc_futex_wait((uint32_t *)p, expected, timeout_ns, self->shared);
+        Py_END_ALLOW_THREADS
+        if (rc == 0)
+            Py_RETURN_TRUE;
+        if (rc == -EAGAIN || rc == -ETIMEDOUT || (rc == -EINTR && timeout_ns >= 0))
+            Py_RETURN_FALSE;
+        if (rc != -EINTR)
+        {
+            errno = -rc;
+            return PyErr_SetFromErrno(PyExc_OSError);
+        }
+    }
+}
+
+static PyObject *SharedStruct_wake(SharedStruct *self, PyObject *args)
+{
+    PyObject *name;
+    int n = 1;
+    Py_ssize_t index = 0;
+    uint8_t *p;
+    if (!PyArg_ParseTuple(args, "U|in", &name, &n, &index))
+        return NULL;
+    sfield *f = sstruct_atomic(self, name, index, &p);
+    if (f == NULL)
+        return NULL;
+    if (f->kind == SF_ATOMIC_U64)
+    {
+        PyErr_Format(PyExc_TypeError, "field %R is 64-bit; futex wakes need a 32-bit word", name);
+        return NULL;
+    }
+    return PyLong_FromLong(fipc_futex_wake((uint32_t *)p, n, self->shared));
+}
+
+static PyObject *SharedStruct_load_fields(SharedStruct *self, PyObject *arg)
+{
+    PyObject *seq = PySequence_Fast(arg, "load_fields() expects a sequence of field names");
+    if (seq == NULL)
+        return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    PyObject *out = PyTuple_New(n);
+    for (Py_ssize_t j = 0; out != NULL && j < n; j++)
+    {
+        PyObject *name = PySequence_Fast_GET_ITEM(seq, j);
+        uint8_t *p;
+        sfield *f = PyUnicode_Check(name) ? sstruct_numeric(self, name, 0, &p) : NULL;
+        if (f != NULL && f->count != 1)
+        {
+            PyErr_Format(PyExc_TypeError, "field %R is an array", name);
+            f = NULL;
+        }
+        if (f == NULL && !PyErr_Occurred())
+            PyErr_SetString(PyExc_TypeError, "field names must be str");
+        PyObject *v = f != NULL ? sstruct_read(f->kind, p) : NULL;
+        if (v == NULL)
+            Py_CLEAR(out);
+        else
+            PyTuple_SET_ITEM(out, j, v);
+    }
+    Py_DECREF(seq);
+    return out;
+}
+
+static int sstruct_store_items(SharedStruct *self, PyObject *mapping)
+{
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(mapping, &pos, &key, &value))
+    {
+        uint8_t *p;
+        sfield *f = PyUnicode_Check(key) ? sstruct_numeric(self, key, 0, &p) : NULL;
+        if (f != NULL && f->count != 1)
+        {
+            PyErr_Format(PyExc_TypeError, "field %R is an array", key);
+            return -1;
+        }
+        if (f == NULL)
+        {
+            if (!PyErr_Occurred())
+                PyErr_SetString(PyExc_TypeError, "field names must be str");
+            return -1;
+        }
+        if (sstruct_write(f->kind, p, value) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static PyObject *SharedStruct_store_fields(SharedStruct *self, PyObject *args, PyObject *kw)
+{
+    PyObject *mapping = NULL;
+    if (!PyArg_ParseTuple(args, "|O!", &PyDict_Type, &mapping))
+        return NULL;
+    if (mapping != NULL && sstruct_store_items(self, mapping) < 0)
+        return NULL;
+    if (kw != NULL && sstruct_store_items(self, kw) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *SharedStruct_get_layout(SharedStruct *self, void *Py_UNUSED(closure))
+{
+    if (self->layout == NULL)
+        Py_RETURN_NONE;
+    Py_INCREF(self->layout);
+    return (PyObject *)self->layout;
+}
+
+static PyMethodDef SharedStruct_methods[] = {
+    {"load", (PyCFunction)SharedStruct_load, METH_VARARGS, "load(name, index=0): read one element"},
+    {"store", (PyCFunction)SharedStruct_store, METH_VARARGS, "store(name, value, index=0): write one element"},
+    {"fetch_add", (PyCFunction)SharedStruct_fetch_add, METH_VARARGS, "fetch_add(name, delta, index=0) -> previous value"},
+    {"cas", (PyCFunction)SharedStruct_cas, METH_VARARGS, "cas(name, expected, desired, index=0) -> bool"},
+    {"wait", PyCFunction_CAST(SharedStruct_wait), METH_VARARGS | METH_KEYWORDS, "futex wait on a 32-bit word while it equals expected"},
+    {"wake", (PyCFunction)SharedStruct_wake, METH_VARARGS, "wake(name, n=1, index=0) -> number woken"},
+    {"load_fields", (PyCFunction)SharedStruct_load_fields, METH_O, "tuple of values for several scalar fields"},
+    {"store_fields", PyCFunction_CAST(SharedStruct_store_fields), METH_VARARGS | METH_KEYWORDS, "write several scalar fields"},
+    {NULL, NULL, 0, NULL}};
+
+static PyGetSetDef SharedStruct_getset[] = {
+    {"layout", (getter)SharedStruct_get_layout, NULL, "the StructLayout of this view", NULL},
+    {NULL, NULL, NULL, NULL, NULL}};
+
+static PyObject *SharedStruct_repr(PyObject *self)
+{
+    SharedStruct *s = (SharedStruct *)self;
+    return PyUnicode_FromFormat("<fastipc.SharedStruct buf=%p size=%u>", (void *)s->base, s->layout ? (unsigned)s->layout->size : 0u);
+}
+
+static PyType_Slot SharedStruct_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)SharedStruct_init},
+    {Py_tp_dealloc, (void *)SharedStruct_dealloc},
+    {Py_tp_getattro, (void *)SharedStruct_getattro},
+    {Py_tp_setattro, (void *)SharedStruct_setattro},
+    {Py_tp_methods, SharedStruct_methods},
+    {Py_tp_getset, SharedStruct_getset},
+    {Py_tp_repr, (void *)SharedStruct_repr},
+    {0, NULL}};
+
+static PyType_Spec SharedStruct_spec = {
+    .name = "fastipc.SharedStruct",
+    .basicsize = sizeof(SharedStruct),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = SharedStruct_type_slots,
+};
+
+// ---------- WorkStealingDeque ----------
+// Chase-Lev deque over a caller buffer (Le et al., "Correct and Efficient Work-Stealing for
+// Weak Memory Models"), with a fixed ring instead of a growable array. The owner pushes and
+// pops at the bottom with plain loads/stores plus a fence; thieves CAS the top.
+// Layout:
+//   0x00: u32 magic ('WSDQ'), u32 layout version, u32 capacity (power of two), u32 item size
+//   0x10: u32 state (0=unformatted, 1=ready)
+//   0x40: i64 top (thieves' end, own cache line)
+//   0x80: i64 bottom (owner's end, own cache line)
+//   0xC0: capacity slots of item size bytes, 8-byte strided
+// The optional idle word (a separate 4-byte buffer shared by a group of deques) is an epoch in
+// steps of 2 with bit 0 set while some thief is parked on it.
+#define WSDQ_MAGIC 0x51445357u /* 'WSDQ' */
+#define WSDQ_OFF_VERSION 4u
+#define WSDQ_OFF_CAPACITY 8u
+#define WSDQ_OFF_ITEMSIZE 12u
+#define WSDQ_OFF_STATE 16u
+#define WSDQ_OFF_TOP 64u
+#define WSDQ_OFF_BOTTOM 128u
+#define WSDQ_OFF_SLOTS 192u
+#define WSDQ_MAX_CAPACITY (1u << 30)
+
+static inline size_t wsdq_stride(size_t item_size) { return (item_size + 7) & ~(size_t)7; }
+static inline size_t wsdq_required_size(size_t capacity, size_t item_size) { return WSDQ_OFF_SLOTS + capacity * wsdq_stride(item_size); }
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    int64_t *top;
+    int64_t *bottom;
+    uint8_t *slots;
+    uint32_t *idle; // NULL when no idle word was given
+    uint32_t mask;
+    uint32_t item_size;
+    uint32_t stride;
+    PyObject *owner;
+    PyObject *idle_owner;
+} WorkStealingDeque;
+
+static inline uint8_t *wsdq_slot(WorkStealingDeque *self, int64_t i)
+{
+    return self->slots + (size_t)((uint64_t)i & self->mask) * self->stride;
+}
+
+static int WorkStealingDeque_init(WorkStealingDeque *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "capacity", "item_size", "idle", NULL};
+    PyObject *buf_obj, *idle_obj = Py_None;
+    Py_ssize_t capacity = 0, item_size = 8;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|nnO", kwlist, &buf_obj, &capacity, &item_size, &idle_obj))
+        return -1;
+    if (capacity < 0 || capacity > WSDQ_MAX_CAPACITY || (capacity & (capacity - 1)) != 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "capacity must be 0 (attach) or a power of two up to 2**30");
+        return -1;
+    }
+    if (item_size <= 0 || item_size > UINT32_MAX / 2)
+    {
+        PyErr_SetString(PyExc_ValueError, "item_size out of range");
+        return -1;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_WRITABLE) < 0)
+        return -1;
+    if (!check_aligned(view.buf, view.len, WSDQ_OFF_SLOTS, 64))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "need 64-byte aligned >=192 buffer for WorkStealingDeque");
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)view.buf;
+    // capacity > 0 formats a fresh deque; 0 attaches to a formatted one.
+    int format = capacity > 0;
+    if (!format)
+    {
+        if (fipc_u32_load_acq(base, WSDQ_OFF_STATE) == 0 || fipc_header_check(base, WSDQ_MAGIC) != 0)
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "buffer does not hold a formatted WorkStealingDeque");
+            return -1;
+        }
+        capacity = fipc_u32_load_acq(base, WSDQ_OFF_CAPACITY);
+        item_size = fipc_u32_load_acq(base, WSDQ_OFF_ITEMSIZE);
+    }
+    if ((size_t)view.len < wsdq_required_size((size_t)capacity, (size_t)item_size))
+    {
+        PyBuffer_Release(&view);
+        PyErr_Format(PyExc_ValueError, "buffer too small for %zd slots of %zd bytes", capacity, item_size);
+        return -1;
+    }
+
+    uint32_t *idle = NULL;
+    if (idle_obj != Py_None)
+    {
+        Py_buffer iv;
+        if (PyObject_GetBuffer(idle_obj, &iv, PyBUF_WRITABLE) < 0)
+        {
+            PyBuffer_Release(&view);
+            return -1;
+        }
+        idle = (uint32_t *)iv.buf;
+        int ok = check_aligned(iv.buf, iv.len, 4, 4);
+        PyBuffer_Release(&iv);
+        if (!ok)
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "need 4-byte aligned >=4 buffer for the idle word");
+            return -1;
+        }
+    }
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
+    if (idle != NULL)
+    {
+        Py_INCREF(idle_obj);
+        self->idle_owner = idle_obj;
+    }
+    self->base = base;
+    self->top = (int64_t *)(base + WSDQ_OFF_TOP);
+    self->bottom = (int64_t *)(base + WSDQ_OFF_BOTTOM);
+    self->slots = base + WSDQ_OFF_SLOTS;
+    self->idle = idle;
+    self->mask = (uint32_t)capacity - 1;
+    self->item_size = (uint32_t)item_size;
+    self->stride = (uint32_t)wsdq_stride((size_t)item_size);
+    if (format)
+    {
+        __atomic_store_n(self->top, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(self->bottom, 0, __ATOMIC_RELAXED);
+        fipc_u32_store_rel(base, WSDQ_OFF_CAPACITY, (uint32_t)capacity);
+        fipc_u32_store_rel(base, WSDQ_OFF_ITEMSIZE, (uint32_t)item_size);
+        fipc_u32_store_rel(base, WSDQ_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+        fipc_u32_store_rel(base, 0, WSDQ_MAGIC);
+        fipc_u32_store_rel(base, WSDQ_OFF_STATE, 1);
+    }
+    PyBuffer_Release(&view);
+    return 0;
+}
+
+static void WorkStealingDeque_dealloc(WorkStealingDeque *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_XDECREF(self->idle_owner);
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+static int wsdq_ready(WorkStealingDeque *self)
+{
+    if (self->base == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "WorkStealingDeque is not initialized");
+        return 0;
+    }
+    return 1;
+}
+
+// Wake parked thieves after a push; only touches the idle word with an RMW when one sleeps.
+static inline void wsdq_notify(WorkStealingDeque *self)
+{
+    // Pairs with the fence in prepare_park: either the thief sees our bottom or we see its bit.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint32_t v = __atomic_load_n(self->idle, __ATOMIC_RELAXED);
+    if ((v & 1u) && __atomic_compare_exchange_n(self->idle, &v, (v + 2u) & ~1u, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        fipc_futex_wake(self->idle, INT_MAX, 1);
+}
+
+static PyObject *WorkStealingDeque_push(WorkStealingDeque *self, PyObject *item)
+{
+    if (!wsdq_ready(self))
+        return NULL;
+    Py_buffer in;
+    if (PyObject_GetBuffer(item, &in, PyBUF_SIMPLE) < 0)
+        return NULL;
+    if (in.len != (Py_ssize_t)self->item_size)
+    {
+        PyBuffer_Release(&in);
+        PyErr_Format(PyExc_ValueError, "items are %u bytes, got %zd", (unsigned)self->item_size, in.len);
+        return NULL;
+    }
+    int64_t b = __atomic_load_n(self->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(self->top, __ATOMIC_ACQUIRE);
+    if (b - t > (int64_t)self->mask)
+    {
+        PyBuffer_Release(&in);
+        Py_RETURN_FALSE;
+    }
+    memcpy(wsdq_slot(self, b), in.buf, self->item_size);
+    PyBuffer_Release(&in);
+    __atomic_store_n(self->bottom, b + 1, __ATOMIC_RELEASE);
+    if (self->idle != NULL)
+        wsdq_notify(self);
+    Py_RETURN_TRUE;
+}
+
+static PyObject *WorkStealingDeque_pop(WorkStealingDeque *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!wsdq_ready(self))
+        return NULL;
+    int64_t b = __atomic_load_n(self->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(self->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(self->top, __ATOMIC_RELAXED);
+    if (t > b)
+    {
+        // Empty: undo the reservation.
+        __atomic_store_n(self->bottom, b + 1, __ATOMIC_RELAXED);
+        Py_RETURN_NONE;
+    }
+    PyObject *out = PyBytes_FromStringAndSize((const char *)wsdq_slot(self, b), self->item_size);
+    if (t == b)
+    {
+        // Last item: race the thieves for it.
+        if (!__atomic_compare_exchange_n(self->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            Py_CLEAR(out);
+        __atomic_store_n(self->bottom, b + 1, __ATOMIC_RELAXED);
+        if (out == NULL && !PyErr_Occurred())
+            Py_RETURN_NONE;
+    }
+    return out;
+}
+
+// One Chase-Lev steal into `dst`: 1 on success, 0 if empty, -1 if another thread won the race.
+static inline int wsdq_steal_one(WorkStealingDeque *self, uint8_t *dst)
+{
+    int64_t t = __atomic_load_n(self->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(self->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b)
+        return 0;
+    // The copy may race with the owner reusing the slot; the CAS fails in that case.
+    memcpy(dst, wsdq_slot(self, t), self->item_size);
+    if (!__atomic_compare_exchange_n(self->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return -1;
+    return 1;
+}
+
+static PyObject *WorkStealingDeque_steal(WorkStealingDeque *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!wsdq_ready(self))
+        return NULL;
+    PyObject *out = PyBytes_FromStringAndSize(NULL, self->item_size);
+    if (out == NULL)
+        return NULL;
+    int rc;
+    while ((rc = wsdq_steal_one(self, (uint8_t *)PyBytes_AS_STRING(out))) < 0)
+        ;
+    if (rc == 0)
+    {
+        Py_DECREF(out);
+        Py_RETURN_NONE;
+    }
+    return out;
+}
+
+static PyObject *WorkStealingDeque_steal_half(WorkStealingDeque *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"max_items", NULL};
+    Py_ssize_t max_items = PY_SSIZE_T_MAX;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "|n", kwlist, &max_items))
+        return NULL;
+    if (!wsdq_ready(self))
+        return NULL;
+    // Grabbing a whole range with one CAS would race the owner's CAS-free pops, so the half
+    // is taken item by item; each item is still claimed by a single CAS.
+    int64_t t = __atomic_load_n(self->top, __ATOMIC_ACQUIRE);
+    int64_t b = __atomic_load_n(self->bottom, __ATOMIC_ACQUIRE);
+    int64_t want = (b - t + 1) / 2;
+    if (want > max_items)
+        want = max_items;
+    if (want <= 0)
+        return PyList_New(0);
+    // Allocate the list and every item before the first CAS: once an item is claimed it
+    // cannot be handed back, so nothing after a claim may fail.
+    PyObject *out = PyList_New((Py_ssize_t)want);
+    if (out == NULL)
+        return NULL;
+    for (Py_ssize_t i = 0; i < want; i++)
+    {
+        PyObject *item = PyBytes_FromStringAndSize(NULL, self->item_size);
+        if (item == NULL)
+        {
+            Py_DECREF(out);
+            return NULL;
+        }
+        PyList_SET_ITEM(out, i, item);
+    }
+    Py_ssize_t n = 0;
+    while (n < want)
+    {
+        int rc = wsdq_steal_one(self, (uint8_t *)PyBytes_AS_STRING(PyList_GET_ITEM(out, n)));
+        if (rc == 0)
+            break;
+        if (rc > 0)
+            n++;
+    }
+    // Drop the unused tail; shrinking the size in place cannot fail.
+    for (Py_ssize_t i = n; i < want; i++)
+        Py_DECREF(PyList_GET_ITEM(out, i));
+    Py_SET_SIZE(out, n);
+    return out;
+}
+
+static PyObject *WorkStealingDeque_size(WorkStealingDeque *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!wsdq_ready(self))
+        return NULL;
+    int64_t b = __atomic_load_n(self->bottom, __ATOMIC_ACQUIRE);
+    int64_t t = __atomic_load_n(self->top, __ATOMIC_ACQUIRE);
+    return PyLong_FromLongLong(b > t ? b - t : 0);
+}
+
+static PyObject *WorkStealingDeque_capacity(WorkStealingDeque *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!wsdq_ready(self))
+        return NULL;
+    return PyLong_FromUnsignedLong((unsigned long)self->mask + 1);
+}
+
+static PyObject *WorkStealingDeque_item_size(WorkStealingDeque *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!wsdq_ready(self))
+        return NULL;
+    return PyLong_FromUnsignedLong(self->item_size);
+}
+
+static int wsdq_has_idle(WorkStealingDeque *self)
+{
+    if (!wsdq_ready(self))
+        return 0;
+    if (self->idle == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "this deque was created without an idle word");
+        return 0;
+    }
+    return 1;
+}
+
+static PyObject *WorkStealingDeque_prepare_park(WorkStealingDeque *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!wsdq_has_idle(self))
+        return NULL;
+    uint32_t v = __atomic_load_n(self->idle, __ATOMIC_RELAXED);
+    while (!(v & 1u) && !__atomic_compare_exchange_n(self->idle, &v, v | 1u, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        ;
+    // Pairs with the fence in push: a push we miss in the re-scan will see the bit and wake us.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return PyLong_FromUnsignedLong(v | 1u);
+}
+
+static PyObject *WorkStealingDeque_park(WorkStealingDeque *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"token", "timeout_ns", NULL};
+    uint32_t token;
+    long long timeout_ns = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "I|L", kwlist, &token, &timeout_ns))
+        return NULL;
+    if (!wsdq_has_idle(self))
+        return NULL;
+    for (;;)
+    {
+        int rc;
+        Py_BEGIN_ALLOW_THREADS
+        rc = fipc_futex_wait(self->idle, token, timeout_ns, 1);
+        Py_END_ALLOW_THREADS
+        // Woken, or a push already moved the epoch on: go look for work.
+        if (rc == 0 || rc == -EAGAIN)
+            Py_RETURN_TRUE;
+        if (rc == -ETIMEDOUT || (rc == -EINTR && timeout_ns >= 0))
+            Py_RETURN_FALSE;
+        if (rc != -EINTR)
+        {
+            errno = -rc;
+            return PyErr_SetFromErrno(PyExc_OSError);
+        }
+    }
+}
+
+static PyObject *WorkStealingDeque_required_size(PyObject *Py_UNUSED(cls), PyObject *args)
+{
+    Py_ssize_t capacity, item_size = 8;
+    if (!PyArg_ParseTuple(args, "n|n", &capacity, &item_size))
+        return NULL;
+    if (capacity <= 0 || capacity > WSDQ_MAX_CAPACITY || (capacity & (capacity - 1)) != 0 || item_size <= 0 || item_size > UINT32_MAX / 2)
+    {
+        PyErr_SetString(PyExc_ValueError, "capacity or item_size out of range");
+        return NULL;
+    }
+    return PyLong_FromSize_t(wsdq_required_size((size_t)capacity, (size_t)item_size));
+}
+
+static PyMethodDef WorkStealingDeque_methods[] = {
+    {"push", (PyCFunction)WorkStealingDeque_push, METH_O, "owner: push an item at the bottom; False when full"},
+    {"pop", (PyCFunction)WorkStealingDeque_pop, METH_NOARGS, "owner: pop the newest item, or None"},
+    {"steal", (PyCFunction)WorkStealingDeque_steal, METH_NOARGS, "thief: take the oldest item, or None"},
+    {"steal_half", PyCFunction_CAST(WorkStealingDeque_steal_half), METH_VARARGS | METH_KEYWORDS, "thief: take up to half of the items"},
+    {"size", (PyCFunction)WorkStealingDeque_size, METH_NOARGS, "approximate number of items"},
+    {"capacity", (PyCFunction)WorkStealingDeque_capacity, METH_NOARGS, "number of slots"},
+    {"item_size", (PyCFunction)WorkStealingDeque_item_size, METH_NOARGS, "bytes per item"},
+    {"prepare_park", (PyCFunction)WorkStealingDeque_prepare_park, METH_NOARGS, "announce a parking thief; returns the token for park()"},
+    {"park", PyCFunction_CAST(WorkStealingDeque_park), METH_VARARGS | METH_KEYWORDS, "sleep on the idle word until a push"},
+    {"required_size", (PyCFunction)WorkStealingDeque_required_size, METH_VARARGS | METH_STATIC, "buffer bytes needed for capacity items"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *WorkStealingDeque_repr(PyObject *self)
+{
+    WorkStealingDeque *s = (WorkStealingDeque *)self;
+    return PyUnicode_FromFormat("<fastipc.WorkStealingDeque buf=%p capacity=%u item_size=%u>", (void *)s->base,
+                                s->base ? (unsigned)s->mask + 1 : 0u, (unsigned)s->item_size);
+}
+
+static PyType_Slot WorkStealingDeque_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)WorkStealingDeque_init},
+    {Py_tp_dealloc, (void *)WorkStealingDeque_dealloc},
+    {Py_tp_methods, WorkStealingDeque_methods},
+    {Py_tp_repr, (void *)WorkStealingDeque_repr},
+    {0, NULL}};
+
+static PyType_Spec WorkStealingDeque_spec = {
+    .name = "fastipc.WorkStealingDeque",
+    .basicsize = sizeof(WorkStealingDeque),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = WorkStealingDeque_type_slots,
+};
+
+// ---------- AtomicBitset ----------
+// A shared bitmap of claimable indices (1 = taken). Claims scan a word at a time with ctz and
+// CAS the word; each object starts at its own rotating hint so claimers spread out.
+// Layout:
+//   0x00: u32 magic ('ABIT'), u32 layout version, u32 nbits, u32 state (0=unformatted, 1=ready)
+//   0x10: u32 free epoch (futex): +2 per release while bit 0 says someone waits for a free bit
+//   0x40: u64 words[ceil(nbits / 64)]
+#define ABIT_MAGIC 0x54494241u /* 'ABIT' */
+#define ABIT_OFF_VERSION 4u
+#define ABIT_OFF_NBITS 8u
+#define ABIT_OFF_STATE 12u
+#define ABIT_OFF_EPOCH 16u
+#define ABIT_OFF_WORDS 64u
+
+static inline size_t abit_required_size(size_t nbits) { return ABIT_OFF_WORDS + (nbits + 63) / 64 * 8; }
+
+typedef struct
+{
+    PyObject_HEAD uint8_t *base;
+    uint64_t *words;
+    uint32_t *epoch;
+    uint32_t nbits;
+    uint32_t nwords;
+    uint32_t hint; // per object, relaxed: a stale hint only costs a longer scan
+    int shared;
+    PyObject *owner;
+} AtomicBitset;
+
+// Bits of word w that map to real indices (the last word may be partial).
+static inline uint64_t abit_valid(AtomicBitset *self, uint32_t w)
+{
+    uint32_t tail = self->nbits - w * 64u;
+    return tail >= 64 ? ~0ull : (1ull << tail) - 1;
+}
+
+static int AtomicBitset_init(AtomicBitset *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"buffer", "nbits", "shared", NULL};
+    PyObject *buf_obj;
+    Py_ssize_t nbits = 0;
+    int shared = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|np", kwlist, &buf_obj, &nbits, &shared))
+        return -1;
+    if (nbits < 0 || nbits > UINT32_MAX - 63)
+    {
+        PyErr_SetString(PyExc_ValueError, "nbits out of range");
+        return -1;
+    }
+    Py_buffer view;
+    if (PyObject_GetBuffer(buf_obj, &view, PyBUF_WRITABLE) < 0)
+        return -1;
+    if (!check_aligned(view.buf, view.len, ABIT_OFF_WORDS, 8))
+    {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "need 8-byte aligned >=64 buffer for AtomicBitset");
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)view.buf;
+    // nbits > 0 formats a fresh (all free) bitset; 0 attaches to a formatted one.
+    int format = nbits > 0;
+    if (!format)
+    {
+        if (fipc_u32_load_acq(base, ABIT_OFF_STATE) == 0 || fipc_header_check(base, ABIT_MAGIC) != 0)
+        {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "buffer does not hold a formatted AtomicBitset");
+            return -1;
+        }
+        nbits = fipc_u32_load_acq(base, ABIT_OFF_NBITS);
+    }
+    if ((size_t)view.len < abit_required_size((size_t)nbits))
+    {
+        PyBuffer_Release(&view);
+        PyErr_Format(PyExc_ValueError, "buffer too small for %zd bits", nbits);
+        return -1;
+    }
+    if (pin_owner(&self->owner, buf_obj) < 0)
+    {
+        PyBuffer_Release(&view);
+        return -1;
+    }
+    self->base = base;
+    self->words = (uint64_t *)(base + ABIT_OFF_WORDS);
+    self->epoch = fipc_u32_at(base, ABIT_OFF_EPOCH);
+    self->nbits = (uint32_t)nbits;
+    self->nwords = (uint32_t)((nbits + 63) / 64);
+    self->shared = shared ? 1 : 0;
+    // Different processes (and objects) start scanning at different words.
+    self->hint = self->nwords ? (uint32_t)(((uint64_t)getpid() * 2654435761u + (uintptr_t)self / 64) % self->nwords) : 0;
+    if (format)
+    {
+        memset(self->words, 0, (size_t)self->nwords * 8);
+        fipc_u32_store_rel(base, ABIT_OFF_EPOCH, 0);
+        fipc_u32_store_rel(base, ABIT_OFF_NBITS, (uint32_t)nbits);
+        fipc_u32_store_rel(base, ABIT_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+        fipc_u32_store_rel(base, 0, ABIT_MAGIC);
+        fipc_u32_store_rel(base, ABIT_OFF_STATE, 1);
+    }
+    PyBuffer_Release(&view);
+    return 0;
+}
+
+static void AtomicBitset_dealloc(AtomicBitset *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_XDECREF(self->owner);
+    tp->tp_free((PyObject *)self);
+    Py_DECREF(tp);
+}
+
+static int abit_ready(AtomicBitset *self)
+{
+    if (self->base == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "AtomicBitset is not initialized");
+        return 0;
+    }
+    return 1;
+}
+
+// Claim up to `want` free bits of word w with one CAS; returns the bits taken (0 if none free).
+static inline uint64_t abit_take(AtomicBitset *self, uint32_t w, uint32_t want)
+{
+    uint64_t *p = &self->words[w];
+    uint64_t v = __atomic_load_n(p, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        uint64_t free = ~v & abit_valid(self, w);
+        if (free == 0)
+            return 0;
+        uint64_t take = 0;
+        for (uint32_t n = 0; n < want && free; n++)
+        {
+            uint64_t low = free & (~free + 1); // isolate the lowest free bit
+            take |= low;
+            free ^= low;
+        }
+        if (__atomic_compare_exchange_n(p, &v, v | take, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return take;
+    }
+}
+
+static inline int abit_release_bits(AtomicBitset *self, uint32_t w, uint64_t bits)
+{
+    // Clearing an already clear bit changes nothing, so a double release is only reported.
+    uint64_t old = __atomic_fetch_and(&self->words[w], ~bits, __ATOMIC_SEQ_CST);
+    return (old & bits) == bits ? 0 : -1;
+}
+
+// Wake waiters after a release; a plain load unless someone is actually waiting.
+static inline void abit_notify(AtomicBitset *self)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint32_t v = __atomic_load_n(self->epoch, __ATOMIC_RELAXED);
+    if ((v & 1u) && __atomic_compare_exchange_n(self->epoch, &v, (v + 2u) & ~1u, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        fipc_futex_wake(self->epoch, INT_MAX, self->shared);
+}
+
+static PyObject *AtomicBitset_claim_first_free(AtomicBitset *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!abit_ready(self))
+        return NULL;
+    uint32_t start = __atomic_load_n(&self->hint, __ATOMIC_RELAXED);
+    for (uint32_t k = 0; k < self->nwords; k++)
+    {
+        uint32_t w = start + k < self->nwords ? start + k : start + k - self->nwords;
+        uint64_t got = abit_take(self, w, 1);
+        if (got)
+        {
+            __atomic_store_n(&self->hint, w, __ATOMIC_RELAXED);
+            return PyLong_FromUnsignedLong(w * 64u + (uint32_t)__builtin_ctzll(got));
+        }
+    }
+    return PyLong_FromLong(-1);
+}
+
+static PyObject *AtomicBitset_claim_n(AtomicBitset *self, PyObject *arg)
+{
+    if (!abit_ready(self))
+        return NULL;
+    Py_ssize_t k = PyLong_AsSsize_t(arg);
+    if (k == -1 && PyErr_Occurred())
+        return NULL;
+    if (k < 0 || k > (Py_ssize_t)self->nbits)
+    {
+        PyErr_SetString(PyExc_ValueError, "k out of range");
+        return NULL;
+    }
+    uint64_t *taken = PyMem_Calloc(self->nwords ? self->nwords : 1, sizeof(uint64_t));
+    if (taken == NULL)
+        return PyErr_NoMemory();
+    Py_ssize_t have = 0;
+    uint32_t start = __atomic_load_n(&self->hint, __ATOMIC_RELAXED);
+    for (uint32_t j = 0; j < self->nwords && have < k; j++)
+    {
+        uint32_t w = start + j < self->nwords ? start + j : start + j - self->nwords;
+        uint64_t got = abit_take(self, w, (uint32_t)(k - have < 64 ? k - have : 64));
+        taken[w] = got;
+        have += __builtin_popcountll(got);
+    }
+    PyObject *out = NULL;
+    if (have == k)
+        out = PyList_New(k);
+    if (out == NULL)
+    {
+        // Not enough free bits (or no memory): give back the partial claim.
+        int released = 0;
+        for (uint32_t w = 0; w < self->nwords; w++)
+            if (taken[w])
+            {
+                abit_release_bits(self, w, taken[w]);
+                released = 1;
+            }
+        PyMem_Free(taken);
+        if (released)
+            abit_notify(self);
+        if (PyErr_Occurred())
+            return NULL;
+        Py_RETURN_NONE;
+    }
+    Py_ssize_t n = 0;
+    for (uint32_t j = 0; j < self->nwords; j++)
+    {
+        uint32_t w = start + j < self->nwords ? start + j : start + j - self->nwords;
+        for (uint64_t bits = taken[w]; bits; bits &= bits - 1)
+        {
+            PyObject *idx = PyLong_FromUnsignedLong(w * 64u + (uint32_t)__builtin_ctzll(bits));
+            if (idx == NULL)
+            {
+                // Leaves the remaining bits claimed; they belong to no one, as after a crash.
+                PyMem_Free(taken);
+                Py_DECREF(out);
+                return NULL;
+            }
+            PyList_SET_ITEM(out, n++, idx);
+        }
+        if (taken[w])
+            __atomic_store_n(&self->hint, w, __ATOMIC_RELAXED);
+    }
+    PyMem_Free(taken);
+    return out;
+}
+
+static int abit_index(AtomicBitset *self, PyObject *arg, uint32_t *w, uint64_t *bit)
+{
+    Py_ssize_t i = PyLong_AsSsize_t(arg);
+    if (i == -1 && PyErr_Occurred())
+        return -1;
+    if (i < 0 || i >= (Py_ssize_t)self->nbits)
+    {
+        PyErr_SetString(PyExc_IndexError, "bit index out of range");
+        return -1;
+    }
+    *w = (uint32_t)(i / 64);
+    *bit = 1ull << (i % 64);
+    return 0;
+}
+
+static PyObject *AtomicBitset_release(AtomicBitset *self, PyObject *arg)
+{
+    uint32_t w;
+    uint64_t bit;
+    if (!abit_ready(self) || abit_index(self, arg, &w, &bit) < 0)
+        return NULL;
+    if (abit_release_bits(self, w, bit) < 0)
+    {
+        PyErr_Format(PyExc_ValueError, "bit %R is not claimed", arg);
+        return NULL;
+    }
+    abit_notify(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject *AtomicBitset_test(AtomicBitset *self, PyObject *arg)
+{
+    uint32_t w;
+    uint64_t bit;
+    if (!abit_ready(self) || abit_index(self, arg, &w, &bit) < 0)
+        return NULL;
+    return PyBool_FromLong((__atomic_load_n(&self->words[w], __ATOMIC_ACQUIRE) & bit) != 0);
+}
+
+// Sum of set bits over a relaxed snapshot of the words (not atomic across words). The
+// baseline x86-64 target has no popcnt instruction, so __builtin_popcountll is a libgcc
+// call per word there; CPUs that have it get a copy of the loop built for it.
+static uint64_t abit_popcount_generic(const uint64_t *words, uint32_t nwords)
+{
+    uint64_t total = 0;
+    for (uint32_t w = 0; w < nwords; w++)
+        total += (uint64_t)__builtin_popcountll(__atomic_load_n(&words[w], __ATOMIC_RELAXED));
+    return total;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("popcnt"))) static uint64_t abit_popcount_hw(const uint64_t *words, uint32_t nwords)
+{
+    uint64_t total = 0;
+    for (uint32_t w = 0; w < nwords; w++)
+        total += (uint64_t)__builtin_popcountll(__atomic_load_n(&words[w], __ATOMIC_RELAXED));
+    return total;
+}
+
+static uint64_t abit_popcount(const uint64_t *words, uint32_t nwords)
+{
+    static int has_popcnt = -1;
+    if (has_popcnt < 0)
+    {
+        __builtin_cpu_init();
+        has_popcnt = __builtin_cpu_supports("popcnt") ? 1 : 0;
+    }
+    return has_popcnt ? abit_popcount_hw(words, nwords) : abit_popcount_generic(words, nwords);
+}
+#else
+#define abit_popcount abit_popcount_generic
+#endif
+
+static PyObject *AtomicBitset_popcount(AtomicBitset *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!abit_ready(self))
+        return NULL;
+    return PyLong_FromUnsignedLongLong(abit_popcount(self->words, self->nwords));
+}
+
+static int abit_any_free(AtomicBitset *self)
+{
+    for (uint32_t w = 0; w < self->nwords; w++)
+        if (~__atomic_load_n(&self->words[w], __ATOMIC_RELAXED) & abit_valid(self, w))
+            return 1;
+    return 0;
+}
+
+static PyObject *AtomicBitset_wait_free(AtomicBitset *self, PyObject *args, PyObject *kw)
+{
+    static char *kwlist[] = {"timeout_ns", NULL};
+    long long timeout_ns = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "|L", kwlist, &timeout_ns))
+        return NULL;
+    if (!abit_ready(self))
+        return NULL;
+    uint64_t deadline = timeout_ns >= 0 ? fipc_now_monotonic_ns() + (uint64_t)timeout_ns : 0;
+    for (;;)
+    {
+        // Announce the waiter, then re-check (pairs with the fence in abit_notify).
+        uint32_t v = __atomic_load_n(self->epoch, __ATOMIC_RELAXED);
+        while (!(v & 1u) && !__atomic_compare_exchange_n(self->epoch, &v, v | 1u, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            ;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (abit_any_free(self))
+            Py_RETURN_TRUE;
+        long long left = -1;
+        if (timeout_ns >= 0)
+        {
+            uint64_t now = fipc_now_monotonic_ns();
+            if (now >= deadline)
+                Py_RETURN_FALSE;
+            left = (long long)(deadline - now);
+        }
+        int rc;
+        Py_BEGIN_ALLOW_THREADS
+        rc = fipc_futex_wait(self->epoch, v | 1u, left, self->shared);
+        Py_END_ALLOW_THREADS
+        if (rc == -EINTR && PyErr_CheckSignals() < 0)
+            return NULL;
+        if (rc != 0 && rc != -EAGAIN && rc != -ETIMEDOUT && rc != -EINTR)
+        {
+            errno = -rc;
+            return PyErr_SetFromErrno(PyExc_OSError);
+        }
+    }
+}
+
+static PyObject *AtomicBitset_nbits(AtomicBitset *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!abit_ready(self))
+        return NULL;
+    return PyLong_FromUnsignedLong(self->nbits);
+}
+
+static PyObject *AtomicBitset_required_size(PyObject *Py_UNUSED(cls), PyObject *arg)
+{
+    Py_ssize_t nbits = PyLong_AsSsize_t(arg);
+    if (nbits == -1 && PyErr_Occurred())
+        return NULL;
+    if (nbits <= 0 || nbits > UINT32_MAX - 63)
+    {
+        PyErr_SetString(PyExc_ValueError, "nbits out of range");
+        return NULL;
+    }
+    return PyLong_FromSize_t(abit_required_size((size_t)nbits));
+}
+
+static PyMethodDef AtomicBitset_methods[] = {
+    {"claim_first_free", (PyCFunction)AtomicBitset_claim_first_free, METH_NOARGS, "claim a free bit; returns its index or -1"},
+    {"claim_n", (PyCFunction)AtomicBitset_claim_n, METH_O, "claim k free bits; returns their indices or None"},
+    {"release", (PyCFunction)AtomicBitset_release, METH_O, "free a claimed bit"},
+    {"test", (PyCFunction)AtomicBitset_test, METH_O, "whether a bit is claimed"},
+    {"popcount", (PyCFunction)AtomicBitset_popcount, METH_NOARGS, "number of claimed bits"},
+    {"wait_free", PyCFunction_CAST(AtomicBitset_wait_free), METH_VARARGS | METH_KEYWORDS, "block until some bit is free"},
+    {"nbits", (PyCFunction)AtomicBitset_nbits, METH_NOARGS, "number of bits"},
+    {"required_size", (PyCFunction)AtomicBitset_required_size, METH_O | METH_STATIC, "buffer bytes needed for nbits"},
+    {NULL, NULL, 0, NULL}};
+
+static PyObject *AtomicBitset_repr(PyObject *self)
+{
+    AtomicBitset *s = (AtomicBitset *)self;
+    return PyUnicode_FromFormat("<fastipc.AtomicBitset buf=%p nbits=%u>", (void *)s->base, (unsigned)s->nbits);
+}
+
+static PyType_Slot AtomicBitset_type_slots[] = {
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, (void *)AtomicBitset_init},
+    {Py_tp_dealloc, (void *)AtomicBitset_dealloc},
+    {Py_tp_methods, AtomicBitset_methods},
+    {Py_tp_repr, (void *)AtomicBitset_repr},
+    {0, NULL}};
+
+static PyType_Spec AtomicBitset_spec = {
+    .name = "fastipc.AtomicBitset",
+    .basicsize = sizeof(AtomicBitset),
+    .flags = FASTIPC_TPFLAGS,
+    .slots = AtomicBitset_type_slots,
+};
+
+// ---------- module ----------
+// Multi-phase init with heap types: every interpreter (and every module object) gets its own
+// type objects, and the module declares it does not need the GIL. Objects are immutable after
+// __init__ (see pin_owner), except for BlockPool's spinlock-guarded process cache and
+// AtomicBitset's relaxed scan hint, and all shared state lives in the caller's buffer behind
+// atomics.
+enum
+{
+    FASTIPC_T_FUTEXWORD,
+    FASTIPC_T_ATOMICU32,
+    FASTIPC_T_ATOMICU64,
+    FASTIPC_T_MUTEX,
+    FASTIPC_T_SEMAPHORE,
+    FASTIPC_T_SHARDEDCOUNTER,
+    FASTIPC_T_SEQUENCER,
+    FASTIPC_T_LEASETABLE,
+    FASTIPC_T_REGISTRY,
+    FASTIPC_T_SHAREDHASHMAP,
+    FASTIPC_T_BLOCKPOOL,
+    FASTIPC_T_STRUCTLAYOUT,
+    FASTIPC_T_SHAREDSTRUCT,
+    FASTIPC_T_WORKSTEALINGDEQUE,
+    FASTIPC_T_ATOMICBITSET,
+    FASTIPC_NTYPES
+};
+
+static PyType_Spec *fastipc_specs[FASTIPC_NTYPES] = {
+    [FASTIPC_T_FUTEXWORD] = &FutexWord_spec,
+    [FASTIPC_T_ATOMICU32] = &AtomicU32_spec,
+    [FASTIPC_T_ATOMICU64] = &AtomicU64_spec,
+    [FASTIPC_T_MUTEX] = &FutexMutex_spec,
+    [FASTIPC_T_SEMAPHORE] = &FutexSemaphore_spec,
+    [FASTIPC_T_SHARDEDCOUNTER] = &ShardedCounter_spec,
+    [FASTIPC_T_SEQUENCER] = &Sequencer_spec,
+    [FASTIPC_T_LEASETABLE] = &LeaseTable_spec,
+    [FASTIPC_T_REGISTRY] = &Registry_spec,
+    [FASTIPC_T_SHAREDHASHMAP] = &SharedHashMap_spec,
+    [FASTIPC_T_BLOCKPOOL] = &BlockPool_spec,
+    [FASTIPC_T_STRUCTLAYOUT] = &StructLayout_spec,
+    [FASTIPC_T_SHAREDSTRUCT] = &SharedStruct_spec,
+    [FASTIPC_T_WORKSTEALINGDEQUE] = &WorkStealingDeque_spec,
+    [FASTIPC_T_ATOMICBITSET] = &AtomicBitset_spec,
+};
+
+typedef struct
+{
+    PyTypeObject *types[FASTIPC_NTYPES];
+} fastipc_state;
+
+static inline fastipc_state *fastipc_get_state(PyObject *m)
+{
+    return (fastipc_state *)PyModule_GetState(m);
+}
+
+static const FastIPC_CAPI fastipc_capi = {
+    .version = FASTIPC_CAPI_VERSION,
+    .size = (uint32_t)sizeof(FastIPC_CAPI),
+    .mutex_init = fipc_mutex_init,
+    .mutex_try_acquire = fipc_mutex_try_acquire,
+    .mutex_acquire = fipc_mutex_acquire,
+    .mutex_acquire_ns = fipc_mutex_acquire_ns,
+    .mutex_release = fipc_mutex_release,
+    .mutex_force_release = fipc_mutex_force_release,
+    .semaphore_init = fipc_semaphore_init,
+    .semaphore_post = fipc_semaphore_post,
+    .semaphore_wait = fipc_semaphore_wait,
+    .futex_wait = fipc_futex_wait,
+    .futex_wake = fipc_futex_wake,
+    .u32_fetch_add = fipc_u32_fetch_add,
+    .u64_fetch_add = fipc_u64_fetch_add,
+    .u32_exchange = fipc_u32_exchange,
+    .u64_exchange = fipc_u64_exchange,
+    .u32_cas = fipc_u32_cas,
+    .u64_cas = fipc_u64_cas,
+};
+
+static int futexmod_exec(PyObject *m)
+{
+    fastipc_state *st = fastipc_get_state(m);
+    // The table is static and process-wide, so every interpreter can share it.
+    PyObject *capi = PyCapsule_New((void *)&fastipc_capi, FASTIPC_CAPI_CAPSULE, NULL);
+    if (capi == NULL)
+        return -1;
+    if (PyModule_AddObject(m, "_C_API", capi) < 0)
+    {
+        Py_DECREF(capi);
+        return -1;
+    }
+    for (int i = 0; i < FASTIPC_NTYPES; i++)
+    {
+        PyObject *tp = PyType_FromModuleAndSpec(m, fastipc_specs[i], NULL);
+        if (tp == NULL)
+            return -1;
+        st->types[i] = (PyTypeObject *)tp;
+        if (PyModule_AddType(m, st->types[i]) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int futexmod_traverse(PyObject *m, visitproc visit, void *arg)
+{
+    fastipc_state *st = fastipc_get_state(m);
+    for (int i = 0; i < FASTIPC_NTYPES; i++)
+        Py_VISIT(st->types[i]);
+    return 0;
+}
+
+static int futexmod_clear(PyObject *m)
+{
+    fastipc_state *st = fastipc_get_state(m);
+    for (int i = 0; i < FASTIPC_NTYPES; i++)
+        Py_CLEAR(st->types[i]);
+    return 0;
+}
+
+static void futexmod_free(void *m)
+{
+    futexmod_clear((PyObject *)m);
+}
+
+static PyModuleDef_Slot futexmod_slots[] = {
+    {Py_mod_exec, (void *)futexmod_exec},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#ifdef Py_mod_gil
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, NULL}};
+
+static PyModuleDef futexmod = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "fastipc._primitives",
+    .m_doc = NULL,
+    .m_size = sizeof(fastipc_state),
+    .m_methods = NULL,
+    .m_slots = futexmod_slots,
+    .m_traverse = futexmod_traverse,
+    .m_clear = futexmod_clear,
+    .m_free = futexmod_free,
+};
+
+PyMODINIT_FUNC PyInit__primitives(void)
+{
+    return PyModuleDef_Init(&futexmod);
 }
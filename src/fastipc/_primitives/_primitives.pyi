@@ -1,7 +1,7 @@
 from __future__ import annotations
 
 from types import TracebackType
-from typing import Optional, Type
+from typing import Any, Iterable, Mapping, Optional, Sequence, Tuple, Type
 
 class FutexWord:
     """
@@ -219,6 +219,10 @@ class Mutex:
         """Return the magic constant identifying the header ('MUTX')."""
         ...
 
+    def layout_version(self) -> int:
+        """Return the header layout version (``FASTIPC_LAYOUT_VERSION`` in ``fastipc.h``; 0 if pre-versioned)."""
+        ...
+
     def __enter__(self) -> "Mutex":
         """
         Enter the runtime context related to this object.
@@ -304,3 +308,689 @@ class Semaphore:
     def magic(self) -> int:
         """Return the magic constant identifying the header ('SEMA')."""
         ...
+
+    def layout_version(self) -> int:
+        """Return the header layout version (``FASTIPC_LAYOUT_VERSION`` in ``fastipc.h``; 0 if pre-versioned)."""
+        ...
+
+class ShardedCounter:
+    """
+    A buffer-backed counter split into per-CPU, cache-line-padded u64 slots.
+    Writers add to the slot of the CPU they run on; readers sum every slot.
+    """
+    def __init__(self, buffer: memoryview, slots: int = 0, stride: int = 64) -> None:
+        """
+        Initialize a sharded counter over `slots * stride` bytes.
+
+        Args:
+            buffer: The memory buffer to use. Must be writable and 8-byte aligned.
+            slots: Number of slots. If 0, uses len(buffer) // stride.
+            stride: Distance between slots in bytes (a multiple of 8, default one cache line).
+        """
+        ...
+
+    def add(self, n: int = 1) -> None:
+        """
+        Add n to the slot of the current CPU (relaxed atomic add; wraps modulo 2**64).
+
+        Args:
+            n: The amount to add.
+        """
+        ...
+
+    def read_approx(self) -> int:
+        """
+        Sum all slots with relaxed loads. Cheap, but may miss concurrent adds.
+
+        Returns:
+            The approximate counter value.
+        """
+        ...
+
+    def read_exact(self) -> int:
+        """
+        Sum all slots until two consecutive passes agree (at most 64 passes, without
+        the GIL). Exact once writers are quiesced; under steady adds from other
+        processes it returns the last pass, which is as good as ``read_approx()``.
+
+        Returns:
+            The counter value.
+        """
+        ...
+
+    def reset(self) -> None:
+        """Zero every slot. Not atomic with respect to concurrent adds."""
+        ...
+
+    def slots(self) -> int:
+        """Return the number of slots."""
+        ...
+
+class Sequencer:
+    """
+    A buffer-backed 64-bit published sequence with targeted wakeups.
+    Waiters register their target in a waiter table after a 64-byte header,
+    so a publisher wakes only those whose target has been reached.
+    """
+    def __init__(
+        self, buffer: memoryview, initial: int | None = None, shared: bool = True
+    ) -> None:
+        """
+        Initialize a sequencer over a 64-byte header plus a waiter table.
+
+        Args:
+            buffer: The memory buffer to use. Must be writable, 8-byte aligned, and at least 64 bytes.
+                Every 16 bytes past the header adds one waiter slot; waiters that find
+                the table full sleep on a shared overflow word. The table size is stored
+                in the header when it is first formatted, and later handles attach with it.
+                Raises ValueError if an attaching buffer is smaller than that table.
+            initial: Optional initial sequence for a newly created sequencer.
+                If None, the value is not modified (attach-only semantics).
+            shared: Whether the sequencer is shared between processes.
+        """
+        ...
+
+    def publish(self, seq: int) -> int:
+        """
+        Raise the published sequence to seq (never lowers it) and wake waiters it reached.
+
+        Args:
+            seq: The sequence to publish.
+
+        Returns:
+            The number of waiters woken.
+        """
+        ...
+
+    def publish_range(self, first: int, last: int, timeout_ns: int = -1) -> bool:
+        """
+        Publish the batch [first, last] in one step, after first - 1 has been published.
+        Lets several producers commit claimed ranges in sequence order.
+
+        Args:
+            first: First sequence of the batch.
+            last: Last sequence of the batch.
+            timeout_ns: Maximum time to wait for first - 1 (-1 = infinite).
+
+        Returns:
+            True if the batch was published, False if waiting for its predecessor timed out.
+        """
+        ...
+
+    def wait_until(self, target: int, timeout_ns: int = -1, spin: int = 128) -> bool:
+        """
+        Wait until the published sequence is at least target.
+
+        Args:
+            target: The sequence to wait for.
+            timeout_ns: Timeout in nanoseconds (-1 = infinite, 0 = non-blocking).
+            spin: Number of spin checks before sleeping.
+
+        Returns:
+            True if the target was reached, False if the timeout expired.
+        """
+        ...
+
+    def value(self) -> int:
+        """Return the published sequence."""
+        ...
+
+    def waiter_slots(self) -> int:
+        """Return the number of waiter table slots."""
+        ...
+
+    def magic(self) -> int:
+        """Return the magic constant identifying the header ('SEQR')."""
+        ...
+
+class LeaseTable:
+    """
+    A buffer-backed table of process leases for a shared segment.
+    A 64-byte header is followed by one u64 slot per holder; slots are
+    claimed and released with atomic CAS, so attach/detach need no syscalls.
+    """
+    def __init__(self, buffer: memoryview, slots: int = 0) -> None:
+        """
+        Format a new table or attach to an existing one.
+
+        Args:
+            buffer: 8-byte aligned buffer of at least ``64 + 8 * slots`` bytes.
+            slots: Number of lease slots to format; 0 attaches to a table
+                formatted by another process (ValueError if none is there yet).
+        """
+        ...
+
+    def claim(self, key: int) -> int:
+        """
+        Claim a free slot for a non-zero key.
+
+        Returns:
+            The slot index, or -1 if the table has been retired.
+
+        Raises:
+            RuntimeError: Every slot is held.
+        """
+        ...
+
+    def release(self, index: int, key: int) -> bool:
+        """Free slot ``index`` if it still holds ``key``; returns whether it did."""
+        ...
+
+    def evict(self, key: int) -> int:
+        """Free every slot holding ``key`` (e.g. a dead process); returns the count."""
+        ...
+
+    def holders(self) -> list[int]:
+        """Return a snapshot of the held keys."""
+        ...
+
+    def count(self) -> int:
+        """Return the number of held slots."""
+        ...
+
+    def retire(self) -> bool:
+        """
+        Mark the table retired if no slot is held.
+        Once this returns True, claim() returns -1 and the caller may destroy the segment.
+        """
+        ...
+
+    def state(self) -> int:
+        """Return the table state (1 = live, 2 = retired)."""
+        ...
+
+    def slots(self) -> int:
+        """Return the number of slots."""
+        ...
+
+class Registry:
+    """
+    A buffer-backed name -> 64-byte slot directory (open addressing, no deletes).
+    Lets many small named primitives live in one shared mapping.
+    """
+    def __init__(self, buffer: memoryview, slots: int = 0, shared: bool = True) -> None:
+        """
+        Format a new registry or attach to an existing one.
+
+        Args:
+            buffer: 8-byte aligned buffer of at least ``Registry.required_size(slots)`` bytes.
+            slots: Number of entries to format; 0 attaches to a registry formatted
+                by another process (ValueError if none is there yet).
+            shared: Use process-shared futexes for initialization waits.
+        """
+        ...
+
+    def get_or_create(self, name: str, timeout_ns: int = -1) -> tuple[int, bool]:
+        """
+        Find or claim the entry for ``name``.
+
+        Returns:
+            ``(offset, created)``: the byte offset of the 64-byte payload in the buffer
+            and whether this call claimed it. A creator must call ``publish(offset)``
+            once the payload is initialized; other callers wait for that. If the creator
+            dies first, the next caller takes the entry over and gets ``created=True``.
+
+        Raises:
+            RuntimeError: The registry is full.
+            TimeoutError: The creator did not publish within ``timeout_ns``.
+        """
+        ...
+
+    def lookup(self, name: str, timeout_ns: int = -1) -> int:
+        """Return the payload offset for ``name``, or -1 if it is not registered (or its creator died before publishing)."""
+        ...
+
+    def publish(self, offset: int) -> None:
+        """Mark a created payload initialized and wake waiting lookups."""
+        ...
+
+    def count(self) -> int:
+        """Return the number of registered names."""
+        ...
+
+    def slots(self) -> int:
+        """Return the number of entries."""
+        ...
+
+    @staticmethod
+    def required_size(slots: int) -> int:
+        """Return the buffer size needed for ``slots`` entries."""
+        ...
+
+class SharedHashMap:
+    """
+    A buffer-backed hash map from fixed-size keys to fixed-size values.
+
+    Open addressing with linear probing. Lookups are lock-free: each bucket's
+    meta word doubles as a seqlock, so readers never write shared memory.
+    Writes are lock-free too: each claims a bucket with a CAS, and a new key takes
+    the first tombstone or empty bucket on its probe path, so a table can keep
+    deleting and inserting fresh keys. If two processes store the same new key at
+    once, both calls may report it as new but the map keeps one copy, holding one
+    of the two values. If a writer dies mid-write, the next caller to reach its
+    bucket retires it as a tombstone and that entry is lost.
+    Calls that have to wait on another writer release the GIL.
+    """
+    def __init__(self, buffer: memoryview, key_size: int = 0, value_size: int = 0, capacity: int = 0) -> None:
+        """
+        Format a new map or attach to an existing one.
+
+        Args:
+            buffer: 8-byte aligned writable buffer of at least
+                ``SharedHashMap.required_size(key_size, value_size, capacity)`` bytes.
+            key_size: Bytes per key (1..1024).
+            value_size: Bytes per value (0..65536).
+            capacity: Number of buckets, rounded up to a power of two; 0 attaches to a
+                map formatted by another process (sizes are then read from the buffer,
+                ValueError if none is there yet).
+        """
+        ...
+
+    def get(self, key: bytes, default: Any = None) -> bytes | Any:
+        """Return the value stored for ``key``, or ``default``."""
+        ...
+
+    def put(self, key: bytes, value: bytes) -> bool:
+        """
+        Insert or overwrite ``key``.
+
+        Returns:
+            True if the key was not present.
+
+        Raises:
+            RuntimeError: Every bucket on the probe path is taken.
+        """
+        ...
+
+    def delete(self, key: bytes) -> bool:
+        """Remove ``key``; returns True if it was present."""
+        ...
+
+    def get_many(self, keys: bytes) -> tuple[bytes, bytes]:
+        """
+        Look up a packed array of keys in one call (the GIL is released).
+
+        Args:
+            keys: ``n * key_size`` bytes, e.g. a numpy array's buffer.
+
+        Returns:
+            ``(values, found)``: ``n * value_size`` bytes (zeros where missing)
+            and ``n`` bytes holding 1 for each key that was found.
+        """
+        ...
+
+    def put_many(self, keys: bytes, values: bytes) -> int:
+        """
+        Store packed keys and values in one call (the GIL is released).
+
+        Returns:
+            The number of keys that were new.
+
+        Raises:
+            RuntimeError: The map filled up; entries before the failing one are stored.
+        """
+        ...
+
+    def count(self) -> int:
+        """Return the number of live entries."""
+        ...
+
+    def capacity(self) -> int:
+        """Return the number of buckets."""
+        ...
+
+    def stats(self) -> dict[str, int | float]:
+        """Return capacity, count, tombstones, key/value sizes and load factor
+        ((count + tombstones) / capacity)."""
+        ...
+
+    @staticmethod
+    def required_size(key_size: int, value_size: int, capacity: int) -> int:
+        """Return the buffer size needed for a map with these parameters."""
+        ...
+
+class BlockPool:
+    """
+    A buffer-backed pool of fixed-size blocks handed out as integer handles.
+
+    Free blocks form a Treiber stack whose 64-bit head carries an ABA tag next to
+    the top index, so ``alloc``/``free`` are a single CAS on the shared head. An
+    optional per-process cache batches those CASes. Blocks are 64-byte aligned.
+    """
+    def __init__(self, buffer: memoryview, block_size: int = 0, cache_size: int = 0) -> None:
+        """
+        Format a new pool or attach to an existing one.
+
+        Args:
+            buffer: 64-byte aligned writable buffer; a new pool carves as many blocks
+                out of it as fit (see ``BlockPool.required_size``).
+            block_size: Usable bytes per block; 0 attaches to a pool formatted by
+                another process (ValueError if none is there yet).
+            cache_size: Capacity of this object's private cache of free blocks (0 = off).
+                Cached blocks are invisible to other processes until ``flush()``; a
+                forked child starts with an empty cache.
+        """
+        ...
+
+    def alloc(self) -> int:
+        """Take a block; returns its handle, or -1 if the pool is exhausted."""
+        ...
+
+    def free(self, handle: int) -> None:
+        """
+        Return a block.
+
+        Raises:
+            ValueError: The handle is out of range or the block is not allocated.
+        """
+        ...
+
+    def alloc_many(self, n: int) -> list[int]:
+        """Take up to ``n`` blocks (fewer if the pool runs out)."""
+        ...
+
+    def free_many(self, handles: Iterable[int]) -> None:
+        """Return several blocks; stops at the first invalid handle (ValueError)."""
+        ...
+
+    def view(self, handle: int) -> memoryview:
+        """Return a zero-copy writable view of a block's ``block_size`` bytes."""
+        ...
+
+    def offset(self, handle: int) -> int:
+        """Return the byte offset of a block in the buffer (for native peers)."""
+        ...
+
+    def flush(self) -> None:
+        """Return this object's cached free blocks to the shared list."""
+        ...
+
+    def available(self) -> int:
+        """Return the approximate number of free blocks (shared list plus own cache)."""
+        ...
+
+    def blocks(self) -> int:
+        """Return the number of blocks."""
+        ...
+
+    def block_size(self) -> int:
+        """Return the usable bytes per block."""
+        ...
+
+    @staticmethod
+    def required_size(block_size: int, blocks: int) -> int:
+        """Return the buffer size needed for ``blocks`` blocks of ``block_size`` bytes."""
+        ...
+
+class StructLayout:
+    """
+    A declared set of fields compiled once into cache-line-aware offsets.
+
+    Kinds: ``u8``..``u64``, ``i8``..``i64``, ``f32``, ``f64`` (plain values, packed
+    together), ``atomic_u32``, ``atomic_u64`` and ``futex`` (each starts its own
+    cache line), and ``mutex``/``semaphore`` (embedded 64-byte headers).
+    """
+    def __init__(self, fields: Sequence[Tuple[str, str] | Tuple[str, str, int]]) -> None:
+        """
+        Compile a layout.
+
+        Args:
+            fields: ``(name, kind)`` or ``(name, kind, count)`` tuples; a count above 1
+                declares a fixed array.
+
+        Raises:
+            ValueError: Unknown kind, bad count, duplicate name, or a name that starts
+                with ``_`` or clashes with a SharedStruct method.
+        """
+        ...
+
+    def size(self) -> int:
+        """Return the bytes a SharedStruct with this layout needs (a multiple of 64)."""
+        ...
+
+    def hash(self) -> int:
+        """Return the 64-bit hash of names, kinds, counts and offsets checked on attach."""
+        ...
+
+    def offset(self, name: str) -> int:
+        """Return the byte offset of a field (for native peers)."""
+        ...
+
+    def fields(self) -> list[Tuple[str, str, int, int]]:
+        """Return ``(name, kind, count, offset)`` for every field, in declaration order."""
+        ...
+
+class SharedStruct:
+    """
+    A typed view of a StructLayout over a shared buffer.
+
+    Fields read and write as attributes: plain scalars are copied, atomic and futex
+    scalars use acquire loads and release stores, plain arrays come back as a
+    writable typed memoryview, atomic arrays as a tuple, and mutex/semaphore fields
+    as ready-made Mutex/Semaphore objects.
+    """
+    layout: StructLayout
+
+    def __init__(self, buffer: memoryview, layout: StructLayout, shared: bool = True) -> None:
+        """
+        Format the buffer for ``layout`` or attach to it.
+
+        The first process to attach zeroes the fields and stamps the header; others
+        wait for it and compare layout hashes. If that process dies while formatting,
+        the next one to attach formats the buffer again.
+
+        Args:
+            buffer: 64-byte aligned writable buffer of at least ``layout.size()`` bytes.
+            layout: The field layout; every process must declare the same one.
+            shared: Use process-shared futexes (False for threads of one process).
+
+        Raises:
+            ValueError: The buffer is too small or misaligned, holds something else,
+                or was formatted with a different layout.
+            TimeoutError: A live process has been formatting the buffer for over 5 seconds.
+        """
+        ...
+
+    def __getattr__(self, name: str) -> Any: ...
+    def __setattr__(self, name: str, value: Any) -> None: ...
+
+    def load(self, name: str, index: int = 0) -> int | float:
+        """Read element ``index`` of a numeric field."""
+        ...
+
+    def store(self, name: str, value: int | float, index: int = 0) -> None:
+        """
+        Write element ``index`` of a numeric field.
+
+        Raises:
+            OverflowError: The value does not fit the field.
+        """
+        ...
+
+    def fetch_add(self, name: str, delta: int, index: int = 0) -> int:
+        """Atomically add ``delta`` (wrapping) to an atomic or futex field; returns the old value."""
+        ...
+
+    def cas(self, name: str, expected: int, desired: int, index: int = 0) -> bool:
+        """Compare-and-swap an atomic or futex field."""
+        ...
+
+    def wait(self, name: str, expected: int, timeout_ns: int = -1, index: int = 0) -> bool:
+        """
+        Futex-wait while a 32-bit atomic or futex field equals ``expected``.
+
+        Returns:
+            True if woken, False on timeout or if the value already differed.
+        """
+        ...
+
+    def wake(self, name: str, n: int = 1, index: int = 0) -> int:
+        """Wake up to ``n`` waiters on a 32-bit atomic or futex field; returns the number woken."""
+        ...
+
+    def load_fields(self, names: Sequence[str]) -> Tuple[Any, ...]:
+        """Read several scalar fields in one call."""
+        ...
+
+    def store_fields(self, values: Optional[Mapping[str, Any]] = None, **kwargs: Any) -> None:
+        """Write several scalar fields in one call (from a dict and/or keywords)."""
+        ...
+
+class WorkStealingDeque:
+    """
+    A buffer-backed Chase-Lev work-stealing deque of fixed-size task descriptors.
+
+    One owner pushes and pops at the bottom with plain loads and stores (a CAS only
+    when racing thieves for the last item); any number of thieves in any process
+    take the oldest items from the top with a CAS each. Deques that share an idle
+    word let thieves park until some owner pushes.
+    """
+    def __init__(
+        self, buffer: memoryview, capacity: int = 0, item_size: int = 8, idle: Optional[memoryview] = None
+    ) -> None:
+        """
+        Format a new deque or attach to an existing one.
+
+        Args:
+            buffer: 64-byte aligned writable buffer (see ``WorkStealingDeque.required_size``).
+            capacity: Number of slots, a power of two; 0 attaches to a deque formatted by
+                another process (ValueError if none is there yet).
+            item_size: Bytes per task descriptor (when formatting).
+            idle: Optional 4-byte aligned word shared by a group of deques, used by
+                ``prepare_park``/``park``; pushes wake thieves parked on it.
+        """
+        ...
+
+    def push(self, item: bytes | bytearray | memoryview) -> bool:
+        """
+        Owner only: push an item at the bottom.
+
+        Returns:
+            False if the deque is full.
+
+        Raises:
+            ValueError: The item is not exactly ``item_size`` bytes.
+        """
+        ...
+
+    def pop(self) -> Optional[bytes]:
+        """Owner only: pop the most recently pushed item, or None if empty."""
+        ...
+
+    def steal(self) -> Optional[bytes]:
+        """Take the oldest item, or None if empty."""
+        ...
+
+    def steal_half(self, max_items: int = ...) -> list[bytes]:
+        """Take up to half of the items (at most ``max_items``), oldest first."""
+        ...
+
+    def size(self) -> int:
+        """Return the approximate number of items."""
+        ...
+
+    def capacity(self) -> int:
+        """Return the number of slots."""
+        ...
+
+    def item_size(self) -> int:
+        """Return the bytes per item."""
+        ...
+
+    def prepare_park(self) -> int:
+        """
+        Announce that this thief is about to park on the idle word.
+
+        Re-scan every deque after calling this and only ``park(token)`` if they are
+        all still empty; a push that raced the scan then wakes the thief.
+
+        Returns:
+            The token to pass to ``park``.
+        """
+        ...
+
+    def park(self, token: int, timeout_ns: int = -1) -> bool:
+        """
+        Sleep until an owner pushes to any deque sharing the idle word.
+
+        Returns:
+            True if a push happened since ``prepare_park``, False on timeout.
+        """
+        ...
+
+    @staticmethod
+    def required_size(capacity: int, item_size: int = 8) -> int:
+        """Return the buffer size needed for ``capacity`` items of ``item_size`` bytes."""
+        ...
+
+class AtomicBitset:
+    """
+    A buffer-backed bitmap of claimable slots (a set bit is taken).
+
+    Claims scan a 64-bit word at a time with count-trailing-zeros and take bits
+    with one CAS per word, starting from a per-object rotating hint so that
+    concurrent claimers spread over the bitmap. Releases only wake waiters when
+    someone is blocked in ``wait_free``.
+    """
+    def __init__(self, buffer: memoryview, nbits: int = 0, shared: bool = True) -> None:
+        """
+        Format a new bitset (all bits free) or attach to an existing one.
+
+        Args:
+            buffer: 8-byte aligned writable buffer (see ``AtomicBitset.required_size``).
+            nbits: Number of bits; 0 attaches to a bitset formatted by another process
+                (ValueError if none is there yet).
+            shared: Use process-shared futexes for ``wait_free``.
+        """
+        ...
+
+    def claim_first_free(self) -> int:
+        """Claim a free bit; returns its index, or -1 if every bit is taken."""
+        ...
+
+    def claim_n(self, k: int) -> Optional[list[int]]:
+        """
+        Claim ``k`` free bits (not necessarily adjacent), all or nothing.
+
+        Returns:
+            The claimed indices, or None if fewer than ``k`` bits are free.
+        """
+        ...
+
+    def release(self, index: int) -> None:
+        """
+        Free a claimed bit and wake ``wait_free`` callers.
+
+        Raises:
+            ValueError: The bit is not claimed.
+        """
+        ...
+
+    def test(self, index: int) -> bool:
+        """Return whether a bit is claimed."""
+        ...
+
+    def popcount(self) -> int:
+        """Return the number of claimed bits (a snapshot while others claim)."""
+        ...
+
+    def wait_free(self, timeout_ns: int = -1) -> bool:
+        """
+        Block until at least one bit is free.
+
+        Returns:
+            True if a bit is free, False on timeout. The bit is not claimed for you.
+        """
+        ...
+
+    def nbits(self) -> int:
+        """Return the number of bits."""
+        ...
+
+    @staticmethod
+    def required_size(nbits: int) -> int:
+        """Return the buffer size needed for ``nbits`` bits."""
+        ...
+
+_C_API: object
+"""PyCapsule holding the ``FastIPC_CAPI`` function table (see ``fastipc.get_include()``)."""
@@ -2,21 +2,17 @@ import atexit
 import ctypes
 import ctypes.util
 import errno
+import fcntl
 import mmap
 import os
 import random
 import time
-from typing import Optional
-
-__all__ = ["GuardedSharedMemory"]
+from typing import Dict, List, Optional, Sequence, Tuple, Union
 
+from fastipc import _mm
+from fastipc._primitives import AtomicU32, AtomicU64, LeaseTable
 
-def _alive(pid: int) -> bool:
-    try:
-        os.kill(pid, 0)
-        return True
-    except OSError as e:
-        return e.errno == errno.EPERM
+__all__ = ["GuardedSharedMemory"]
 
 
 def _load_posix_shm_lib() -> ctypes.CDLL:
@@ -85,15 +81,112 @@ def _shm_unlink_wrapped(name: bytes) -> None:
     raise OSError(err, os.strerror(err))
 
 
+_LEASE_STATE_RETIRED = 2
+_PID_BITS = 24
+_PID_MASK = (1 << _PID_BITS) - 1
+_START_MASK = (1 << (64 - _PID_BITS)) - 1
+
+
+def _proc_stat_fields(pid: int) -> List[bytes]:
+    """Fields of /proc/<pid>/stat from the state on; raises OSError when it cannot be read."""
+    with open(f"/proc/{pid}/stat", "rb") as f:
+        stat = f.read()
+    # comm (field 2) may contain spaces/parens; everything after the last ')' is fixed-format.
+    return stat[stat.rindex(b")") + 2 :].split()
+
+
+def _proc_start_time(pid: int) -> Optional[int]:
+    """Return the start time (clock ticks since boot) of a running process, or None."""
+    try:
+        fields = _proc_stat_fields(pid)
+    except OSError:
+        return None
+    if fields[0] in (b"Z", b"X"):
+        return None
+    return int(fields[19])
+
+
+def _pid_exists(pid: int) -> bool:
+    try:
+        os.kill(pid, 0)
+    except ProcessLookupError:
+        return False
+    except PermissionError:
+        pass  # exists, owned by another user
+    return True
+
+
+def _pid_alive(pid: int) -> bool:
+    """Whether a process is running; without a readable /proc entry, whether the PID exists."""
+    try:
+        fields = _proc_stat_fields(pid)
+    except OSError:
+        # No /proc, hidepid, or the process is gone: only a missing PID proves it dead.
+        return _pid_exists(pid)
+    return fields[0] not in (b"Z", b"X")
+
+
+_own_lease_key = (0, 0)  # (pid, key): recomputed after fork
+
+
+def _lease_key() -> int:
+    """Lease key for this process: (start time << 24) | pid, unique across PID reuse."""
+    global _own_lease_key
+    pid = os.getpid()
+    if _own_lease_key[0] != pid:
+        start = _proc_start_time(pid) or 0
+        _own_lease_key = (pid, ((start & _START_MASK) << _PID_BITS) | (pid & _PID_MASK))
+    return _own_lease_key[1]
+
+
+def _lease_alive(key: int) -> bool:
+    pid = key & _PID_MASK
+    try:
+        fields = _proc_stat_fields(pid)
+    except OSError:
+        # Without /proc the start time cannot be checked; never evict a holder that may be live.
+        return _pid_exists(pid)
+    if fields[0] in (b"Z", b"X"):
+        return False
+    return (int(fields[19]) & _START_MASK) == key >> _PID_BITS
+
+
+# Resize generation, kept in the lease table header's reserved bytes: bumped after every grow().
+_OFF_GENERATION = 16
+# Lease key of the last closer retiring the segment, recorded before it retires the table and
+# kept until it unlinks, so attachers that find it retired can tell whether its closer died.
+_OFF_RETIRER = 24
+
+
+def _lease_header_size(slots: int) -> int:
+    # LeaseTable header (64B) plus one u64 per slot, padded so user data starts on a cache line.
+    return (64 + 8 * slots + 63) // 64 * 64
+
+
 class NoShmFoundError(Exception):
     pass
 
 
+class _SegmentRetired(Exception):
+    """The segment's last holder is unlinking it; retry so a fresh one gets created."""
+
+
 class GuardedSharedMemory:
     """
-    attach or create a shared memory segment with PID tracking.
+    attach or create a shared memory segment with in-segment lease tracking.
     This class ensures that the shared memory segment is created or attached
     safely, handling potential race conditions and errors.
+
+    The segment starts with a small reserved header holding a lease table
+    (see ``fastipc.LeaseTable``): every attached process claims one slot keyed
+    by its PID and start time, so attach, detach and "am I the last user" are
+    atomic memory operations and a recycled PID is never mistaken for a live
+    holder. ``buf`` exposes only the user region after that header.
+
+    A segment can be grown in place with ``grow()``. Other processes notice the
+    new generation the next time they touch ``buf`` or ``size`` and map the
+    larger segment; offsets are unchanged and views taken before the grow stay
+    valid (their mappings are kept until ``close()``).
     """
 
     def __init__(
@@ -102,7 +195,12 @@ class GuardedSharedMemory:
         size: int,
         attach_only: bool = False,
         *,
-        pid_dir: str = "/dev/shm/fastipc",
+        pid_dir: Optional[str] = None,
+        max_procs: int = 120,
+        huge_pages: bool = False,
+        populate: bool = False,
+        lock: bool = False,
+        numa_node: Optional[Union[int, Sequence[int]]] = None,
         max_attempts: int = 128,
         backoff_base: float = 0.002,
         try_cleanup_on_exit: bool = True,
@@ -110,20 +208,32 @@ class GuardedSharedMemory:
         """
         Initialize a guarded shared memory segment.
         Attempts to clean up when the process exits,
-        via PID tracking.
+        via lease tracking.
 
         Args:
             name: The name of the shared memory segment.
             size: The size of the shared memory segment.
             attach_only: Whether to only attach to an existing shared memory segment. Raise an error if the segment does not exist.
             *
-            pid_dir: The base directory for PID files.
+            pid_dir: Deprecated and ignored; attachments are tracked inside the segment.
+            max_procs: Lease slots reserved when creating the segment (max concurrently attached processes).
+            huge_pages: Back the mapping with transparent huge pages (MADV_HUGEPAGE).
+            populate: Pre-fault the whole mapping at attach time (MADV_POPULATE_WRITE, else touch each page).
+            lock: mlock() the mapping so it is never paged out.
+            numa_node: Bind pages to this NUMA node, or interleave them across a sequence of nodes (mbind).
+            The four placement options are best effort; see ``effective_options`` for what took effect.
             max_attempts: The maximum number of attempts to create/attach the segment.
             backoff_base: The base backoff time (in seconds) for retrying failed attempts.
             try_cleanup_on_exit: Whether to attempt cleanup on object deletion or program exit.
         """
         if size <= 0:
             raise ValueError("size must be a positive integer")
+        if max_procs <= 0:
+            raise ValueError("max_procs must be a positive integer")
+        if numa_node is not None:
+            nodes = [numa_node] if isinstance(numa_node, int) else list(numa_node)
+            if not nodes or min(nodes) < 0:
+                raise ValueError("numa_node must be a node id or a non-empty sequence of node ids")
 
         # Normalize name for POSIX shm (leading slash required) but keep exposed form.
         if not name:
@@ -141,13 +251,23 @@ class GuardedSharedMemory:
         self._size = size
         self._fd: Optional[int] = None
         self._mmap: Optional[mmap.mmap] = None
+        self._view: Optional[memoryview] = None
         self._buf: Optional[memoryview] = None
+        self._leases: Optional[LeaseTable] = None
+        self._lease_view: Optional[memoryview] = None
+        self._generation: Optional[AtomicU32] = None
+        self._retirer: Optional[AtomicU64] = None
+        self._seen_generation = 0
+        # Mappings replaced by refresh() that still had exports, with the offset their mlock
+        # starts at (earlier mappings keep the pages below it locked).
+        self._retired_maps: List[Tuple[mmap.mmap, int]] = []
+        self._locked_from = 0
+        self._lease_key = _lease_key()
+        self._lease_index = -1
         self._closed = False
         self._unlinked = False
-
-        pid_root = os.environ.get("FASTIPC_PID_DIR", pid_dir)
-        self._pdir = f"{pid_root.rstrip('/')}/{name}.pids"
-        os.makedirs(self._pdir, exist_ok=True)
+        self._placement = (huge_pages, populate, lock, numa_node)
+        self._effective: Dict[str, bool] = {}
 
         last_err = None
         self.created = False
@@ -168,47 +288,30 @@ class GuardedSharedMemory:
                         os.O_RDWR | os.O_CREAT | os.O_EXCL,
                         0o600,
                     )
-                    os.ftruncate(fd, size)
                     created = True
 
-                stat_result = os.fstat(fd)
-                actual_size = stat_result.st_size
-                if actual_size < size:
-                    raise ValueError(
-                        f"Existing shm '{name}' size {actual_size} < requested {size}"
-                    )
-
-                mm = mmap.mmap(fd, actual_size, access=mmap.ACCESS_WRITE)
                 self._fd = fd
-                self._mmap = mm
-                self._buf = memoryview(mm)
-                self._size = actual_size
+                if created:
+                    os.ftruncate(fd, _lease_header_size(max_procs) + size)
+                self._map(max_procs if created else 0, size)
                 self.created = created
                 break
-            except (FileNotFoundError, FileExistsError, ValueError) as e:
+            except (FileNotFoundError, FileExistsError, ValueError, _SegmentRetired) as e:
                 last_err = e
-                if fd is not None:
+                self._detach()
+                if fd is not None and created:
                     try:
-                        os.close(fd)
+                        _shm_unlink_wrapped(self._posix_name_b)
                     except OSError:
                         pass
-                    if created:
-                        try:
-                            _shm_unlink_wrapped(self._posix_name_b)
-                        except OSError:
-                            pass
                 time.sleep(backoff_base * (1 + random.random()))
             except Exception:
-                if fd is not None:
+                self._detach()
+                if fd is not None and created:
                     try:
-                        os.close(fd)
+                        _shm_unlink_wrapped(self._posix_name_b)
                     except OSError:
                         pass
-                    if created:
-                        try:
-                            _shm_unlink_wrapped(self._posix_name_b)
-                        except OSError:
-                            pass
                 raise
         else:
             raise RuntimeError(
@@ -217,45 +320,168 @@ class GuardedSharedMemory:
 
         if self._try_cleanup_on_exit:
             atexit.register(self.close)
-        
-        with open(f"{self._pdir}/{self._pid}", "w"):
-            pass
+
+    def _map(self, format_slots: int, size: int) -> None:
+        """Map the segment, format or attach its lease table, and claim a lease."""
+        actual_size = os.fstat(self._fd).st_size
+        if actual_size < 64:
+            raise ValueError(f"Existing shm '{self._name}' is not initialized yet")
+
+        self._mmap = mmap.mmap(self._fd, actual_size, access=mmap.ACCESS_WRITE)
+        self._view = memoryview(self._mmap)
+        # Raises ValueError until the creator has formatted the table; the caller retries.
+        self._leases = LeaseTable(self._view, format_slots)
+        self._generation = AtomicU32(self._view[_OFF_GENERATION : _OFF_GENERATION + 4])
+        self._retirer = AtomicU64(self._view[_OFF_RETIRER : _OFF_RETIRER + 8])
+        self._seen_generation = self._generation.load()
+        if os.fstat(self._fd).st_size != actual_size:
+            self._seen_generation = -1  # grown while we mapped: remap on first access
+        header = _lease_header_size(self._leases.slots())
+        if actual_size - header < size:
+            raise ValueError(
+                f"Existing shm '{self._name}' size {actual_size - header} < requested {size}"
+            )
+
+        index = self._claim_lease()
+        if index < 0:
+            holder = self._retirer.load()
+            if holder and not _lease_alive(holder) and self._retirer.cas(holder, self._lease_key):
+                self._unlink_if_current()  # its last closer died before unlinking it
+            raise _SegmentRetired(self._name)
+        self._lease_index = index
+        self._lease_view = self._view[:header]
+        self._buf = self._view[header:]
+        self._size = actual_size - header
+        self._apply_placement()
+
+    def grow(self, size: int) -> None:
+        """
+        Grow the user region to ``size`` bytes, in place.
+
+        The segment is extended with ftruncate and its generation bumped; every
+        attached process maps the larger segment on its next access to ``buf`` or
+        ``size``. Offsets of everything already placed in the segment are unchanged.
+        Segments never shrink, since other processes may still use the tail.
+
+        Args:
+            size: New user size in bytes; a size at or below the current one is a no-op.
+        """
+        if self._mmap is None:
+            raise ValueError("Shared memory is closed")
+        header = _lease_header_size(self._leases.slots())
+        # Growers serialize on the segment fd; re-read the size under the lock so a
+        # concurrent, smaller grow can never truncate the segment.
+        fcntl.flock(self._fd, fcntl.LOCK_EX)
+        try:
+            if os.fstat(self._fd).st_size < header + size:
+                os.ftruncate(self._fd, header + size)
+                self._generation.store((self._generation.load() + 1) & 0xFFFFFFFF)
+        finally:
+            fcntl.flock(self._fd, fcntl.LOCK_UN)
+        self.refresh()
+
+    def refresh(self) -> bool:
+        """
+        Map the segment at its current size if another process grew it.
+
+        ``buf`` and ``size`` call this implicitly; it costs one atomic load when
+        nothing changed.
+
+        Returns:
+            True if the mapping was replaced.
+        """
+        if self._generation is None:
+            return False
+        generation = self._generation.load()
+        if generation == self._seen_generation:
+            return False
+        actual_size = os.fstat(self._fd).st_size
+        header = _lease_header_size(self._leases.slots())
+        if actual_size > header + self._size:
+            # The old mapping cannot be resized while views of it are exported; publish a
+            # view of a new, larger mapping and close old ones once nothing exports them.
+            # The first mapping always stays: the lease table and counters point into it.
+            old_size = len(self._mmap)
+            self._retired_maps.append((self._mmap, self._locked_from))
+            self._mmap = mmap.mmap(self._fd, actual_size, access=mmap.ACCESS_WRITE)
+            self._view = memoryview(self._mmap)
+            self._buf = self._view[header:]
+            self._size = actual_size - header
+            self._close_retired_maps()
+            self._apply_placement(old_size)
+        self._seen_generation = generation
+        return True
+
+    def _close_retired_maps(self) -> None:
+        kept = []
+        for mm, locked_from in self._retired_maps:
+            try:
+                mm.close()
+            except BufferError:
+                kept.append((mm, locked_from))
+        self._retired_maps = kept
+
+    @property
+    def generation(self) -> int:
+        """Number of times the segment has been grown."""
+        self.refresh()
+        return self._seen_generation
+
+    def _apply_placement(self, start: int = 0) -> None:
+        """Place the mapping from ``start`` on; the pages below it were placed already."""
+        huge_pages, populate, lock, numa_node = self._placement
+        mm = self._mmap
+        start -= start % mmap.PAGESIZE
+        if lock:
+            # Pages stay locked while any mapping of them is: lock only what the mappings
+            # still open do not cover, from 0 once the ones that covered it are closed.
+            covered = 0
+            for old, locked_from in sorted(self._retired_maps, key=lambda m: m[1]):
+                if locked_from <= covered:
+                    covered = max(covered, len(old))
+            self._locked_from = min(covered, start)
+        # Policy and page size must be chosen before the pages are faulted in.
+        self._effective = {
+            "numa_node": numa_node is not None and _mm.bind_numa(mm, numa_node, start),
+            "huge_pages": huge_pages and _mm.advise_hugepages(mm),
+            "populate": populate and _mm.populate(mm, start),
+            "lock": lock and _mm.lock(mm, self._locked_from),
+        }
+
+    def _claim_lease(self) -> int:
+        try:
+            return self._leases.claim(self._lease_key)
+        except RuntimeError:
+            # Full: reclaim slots of crashed holders once before giving up.
+            for key in self._leases.holders():
+                if not _lease_alive(key):
+                    self._leases.evict(key)
+            return self._leases.claim(self._lease_key)
 
     def get_num_procs(self) -> int:
         """
         Get the number of processes currently using the shared memory segment.
         """
-        try:
-            return len(os.listdir(self._pdir))
-        except FileNotFoundError:
+        if self._leases is None:
             return 0
+        return self._leases.count()
 
     def close(self) -> None:
         """
-        Check if any processes are still using the shared memory segment.
+        Release this process's lease on the shared memory segment.
         Unlink the shared memory segment if it is no longer in use.
         """
         if self._closed:
             return
 
-        self._cleanup_dead_pids()
-        self._remove_pid_file()
-
-        if self._has_other_alive_pids():
-            self._detach()
-            self._closed = True
-            self._unregister_atexit()
-            return
-
-        try:
-            self.unlink()
-        except OSError:
-            pass
-
-        try:
-            os.rmdir(self._pdir)
-        except OSError:
-            pass
+        # A forked child inherits the mapping but not the parent's lease.
+        if os.getpid() == self._pid and self._leases is not None:
+            self._leases.release(self._lease_index, self._lease_key)
+            if self._retire_if_last():
+                try:
+                    self.unlink()
+                except OSError:
+                    pass
 
         self._detach()
         self._closed = True
@@ -274,6 +500,9 @@ class GuardedSharedMemory:
         self.close()
 
     def __del__(self) -> None:
+        # __init__ may have raised during argument validation, before any state existed.
+        if not hasattr(self, "_try_cleanup_on_exit"):
+            return
         if self._try_cleanup_on_exit:
             try:
                 self.close()
@@ -285,57 +514,80 @@ class GuardedSharedMemory:
     def buf(self) -> memoryview:
         if self._buf is None:
             raise ValueError("Shared memory is closed")
+        if self._generation.load() != self._seen_generation:
+            self.refresh()
         return self._buf
 
+    @property
+    def effective_options(self) -> Dict[str, bool]:
+        """Which of huge_pages/populate/lock/numa_node actually took effect on this mapping."""
+        return dict(self._effective)
+
     @property
     def size(self) -> int:
+        if self._generation is not None and self._generation.load() != self._seen_generation:
+            self.refresh()
         return self._size
 
     @property
     def name(self) -> str:
         return self._name
 
-    def _cleanup_dead_pids(self) -> None:
+    def _retire_if_last(self) -> bool:
+        """True if no live process holds a lease and we won the right to unlink."""
+        leases = self._leases
+        while True:
+            for key in leases.holders():
+                if _lease_alive(key):
+                    return False
+                leases.evict(key)  # crashed holder, or its PID was recycled
+            holder = self._retirer.load()
+            if holder and _lease_alive(holder):
+                return False  # a concurrent last closer is unlinking it
+            if not self._retirer.cas(holder, self._lease_key):
+                continue
+            if leases.retire():
+                return True
+            if leases.state() == _LEASE_STATE_RETIRED:
+                self._unlink_if_current()  # its last closer died before unlinking it
+                return False
+            self._retirer.cas(self._lease_key, 0)  # a new holder arrived
+
+    def _unlink_if_current(self) -> None:
+        """Unlink the name unless it already refers to a newer segment."""
         try:
-            for fn in os.listdir(self._pdir):
-                if fn.isdigit() and not _alive(int(fn)):
-                    try:
-                        os.unlink(f"{self._pdir}/{fn}")
-                    except Exception:
-                        pass
+            fd = _shm_open_wrapped(self._posix_name_b, os.O_RDWR, 0o600)
         except FileNotFoundError:
-            pass
-
-    def _remove_pid_file(self) -> None:
-        try:
-            os.unlink(f"{self._pdir}/{self._pid}")
-        except FileNotFoundError:
-            pass
-
-    def _has_other_alive_pids(self) -> bool:
+            return
         try:
-            for fn in os.listdir(self._pdir):
-                if fn.isdigit():
-                    pid = int(fn)
-                    if pid != self._pid and _alive(pid):
-                        return True
-        except FileNotFoundError:
-            pass
-        return False
-
-    def _detach(self) -> None:
-        if self._buf is not None:
-            try:
-                self._buf.release()
-            except AttributeError:
-                pass
-            self._buf = None
-        if self._mmap is not None:
+            current = os.path.samestat(os.fstat(fd), os.fstat(self._fd))
+        finally:
+            os.close(fd)
+        if current:
             try:
-                self._mmap.close()
-            except Exception:
+                _shm_unlink_wrapped(self._posix_name_b)
+            except OSError:
                 pass
-            self._mmap = None
+
+    def _detach(self) -> None:
+        self._leases = None
+        self._generation = self._retirer = None
+        maps = self._retired_maps + [(self._mmap, 0)]
+        for view in (self._lease_view, self._buf, self._view):
+            if view is not None:
+                try:
+                    view.release()
+                except (AttributeError, BufferError):
+                    pass
+        for mm, _ in maps:
+            if mm is not None:
+                try:
+                    mm.close()
+                except Exception:
+                    pass
+        self._retired_maps = []
+        self._buf = self._lease_view = self._view = None
+        self._mmap = None
         if self._fd is not None:
             try:
                 os.close(self._fd)
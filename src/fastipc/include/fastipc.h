@@ -0,0 +1,387 @@
+// fastipc.h
+//
+// Dependency-free (libc + Linux headers) implementation of the fastipc lock protocol:
+// the 64-byte Mutex and Semaphore headers and their spin-then-futex paths. The Python
+// extension is a binding over this file, so a C or C++ process that includes it
+// interoperates with fastipc.Mutex / fastipc.Semaphore on the same shared memory.
+//
+// C11 or C++11, GCC/Clang (__atomic builtins). With strict -std=c11 include this
+// header first or build with -D_GNU_SOURCE so syscall()/clock_gettime() are declared.
+//
+// All functions return 0 on success or a negative errno:
+//   -EBUSY      try_acquire found the mutex held
+//   -EAGAIN     try_take found the semaphore empty, or futex_wait saw a changed word
+//   -ETIMEDOUT  a timed wait expired (timeout_ns: -1 = infinite, 0 = no sleep)
+//   -EPERM      fipc_mutex_release called by a process that does not own the lock
+//   -EOVERFLOW  fipc_semaphore_post would overflow the 32-bit count
+//   -EPROTO     fipc_header_check found a foreign magic or layout version
+// `shared` selects a process-shared (1) or process-private (0) futex and must match the
+// value used by every other party on the same header.
+#ifndef FASTIPC_H
+#define FASTIPC_H
+
+#if !defined(_GNU_SOURCE) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE 1
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FASTIPC_CPU_RELAX() __asm__ __volatile__("pause")
+#elif defined(__aarch64__)
+#define FASTIPC_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define FASTIPC_CPU_RELAX() \
+    do                      \
+    {                       \
+    } while (0)
+#endif
+
+// Bumped whenever the meaning of any header field changes.
+#define FASTIPC_LAYOUT_VERSION 1u
+
+// 64B cacheline-aligned style headers for primitives
+// Layout (Mutex):
+//   0x00: u32 magic ('MUTX')
+//   0x04: u32 layout version (FASTIPC_LAYOUT_VERSION; 0 = written by a pre-versioned build)
+//   0x08: u32 state (futex word; 0=unlocked,1=locked,2=contended)
+//   0x0C: u32 owner_pid (PID holding lock or 0)
+//   0x10: u64 last_acquired_ns (CLOCK_REALTIME in ns)
+//   0x18..0x3F: reserved
+#define FASTIPC_MUTEX_SIZE 64u
+#define FASTIPC_MUTEX_MAGIC 0x4D555458u /* 'MUTX' */
+#define FASTIPC_MUTEX_OFF_MAGIC 0u
+#define FASTIPC_MUTEX_OFF_VERSION 4u
+#define FASTIPC_MUTEX_OFF_STATE 8u
+#define FASTIPC_MUTEX_OFF_OWNER 12u
+#define FASTIPC_MUTEX_OFF_LASTNS 16u
+
+// Layout (Semaphore):
+//   0x00: u32 magic ('SEMA')
+//   0x04: u32 layout version (as above)
+//   0x08: u32 count (futex word)
+//   0x0C: u32 last_pid (last successful waiter pid)
+//   0x10: u64 last_acquired_ns (CLOCK_REALTIME in ns)
+//   0x18..0x3F: reserved
+#define FASTIPC_SEM_SIZE 64u
+#define FASTIPC_SEM_MAGIC 0x53454D41u /* 'SEMA' */
+#define FASTIPC_SEM_OFF_MAGIC 0u
+#define FASTIPC_SEM_OFF_VERSION 4u
+#define FASTIPC_SEM_OFF_COUNT 8u
+#define FASTIPC_SEM_OFF_LASTPID 12u
+#define FASTIPC_SEM_OFF_LASTNS 16u
+
+// ---------- time ----------
+
+static inline uint64_t fipc_now_monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t fipc_now_realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Fill *ts with the time left until deadline; returns 0 once the deadline has passed.
+static inline int fipc_deadline_remaining(uint64_t deadline_ns, struct timespec *ts)
+{
+    uint64_t now = fipc_now_monotonic_ns();
+    if (now >= deadline_ns)
+        return 0;
+    uint64_t left = deadline_ns - now;
+    ts->tv_sec = (time_t)(left / 1000000000ull);
+    ts->tv_nsec = (long)(left % 1000000000ull);
+    return 1;
+}
+
+// ---------- header field access ----------
+
+static inline uint32_t *fipc_u32_at(void *base, size_t off)
+{
+    return (uint32_t *)((uint8_t *)base + off);
+}
+static inline void fipc_u32_store_rel(void *base, size_t off, uint32_t v)
+{
+    __atomic_store_n(fipc_u32_at(base, off), v, __ATOMIC_RELEASE);
+}
+static inline uint32_t fipc_u32_load_acq(void *base, size_t off)
+{
+    return __atomic_load_n(fipc_u32_at(base, off), __ATOMIC_ACQUIRE);
+}
+static inline uint32_t fipc_u32_xchg_rel(void *base, size_t off, uint32_t v)
+{
+    return __atomic_exchange_n(fipc_u32_at(base, off), v, __ATOMIC_RELEASE);
+}
+static inline int fipc_u32_cas_acqrel(void *base, size_t off, uint32_t *expected, uint32_t desired)
+{
+    return __atomic_compare_exchange_n(fipc_u32_at(base, off), expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+// Diagnostic u64 fields (timestamps) are not guaranteed to be 8-byte aligned.
+static inline void fipc_u64_store_unaligned(void *base, size_t off, uint64_t v)
+{
+    memcpy((uint8_t *)base + off, &v, sizeof(v));
+}
+static inline uint64_t fipc_u64_load_unaligned(void *base, size_t off)
+{
+    uint64_t v;
+    memcpy(&v, (uint8_t *)base + off, sizeof(v));
+    return v;
+}
+
+// ---------- futex ----------
+
+static inline long fipc_futex_wait_sys(uint32_t *uaddr, uint32_t val, const struct timespec *ts, int shared)
+{
+    int op = shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+    return syscall(SYS_futex, uaddr, op, val, ts, NULL, 0);
+}
+
+static inline long fipc_futex_wake_sys(uint32_t *uaddr, int n, int shared)
+{
+    int op = shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    return syscall(SYS_futex, uaddr, op, n, NULL, NULL, 0);
+}
+
+// Single futex wait with a relative timeout (timeout_ns < 0 waits forever).
+// Returns 0 when woken, -EAGAIN if *uaddr != expected, -ETIMEDOUT or -EINTR.
+static inline int fipc_futex_wait(uint32_t *uaddr, uint32_t expected, int64_t timeout_ns, int shared)
+{
+    struct timespec ts, *pts = NULL;
+    if (timeout_ns >= 0)
+    {
+        ts.tv_sec = (time_t)(timeout_ns / 1000000000LL);
+        ts.tv_nsec = (long)(timeout_ns % 1000000000LL);
+        pts = &ts;
+    }
+    if (fipc_futex_wait_sys(uaddr, expected, pts, shared) == 0)
+        return 0;
+    return -errno;
+}
+
+// Returns the number of waiters woken.
+static inline int fipc_futex_wake(uint32_t *uaddr, int n, int shared)
+{
+    long r = fipc_futex_wake_sys(uaddr, n, shared);
+    return r < 0 ? -errno : (int)r;
+}
+
+// ---------- header identity ----------
+
+// 0 if base holds a header with the given magic and a compatible layout version.
+static inline int fipc_header_check(void *base, uint32_t magic)
+{
+    if (fipc_u32_load_acq(base, 0) != magic)
+        return -EPROTO;
+    uint32_t version = fipc_u32_load_acq(base, 4);
+    if (version != 0 && version != FASTIPC_LAYOUT_VERSION)
+        return -EPROTO;
+    return 0;
+}
+
+// ---------- mutex ----------
+
+static inline void fipc_mutex_mark_owner(void *base)
+{
+    fipc_u32_store_rel(base, FASTIPC_MUTEX_OFF_OWNER, (uint32_t)getpid());
+    fipc_u64_store_unaligned(base, FASTIPC_MUTEX_OFF_LASTNS, fipc_now_realtime_ns());
+}
+
+// Stamp magic and layout version; the lock state is left as is so attaching is safe.
+static inline int fipc_mutex_init(void *base)
+{
+    fipc_u32_store_rel(base, FASTIPC_MUTEX_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+    fipc_u32_store_rel(base, FASTIPC_MUTEX_OFF_MAGIC, FASTIPC_MUTEX_MAGIC);
+    return 0;
+}
+
+static inline int fipc_mutex_try_acquire(void *base)
+{
+    uint32_t expected = 0;
+    if (fipc_u32_cas_acqrel(base, FASTIPC_MUTEX_OFF_STATE, &expected, 1))
+    {
+        fipc_mutex_mark_owner(base);
+        return 0;
+    }
+    return -EBUSY;
+}
+
+// Spin up to `spin` times, then sleep on the futex. timeout_ns: -1 = infinite, 0 = no sleep.
+static inline int fipc_mutex_acquire_ns(void *base, int shared, int64_t timeout_ns, int spin)
+{
+    uint32_t *state = fipc_u32_at(base, FASTIPC_MUTEX_OFF_STATE);
+    if (fipc_mutex_try_acquire(base) == 0)
+        return 0;
+    for (int i = 0; i < spin; i++)
+    {
+        if (__atomic_load_n(state, __ATOMIC_RELAXED) == 0)
+        {
+            uint32_t e = 0;
+            if (__atomic_compare_exchange_n(state, &e, 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            {
+                fipc_mutex_mark_owner(base);
+                return 0;
+            }
+        }
+        FASTIPC_CPU_RELAX();
+    }
+    if (timeout_ns == 0)
+        return -ETIMEDOUT;
+
+    uint64_t deadline = timeout_ns > 0 ? fipc_now_monotonic_ns() + (uint64_t)timeout_ns : 0;
+    struct timespec ts, *pts = NULL;
+    while (__atomic_exchange_n(state, 2, __ATOMIC_ACQUIRE) != 0)
+    {
+        if (deadline)
+        {
+            if (!fipc_deadline_remaining(deadline, &ts))
+                return -ETIMEDOUT;
+            pts = &ts;
+        }
+        fipc_futex_wait_sys(state, 2, pts, shared); // spurious wakes tolerated
+    }
+    // Keep state=2 (contended) to ensure release will wake waiters.
+    fipc_mutex_mark_owner(base);
+    return 0;
+}
+
+static inline int fipc_mutex_acquire(void *base, int shared)
+{
+    return fipc_mutex_acquire_ns(base, shared, -1, 16);
+}
+
+static inline int fipc_mutex_force_release(void *base, int shared)
+{
+    // Clear owner before unlocking so we never erase the PID of the next owner.
+    fipc_u32_store_rel(base, FASTIPC_MUTEX_OFF_OWNER, 0);
+    // Wake exactly one waiter only if we observed contended state (2)
+    if (fipc_u32_xchg_rel(base, FASTIPC_MUTEX_OFF_STATE, 0) == 2)
+        fipc_futex_wake_sys(fipc_u32_at(base, FASTIPC_MUTEX_OFF_STATE), 1, shared);
+    return 0;
+}
+
+static inline int fipc_mutex_release(void *base, int shared)
+{
+    if (fipc_u32_load_acq(base, FASTIPC_MUTEX_OFF_OWNER) != (uint32_t)getpid())
+        return -EPERM;
+    return fipc_mutex_force_release(base, shared);
+}
+
+// ---------- semaphore ----------
+
+static inline int fipc_semaphore_init(void *base, uint32_t initial)
+{
+    fipc_u32_store_rel(base, FASTIPC_SEM_OFF_VERSION, FASTIPC_LAYOUT_VERSION);
+    fipc_u32_store_rel(base, FASTIPC_SEM_OFF_MAGIC, FASTIPC_SEM_MAGIC);
+    fipc_u32_store_rel(base, FASTIPC_SEM_OFF_COUNT, initial);
+    return 0;
+}
+
+static inline int fipc_semaphore_try_take(void *base)
+{
+    uint32_t *c = fipc_u32_at(base, FASTIPC_SEM_OFF_COUNT);
+    uint32_t v = __atomic_load_n(c, __ATOMIC_ACQUIRE);
+    while (v > 0)
+    {
+        if (__atomic_compare_exchange_n(c, &v, v - 1, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            fipc_u32_store_rel(base, FASTIPC_SEM_OFF_LASTPID, (uint32_t)getpid());
+            fipc_u64_store_unaligned(base, FASTIPC_SEM_OFF_LASTNS, fipc_now_realtime_ns());
+            return 0;
+        }
+    }
+    return -EAGAIN;
+}
+
+// Add n tokens; wakes up to n sleepers only on the 0 -> n transition.
+static inline int fipc_semaphore_post(void *base, int shared, uint32_t n)
+{
+    uint32_t *c = fipc_u32_at(base, FASTIPC_SEM_OFF_COUNT);
+    if (n == 0)
+        return 0;
+    uint32_t cur = __atomic_load_n(c, __ATOMIC_ACQUIRE);
+    do
+    {
+        if (cur > UINT32_MAX - n)
+            return -EOVERFLOW;
+    } while (!__atomic_compare_exchange_n(c, &cur, cur + n, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    if (cur == 0)
+        fipc_futex_wake_sys(c, n > (uint32_t)INT_MAX ? INT_MAX : (int)n, shared);
+    return 0;
+}
+
+// Take one token. Spins up to `spin` attempts between sleeps. timeout_ns: -1 = infinite,
+// 0 = no sleep. Returns 0 or -ETIMEDOUT.
+static inline int fipc_semaphore_wait(void *base, int shared, int64_t timeout_ns, int spin)
+{
+    uint32_t *c = fipc_u32_at(base, FASTIPC_SEM_OFF_COUNT);
+    uint64_t deadline = timeout_ns > 0 ? fipc_now_monotonic_ns() + (uint64_t)timeout_ns : 0;
+    struct timespec ts, *pts = NULL;
+    for (;;)
+    {
+        int i = 0;
+        do
+        {
+            if (fipc_semaphore_try_take(base) == 0)
+                return 0;
+            FASTIPC_CPU_RELAX();
+        } while (++i < spin);
+        if (timeout_ns == 0)
+            return -ETIMEDOUT;
+        if (deadline)
+        {
+            if (!fipc_deadline_remaining(deadline, &ts))
+                return -ETIMEDOUT;
+            pts = &ts;
+        }
+        fipc_futex_wait_sys(c, 0, pts, shared); // spurious wake-ups tolerated
+    }
+}
+
+// ---------- atomic read-modify-write on naturally aligned words ----------
+
+static inline uint32_t fipc_u32_fetch_add(uint32_t *addr, uint32_t v)
+{
+    return __atomic_fetch_add(addr, v, __ATOMIC_ACQ_REL);
+}
+static inline uint64_t fipc_u64_fetch_add(uint64_t *addr, uint64_t v)
+{
+    return __atomic_fetch_add(addr, v, __ATOMIC_ACQ_REL);
+}
+static inline uint32_t fipc_u32_exchange(uint32_t *addr, uint32_t v)
+{
+    return __atomic_exchange_n(addr, v, __ATOMIC_ACQ_REL);
+}
+static inline uint64_t fipc_u64_exchange(uint64_t *addr, uint64_t v)
+{
+    return __atomic_exchange_n(addr, v, __ATOMIC_ACQ_REL);
+}
+static inline int fipc_u32_cas(uint32_t *addr, uint32_t *expected, uint32_t desired)
+{
+    return __atomic_compare_exchange_n(addr, expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+static inline int fipc_u64_cas(uint64_t *addr, uint64_t *expected, uint64_t desired)
+{
+    return __atomic_compare_exchange_n(addr, expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FASTIPC_H
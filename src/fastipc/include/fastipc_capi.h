@@ -0,0 +1,89 @@
+// fastipc_capi.h
+//
+// Native access to the fastipc lock fast paths without going through Python.
+// The function table is exported as the capsule "fastipc._primitives._C_API".
+//
+// Every entry takes the base address of a 64-byte primitive header (the same
+// memory a fastipc.Mutex / fastipc.Semaphore is constructed over) and never
+// touches the interpreter, so it may be called with the GIL released.
+// Return values are 0 on success or a negative errno:
+//   -EBUSY      try_acquire found the mutex held
+//   -ETIMEDOUT  a timed wait expired (timeout_ns: -1 = infinite, 0 = no sleep)
+//   -EPERM      mutex_release called by a process that does not own the lock
+//   -EOVERFLOW  semaphore_post would overflow the 32-bit count
+// `shared` selects a process-shared (1) or process-private (0) futex and must
+// match the value used by every other party on the same header.
+#ifndef FASTIPC_CAPI_H
+#define FASTIPC_CAPI_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FASTIPC_CAPI_CAPSULE "fastipc._primitives._C_API"
+// Bumped only on incompatible changes; new entries are appended and detected via `size`.
+#define FASTIPC_CAPI_VERSION 1
+
+typedef struct FastIPC_CAPI
+{
+    uint32_t version; // FASTIPC_CAPI_VERSION of the providing module
+    uint32_t size;    // sizeof(FastIPC_CAPI) of the providing module
+
+    // Mutex (64-byte header)
+    int (*mutex_init)(void *base);
+    int (*mutex_try_acquire)(void *base);
+    int (*mutex_acquire)(void *base, int shared);
+    int (*mutex_acquire_ns)(void *base, int shared, int64_t timeout_ns, int spin);
+    int (*mutex_release)(void *base, int shared);
+    int (*mutex_force_release)(void *base, int shared);
+
+    // Semaphore (64-byte header)
+    int (*semaphore_init)(void *base, uint32_t initial);
+    int (*semaphore_post)(void *base, int shared, uint32_t n);
+    int (*semaphore_wait)(void *base, int shared, int64_t timeout_ns, int spin);
+
+    // Raw futex on any 4-byte aligned word; futex_wake returns the number woken.
+    int (*futex_wait)(uint32_t *uaddr, uint32_t expected, int64_t timeout_ns, int shared);
+    int (*futex_wake)(uint32_t *uaddr, int n, int shared);
+
+    // Atomic read-modify-write (acq_rel) on naturally aligned words.
+    uint32_t (*u32_fetch_add)(uint32_t *addr, uint32_t v);
+    uint64_t (*u64_fetch_add)(uint64_t *addr, uint64_t v);
+    uint32_t (*u32_exchange)(uint32_t *addr, uint32_t v);
+    uint64_t (*u64_exchange)(uint64_t *addr, uint64_t v);
+    int (*u32_cas)(uint32_t *addr, uint32_t *expected, uint32_t desired);
+    int (*u64_cas)(uint64_t *addr, uint64_t *expected, uint64_t desired);
+} FastIPC_CAPI;
+
+#ifdef Py_PYTHON_H
+// Import the table; call once with the GIL held (e.g. from module init).
+// Returns NULL with an exception set on failure.
+static inline const FastIPC_CAPI *FastIPC_ImportCAPI(void)
+{
+    const FastIPC_CAPI *api = (const FastIPC_CAPI *)PyCapsule_Import(FASTIPC_CAPI_CAPSULE, 0);
+    if (api == NULL)
+        return NULL;
+    if (api->version != FASTIPC_CAPI_VERSION)
+    {
+        PyErr_Format(PyExc_ImportError, "fastipc C API version mismatch: expected %d, got %u",
+                     FASTIPC_CAPI_VERSION, (unsigned)api->version);
+        return NULL;
+    }
+    // A table from an older build may be shorter than the one this header describes.
+    if (api->size < sizeof(FastIPC_CAPI))
+    {
+        PyErr_Format(PyExc_ImportError, "fastipc C API table too small: expected %zu bytes, got %u",
+                     sizeof(FastIPC_CAPI), (unsigned)api->size);
+        return NULL;
+    }
+    return api;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FASTIPC_CAPI_H
@@ -0,0 +1,165 @@
+import array
+import fcntl
+import mmap
+import os
+import socket
+from multiprocessing import reduction
+from typing import Dict, Optional, Sequence, Union
+
+from fastipc import _mm
+
+__all__ = ["MemfdSharedMemory"]
+
+_FD_MSG = b"fastipc-memfd"
+
+
+def _rebuild(dup_fd) -> "MemfdSharedMemory":
+    return MemfdSharedMemory(fd=dup_fd.detach())
+
+
+class MemfdSharedMemory:
+    """
+    Anonymous shared memory backed by ``memfd_create``.
+
+    There is no name to collide on and nothing to clean up: the segment lives
+    exactly as long as some process holds its file descriptor or a mapping,
+    and the kernel reclaims it when the last one goes away (including crashes).
+    Share it by inheriting the object across ``fork``, passing it as a
+    ``multiprocessing`` argument (the fd is duplicated into the child), or
+    sending the fd over an ``AF_UNIX`` socket with ``send_fd``/``recv_fd``.
+    """
+
+    def __init__(
+        self,
+        size: int = 0,
+        *,
+        fd: Optional[int] = None,
+        name: str = "fastipc",
+        huge_pages: bool = False,
+        populate: bool = False,
+        lock: bool = False,
+        numa_node: Optional[Union[int, Sequence[int]]] = None,
+    ) -> None:
+        """
+        Create a new segment, or adopt an existing memfd.
+
+        Args:
+            size: Size of a new segment in bytes (ignored when fd is given).
+            *
+            fd: Descriptor of an existing segment; ownership passes to this object.
+            name: Label shown in /proc/<pid>/fd and /proc/<pid>/maps (need not be unique).
+            huge_pages, populate, lock, numa_node: Best-effort placement options, as for
+                GuardedSharedMemory; see ``effective_options``.
+        """
+        self._fd: Optional[int] = None
+        self._mmap: Optional[mmap.mmap] = None
+        self._buf: Optional[memoryview] = None
+        self._effective: Dict[str, bool] = {}
+
+        if fd is None:
+            if size <= 0:
+                raise ValueError("size must be a positive integer")
+            fd = os.memfd_create(name, os.MFD_CLOEXEC | os.MFD_ALLOW_SEALING)
+            try:
+                os.ftruncate(fd, size)
+                # Nobody may shrink the file under a peer's mapping (that would SIGBUS it).
+                fcntl.fcntl(fd, fcntl.F_ADD_SEALS, fcntl.F_SEAL_SHRINK)
+            except BaseException:
+                os.close(fd)
+                raise
+            self.created = True
+        else:
+            self.created = False
+        self._fd = fd
+
+        try:
+            self._size = os.fstat(fd).st_size
+            if self._size <= 0:
+                raise ValueError("memfd segment is empty")
+            self._mmap = mmap.mmap(fd, self._size, access=mmap.ACCESS_WRITE)
+            self._buf = memoryview(self._mmap)
+            self._effective = {
+                "numa_node": numa_node is not None and _mm.bind_numa(self._mmap, numa_node),
+                "huge_pages": huge_pages and _mm.advise_hugepages(self._mmap),
+                "populate": populate and _mm.populate(self._mmap),
+                "lock": lock and _mm.lock(self._mmap),
+            }
+        except BaseException:
+            self.close()
+            raise
+
+    @classmethod
+    def recv_fd(cls, sock: socket.socket, **kwargs) -> "MemfdSharedMemory":
+        """Receive a segment sent with ``send_fd`` on an AF_UNIX socket."""
+        fds = array.array("i")
+        msg, ancdata, _flags, _addr = sock.recvmsg(len(_FD_MSG), socket.CMSG_SPACE(fds.itemsize))
+        for level, type_, data in ancdata:
+            if level == socket.SOL_SOCKET and type_ == socket.SCM_RIGHTS:
+                fds.frombytes(data[: len(data) - (len(data) % fds.itemsize)])
+        if msg != _FD_MSG or len(fds) != 1:
+            for fd in fds:
+                os.close(fd)
+            raise RuntimeError("did not receive a fastipc memfd")
+        return cls(fd=fds[0], **kwargs)
+
+    def send_fd(self, sock: socket.socket) -> None:
+        """Send this segment's descriptor over an AF_UNIX socket (SCM_RIGHTS)."""
+        fds = array.array("i", [self.fileno()])
+        sock.sendmsg([_FD_MSG], [(socket.SOL_SOCKET, socket.SCM_RIGHTS, fds)])
+
+    def fileno(self) -> int:
+        if self._fd is None:
+            raise ValueError("Shared memory is closed")
+        return self._fd
+
+    def close(self) -> None:
+        """Unmap and close this handle; the memory is freed once no process holds it."""
+        if self._buf is not None:
+            try:
+                self._buf.release()
+            except BufferError:
+                pass
+            self._buf = None
+        if self._mmap is not None:
+            try:
+                self._mmap.close()
+            except Exception:
+                pass
+            self._mmap = None
+        if self._fd is not None:
+            try:
+                os.close(self._fd)
+            except OSError:
+                pass
+            self._fd = None
+
+    def __reduce__(self):
+        # DupFd hands the child its own descriptor under both fork and spawn contexts.
+        return _rebuild, (reduction.DupFd(self.fileno()),)
+
+    def __enter__(self) -> "MemfdSharedMemory":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def __del__(self) -> None:
+        try:
+            self.close()
+        except Exception:
+            pass
+
+    @property
+    def buf(self) -> memoryview:
+        if self._buf is None:
+            raise ValueError("Shared memory is closed")
+        return self._buf
+
+    @property
+    def size(self) -> int:
+        return self._size
+
+    @property
+    def effective_options(self) -> Dict[str, bool]:
+        """Which of huge_pages/populate/lock/numa_node actually took effect on this mapping."""
+        return dict(self._effective)
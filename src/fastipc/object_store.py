@@ -0,0 +1,349 @@
+from __future__ import annotations
+
+import os
+import struct
+import threading
+import time
+from contextlib import contextmanager
+from typing import Dict, Iterator, Tuple
+
+from fastipc._primitives import AtomicU32, Mutex
+from fastipc.guarded_shared_memory import GuardedSharedMemory, NoShmFoundError, _pid_alive
+
+__all__ = ["SharedObjectStore", "SharedView"]
+
+# Arena layout:
+#   0x00: u32 magic ('OBJS'), u32 layout version, u64 arena size, u32 generation counter,
+#         u32 pid of the process recovering the Mutex from a dead holder (0 = none)
+#   0x40: 64B Mutex guarding allocation
+#   0x80: blocks, tiling the rest of the arena. Each block is a 128B header + data:
+#     +0x00 u64 block size (header included)   +0x08 u32 state (0=free, 1=used)
+#     +0x0C u32 refcount                        +0x10 u32 generation
+#     +0x14 u32 ndim                            +0x18 u64 nbytes
+#     +0x20 u32 itemsize                        +0x28 char format[24]
+#     +0x40 u64 shape[8]
+_MAGIC = 0x4F424A53  # 'OBJS'
+_VERSION = 1
+_ARENA = struct.Struct("<IIQI")
+_OFF_GEN = 16
+_OFF_RECOVER = 20
+_OFF_MUTEX = 64
+_FIRST_BLOCK = 128
+
+_BLOCK = struct.Struct("<QIIIIQI4x24s8Q")
+_HDR = _BLOCK.size  # 128
+_B_STATE = 8
+_B_REFCOUNT = 12
+_MAX_NDIM = 8
+_MIN_SPLIT = 256
+_ALIGN = 64
+
+_OFFSET_BITS = 48
+_OFFSET_MASK = (1 << _OFFSET_BITS) - 1
+
+# How often a blocked alloc/free checks whether the Mutex holder is still alive.
+_LOCK_POLL_NS = 50_000_000
+
+
+def _round_up(n: int) -> int:
+    return (n + _ALIGN - 1) // _ALIGN * _ALIGN
+
+
+class SharedView:
+    """
+    A read-only view of a published object, mapped in place.
+
+    ``buffer`` carries the original format and shape, so ``numpy.asarray(view.buffer)``
+    (or ``memoryview`` consumers) read it without copying. Call ``release()`` (or use
+    ``with``) to drop this view's reference; the block is freed after the last one.
+    """
+
+    def __init__(self, store: "SharedObjectStore", handle: int, offset: int) -> None:
+        self._store = store
+        self.handle = handle
+        self._offset = offset
+        hdr = _BLOCK.unpack_from(store._arena, offset)
+        self.nbytes = hdr[5]
+        self.itemsize = hdr[6]
+        self.format = hdr[7].rstrip(b"\0").decode("ascii")
+        self.shape: Tuple[int, ...] = tuple(hdr[8 : 8 + hdr[4]])
+        # Data is always stored C-contiguous, so strides follow from the shape.
+        strides = []
+        step = self.itemsize
+        for dim in reversed(self.shape):
+            strides.append(step)
+            step *= dim
+        self.strides: Tuple[int, ...] = tuple(reversed(strides))
+        raw = store._arena[offset + _HDR : offset + _HDR + self.nbytes].toreadonly()
+        try:
+            self.buffer = raw.cast("B").cast(self.format, self.shape) if self.shape else raw
+        except (TypeError, ValueError):
+            # Formats memoryview cannot cast to (e.g. structs) stay as raw bytes.
+            self.buffer = raw
+
+    def release(self) -> None:
+        """Drop this view's reference; the last reference frees the block."""
+        if self._store is None:
+            return
+        try:
+            self.buffer.release()
+        except BufferError:
+            pass
+        store, self._store = self._store, None
+        store._decref(self._offset)
+
+    def __enter__(self) -> "SharedView":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.release()
+
+    def __del__(self) -> None:
+        try:
+            self.release()
+        except Exception:
+            pass
+
+
+class SharedObjectStore:
+    """
+    A shared arena for zero-copy exchange of buffer-protocol objects.
+
+    ``publish(obj)`` copies the object's bytes into the arena once, next to a
+    small header (format, shape, itemsize, size, refcount), and returns an
+    integer handle that can be sent to other processes. ``open(handle)`` maps
+    the data in place as a read-only view. A cross-process refcount frees the
+    block when the last reference is dropped. If a process dies holding the
+    allocation lock, the next process that needs it takes it back.
+    """
+
+    def __init__(self, name: str, size: int = 64 << 20) -> None:
+        """
+        Create or attach the store's arena.
+
+        Args:
+            name: Symbolic name of the arena segment.
+            size: Arena size in bytes when creating it (ignored when attaching).
+        """
+        if size < _FIRST_BLOCK + _HDR + _ALIGN:
+            raise ValueError("size too small for an object store")
+        shm_name = f"__pyfastipc_store_{name}"
+        try:
+            # Attachers take whatever size the creator chose.
+            self._shm = GuardedSharedMemory(shm_name, size=_FIRST_BLOCK, attach_only=True)
+        except NoShmFoundError:
+            self._shm = GuardedSharedMemory(shm_name, size=_round_up(size))
+        self._arena = self._shm.buf
+        self._name = name
+        if self._shm.created:
+            self._format()
+        else:
+            self._wait_formatted()
+        self._size = _ARENA.unpack_from(self._arena, 0)[2]
+        self._mutex = Mutex(self._arena[_OFF_MUTEX : _OFF_MUTEX + 64], shared=True)
+        self._generation = AtomicU32(self._arena[_OFF_GEN : _OFF_GEN + 4])
+        self._recovering = AtomicU32(self._arena[_OFF_RECOVER : _OFF_RECOVER + 4])
+        # The shared Mutex is per process; this serializes our own threads in front of it.
+        self._local = threading.Lock()
+
+    def _format(self) -> None:
+        size = len(self._arena)
+        self._arena[: _FIRST_BLOCK + _HDR] = bytes(_FIRST_BLOCK + _HDR)
+        _BLOCK.pack_into(self._arena, _FIRST_BLOCK, size - _FIRST_BLOCK, 0, 0, 0, 0, 0, 0, b"", *([0] * _MAX_NDIM))
+        Mutex(self._arena[_OFF_MUTEX : _OFF_MUTEX + 64], shared=True)
+        # Magic last: attachers wait for it.
+        struct.pack_into("<IQ", self._arena, 4, _VERSION, size)
+        AtomicU32(self._arena[0:4]).store(_MAGIC)
+
+    def _wait_formatted(self, timeout: float = 5.0) -> None:
+        magic = AtomicU32(self._arena[0:4])
+        deadline = time.monotonic() + timeout
+        while magic.load() != _MAGIC:
+            if time.monotonic() > deadline:
+                raise RuntimeError(f"object store '{self._name}' was never initialized")
+            time.sleep(0.001)
+
+    @contextmanager
+    def _locked(self) -> Iterator[None]:
+        with self._local:
+            # Wait in slices so a holder that died mid-alloc/free does not block us forever.
+            while not self._mutex.acquire_ns(_LOCK_POLL_NS):
+                self._recover_lock()
+            try:
+                yield
+            finally:
+                self._mutex.release()
+
+    def _recover_lock(self) -> None:
+        # One recoverer at a time: two of them could otherwise both see the same dead
+        # owner, and the second would release the lock the first one just took.
+        me = os.getpid()
+        holder = self._recovering.load()
+        if holder and (holder == me or _pid_alive(holder)):
+            return
+        if not self._recovering.cas(holder, me):
+            return
+        try:
+            owner = self._mutex.owner_pid()
+            if owner and not _pid_alive(owner):
+                # Headers are written whole, so the arena stays walkable; at worst the
+                # block the dead holder was allocating leaks.
+                self._mutex.force_release()
+        finally:
+            self._recovering.store(0)
+
+    def _refcount(self, offset: int) -> AtomicU32:
+        return AtomicU32(self._arena[offset + _B_REFCOUNT : offset + _B_REFCOUNT + 4])
+
+    def _alloc(self, nbytes: int) -> int:
+        need = _HDR + _round_up(max(nbytes, 1))
+        end = self._size
+        off = _FIRST_BLOCK
+        while off < end:
+            size, state = struct.unpack_from("<QI", self._arena, off)
+            if state == 0:
+                # Coalesce following free blocks lazily, while we are scanning anyway.
+                nxt = off + size
+                while nxt < end:
+                    nsize, nstate = struct.unpack_from("<QI", self._arena, nxt)
+                    if nstate != 0:
+                        break
+                    size += nsize
+                    nxt += nsize
+                if size >= need:
+                    if size - need >= _MIN_SPLIT:
+                        struct.pack_into("<QI", self._arena, off + need, size - need, 0)
+                        size = need
+                    # Zero refcount/generation: a split tail may hold stale payload bytes.
+                    struct.pack_into("<QIII", self._arena, off, size, 1, 0, 0)
+                    return off
+                struct.pack_into("<Q", self._arena, off, size)
+            off += size
+        raise MemoryError(f"object store '{self._name}' has no free block of {need} bytes")
+
+    def publish(self, obj, refs: int = 1) -> int:
+        """
+        Copy a buffer-protocol object into the arena.
+
+        Non-contiguous sources are compacted to C order on the way in.
+
+        Args:
+            obj: Any object exporting a buffer (bytes, array, numpy/Arrow buffers, ...).
+            refs: References handed out with the handle; each ``open()`` adopts one.
+
+        Returns:
+            An integer handle, valid in every process attached to this store.
+        """
+        if refs <= 0:
+            raise ValueError("refs must be a positive integer")
+        src = memoryview(obj)
+        if src.ndim > _MAX_NDIM:
+            raise ValueError(f"at most {_MAX_NDIM} dimensions are supported")
+        fmt = src.format.encode("ascii")
+        if len(fmt) > 24:
+            raise ValueError(f"buffer format {src.format!r} is too long")
+        nbytes = src.nbytes
+        with self._locked():
+            off = self._alloc(nbytes)
+            gen = self._generation.load() + 1
+            self._generation.store(gen)
+        data = self._arena[off + _HDR : off + _HDR + nbytes]
+        try:
+            data[:] = src.cast("B") if src.c_contiguous else src.tobytes()
+        finally:
+            data.release()
+        shape = list(src.shape) + [0] * (_MAX_NDIM - src.ndim)
+        _BLOCK.pack_into(self._arena, off, struct.unpack_from("<Q", self._arena, off)[0], 1, 0, gen, src.ndim, nbytes, src.itemsize, fmt, *shape)
+        # Publishing the refcount last makes the block openable only once it is complete.
+        self._refcount(off).store(refs)
+        return ((gen & 0xFFFF) << _OFFSET_BITS) | off
+
+    def _resolve(self, handle: int) -> int:
+        off = handle & _OFFSET_MASK
+        if off < _FIRST_BLOCK or off % _ALIGN or off + _HDR > self._size:
+            raise KeyError(handle)
+        _, state, rc, gen = struct.unpack_from("<QIII", self._arena, off)
+        if state != 1 or rc == 0 or (gen & 0xFFFF) != handle >> _OFFSET_BITS:
+            raise KeyError(handle)
+        return off
+
+    def open(self, handle: int, adopt: bool = True) -> SharedView:
+        """
+        Map a published object in place.
+
+        Args:
+            handle: A handle returned by ``publish``.
+            adopt: Take over one of the references created by ``publish``
+                (the usual handoff). False adds a new reference instead, for a
+                caller that already holds one and wants a second view.
+
+        Returns:
+            A SharedView over the data.
+
+        Raises:
+            KeyError: The handle is stale (its block was freed).
+        """
+        off = self._resolve(handle)
+        if not adopt:
+            rc = self._refcount(off)
+            while True:
+                cur = rc.load()
+                if cur == 0:
+                    raise KeyError(handle)
+                if rc.cas(cur, cur + 1):
+                    break
+            try:
+                self._resolve(handle)  # block could have been freed and reused meanwhile
+            except KeyError:
+                self._decref(off)
+                raise
+        return SharedView(self, handle, off)
+
+    def release(self, handle: int) -> None:
+        """Drop a published reference that will never be opened."""
+        self._decref(self._resolve(handle))
+
+    def _decref(self, off: int) -> None:
+        rc = self._refcount(off)
+        while True:
+            cur = rc.load()
+            if cur == 0:
+                return
+            if rc.cas(cur, cur - 1):
+                break
+        if cur == 1:
+            with self._locked():
+                struct.pack_into("<I", self._arena, off + _B_STATE, 0)
+
+    def stats(self) -> Dict[str, int]:
+        """Return block counts and byte totals (a racy snapshot)."""
+        used = free = used_blocks = free_blocks = 0
+        off = _FIRST_BLOCK
+        while off < self._size:
+            size, state = struct.unpack_from("<QI", self._arena, off)
+            if state:
+                used, used_blocks = used + size, used_blocks + 1
+            else:
+                free, free_blocks = free + size, free_blocks + 1
+            off += size
+        return {"used_bytes": used, "free_bytes": free, "used_blocks": used_blocks, "free_blocks": free_blocks}
+
+    @property
+    def name(self) -> str:
+        return self._name
+
+    @property
+    def size(self) -> int:
+        return self._size
+
+    def close(self) -> None:
+        """Detach from the arena (unlinked when the last process detaches)."""
+        self._mutex = self._generation = self._recovering = None
+        self._arena = None
+        self._shm.close()
+
+    def __enter__(self) -> "SharedObjectStore":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
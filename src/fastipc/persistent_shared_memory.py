@@ -0,0 +1,338 @@
+import fcntl
+import mmap
+import os
+import struct
+import tempfile
+import time
+from contextlib import contextmanager
+from typing import Dict, Iterator, Optional, Sequence, Union
+
+from fastipc import _mm
+from fastipc._primitives import LeaseTable, Mutex
+from fastipc.guarded_shared_memory import _lease_alive, _lease_header_size, _lease_key, _pid_alive
+
+__all__ = ["PersistentSharedMemory"]
+
+# File layout:
+#   0x00: u32 magic ('PSHM'), u32 layout version, u64 user size
+#   0x10: u32 clean flag (1 = the last process detached cleanly), u32 lease slots
+#   0x18: 16B boot id of the session that last opened the file
+#   0x28: u64 checkpoint time (CLOCK_REALTIME ns, 0 = never), u64 cold opens
+#   0x40: LeaseTable of attached processes
+#   then, page aligned: user data
+_MAGIC = 0x4D485350  # 'PSHM'
+_VERSION = 1
+_HDR = struct.Struct("<IIQII16sQQ")
+_OFF_CLEAN = 16
+_OFF_BOOT_ID = 24
+_OFF_CHECKPOINT = 40
+_OFF_COLD_OPENS = 48
+_OFF_LEASES = 64
+
+
+def _boot_id() -> bytes:
+    try:
+        with open("/proc/sys/kernel/random/boot_id") as f:
+            return bytes.fromhex(f.read().strip().replace("-", ""))
+    except (OSError, ValueError):
+        return bytes(16)
+
+
+def _data_offset(slots: int) -> int:
+    end = _OFF_LEASES + _lease_header_size(slots)
+    return (end + mmap.PAGESIZE - 1) // mmap.PAGESIZE * mmap.PAGESIZE
+
+
+class PersistentSharedMemory:
+    """
+    Shared memory backed by a regular file, so its contents survive the last
+    process exiting and, on a disk-backed file system, a reboot.
+
+    The file starts with a header (magic, layout version, clean-shutdown flag,
+    boot id) and the same lease table GuardedSharedMemory uses to track
+    attached processes. Opening validates the header; the first process to
+    attach after everyone else went away (a *cold open*) learns whether the
+    previous session shut down cleanly from ``was_clean`` and has the mutexes
+    listed in ``lock_offsets`` released if their owner is gone. Nothing is
+    unlinked on close: call ``checkpoint()`` or ``flush()`` to make state
+    durable, and delete the file to start over.
+    """
+
+    def __init__(
+        self,
+        path: Union[str, os.PathLike],
+        size: int = 0,
+        *,
+        max_procs: int = 120,
+        lock_offsets: Sequence[int] = (),
+        huge_pages: bool = False,
+        populate: bool = False,
+        lock: bool = False,
+        numa_node: Optional[Union[int, Sequence[int]]] = None,
+    ) -> None:
+        """
+        Create or open a file-backed segment.
+
+        Args:
+            path: File to map; created if missing (use a local disk or tmpfs).
+            size: Usable size in bytes when creating the file; 0 opens an existing
+                file at whatever size it has. A non-zero size must match the file.
+            *
+            max_procs: Lease slots for concurrently attached processes (when creating).
+            lock_offsets: Offsets in ``buf`` of 64-byte Mutex headers whose dead owners
+                are released on open.
+            huge_pages, populate, lock, numa_node: Best-effort placement options, as for
+                GuardedSharedMemory; see ``effective_options``.
+
+        Raises:
+            FileNotFoundError: The file does not exist and size is 0.
+            ValueError: The file is not a fastipc segment, has another layout version,
+                or its size differs from ``size``. A non-empty file that exists is
+                never reformatted.
+        """
+        if size < 0:
+            raise ValueError("size must be a non-negative integer")
+        if max_procs <= 0:
+            raise ValueError("max_procs must be a positive integer")
+        self._path = os.fspath(path)
+        self._fd: Optional[int] = None
+        self._mmap: Optional[mmap.mmap] = None
+        self._view: Optional[memoryview] = None
+        self._buf: Optional[memoryview] = None
+        self._leases: Optional[LeaseTable] = None
+        self._lease_index = -1
+        self._lease_key = _lease_key()
+        self._pid = os.getpid()
+        self._effective: Dict[str, bool] = {}
+        self.created = False
+        self.recovered = False
+        self.was_clean = True
+
+        try:
+            self._open_file(size, max_procs)
+            with self._file_lock():
+                if self.created:
+                    pass
+                elif os.fstat(self._fd).st_size == 0:
+                    # An empty file holds nothing to lose; format it in place.
+                    if not size:
+                        raise ValueError(f"'{self._path}' is empty")
+                    self._format(size, max_procs)
+                else:
+                    self._map()
+                    if size and size != self._size:
+                        raise ValueError(f"'{self._path}' holds {self._size} bytes, not {size}")
+                self._open_session(lock_offsets)
+            self._effective = {
+                "numa_node": numa_node is not None and _mm.bind_numa(self._mmap, numa_node),
+                "huge_pages": huge_pages and _mm.advise_hugepages(self._mmap),
+                "populate": populate and _mm.populate(self._mmap),
+                "lock": lock and _mm.lock(self._mmap),
+            }
+        except BaseException:
+            self._detach()
+            raise
+
+    def _open_file(self, size: int, slots: int) -> None:
+        while True:
+            try:
+                self._fd = os.open(self._path, os.O_RDWR | os.O_CLOEXEC)
+                return
+            except FileNotFoundError:
+                if not size:
+                    raise
+            # Format under a temporary name and link it into place once the header is
+            # written: the path never names a half-built file, so nothing found there is
+            # ever mistaken for a crashed create. A crash leaves only the temporary file.
+            directory, base = os.path.split(self._path)
+            self._fd, tmp = tempfile.mkstemp(prefix=f".{base}.", suffix=".tmp", dir=directory or ".")
+            try:
+                self._format(size, slots)
+                try:
+                    os.link(tmp, self._path)
+                    return
+                except FileExistsError:
+                    self._detach()  # someone else created it first: open theirs
+                    self.created = False
+            finally:
+                os.unlink(tmp)
+
+    @contextmanager
+    def _file_lock(self) -> Iterator[None]:
+        # Opens and closes are serialized with flock, which the kernel drops if we crash.
+        fcntl.flock(self._fd, fcntl.LOCK_EX)
+        try:
+            yield
+        finally:
+            fcntl.flock(self._fd, fcntl.LOCK_UN)
+
+    def _format(self, size: int, slots: int) -> None:
+        data = _data_offset(slots)
+        os.ftruncate(self._fd, data + size)
+        self._mmap = mmap.mmap(self._fd, data + size, access=mmap.ACCESS_WRITE)
+        self._view = memoryview(self._mmap)
+        LeaseTable(self._view[_OFF_LEASES:data], slots)
+        _HDR.pack_into(self._view, 0, _MAGIC, _VERSION, size, 1, slots, _boot_id(), 0, 0)
+        self._mmap.flush(0, mmap.PAGESIZE)
+        self.created = True
+        self._map_views(slots, size)
+
+    def _map(self) -> None:
+        file_size = os.fstat(self._fd).st_size
+        self._mmap = mmap.mmap(self._fd, file_size, access=mmap.ACCESS_WRITE)
+        self._view = memoryview(self._mmap)
+        if file_size < _HDR.size:
+            raise ValueError(f"'{self._path}' is not a fastipc persistent segment")
+        magic, version, size, _, slots, _, _, _ = _HDR.unpack_from(self._view, 0)
+        if magic != _MAGIC:
+            raise ValueError(f"'{self._path}' is not a fastipc persistent segment")
+        if version != _VERSION:
+            raise ValueError(f"'{self._path}' has layout version {version}, expected {_VERSION}")
+        if slots == 0 or file_size < _data_offset(slots) + size:
+            raise ValueError(f"'{self._path}' is truncated")
+        self._map_views(slots, size)
+
+    def _map_views(self, slots: int, size: int) -> None:
+        data = _data_offset(slots)
+        self._data_offset = data
+        self._size = size
+        self._slots = slots
+        self._buf = self._view[data : data + size]
+
+    def _open_session(self, lock_offsets: Sequence[int]) -> None:
+        boot = _boot_id()
+        new_boot = bytes(self._view[_OFF_BOOT_ID : _OFF_BOOT_ID + 16]) != boot
+        lease_view = self._view[_OFF_LEASES : self._data_offset]
+        if new_boot:
+            # Every recorded holder died with the previous boot.
+            self._leases = LeaseTable(lease_view, self._slots)
+            self._view[_OFF_BOOT_ID : _OFF_BOOT_ID + 16] = boot
+        else:
+            self._leases = LeaseTable(lease_view)
+            for key in self._leases.holders():
+                if not _lease_alive(key):
+                    self._leases.evict(key)
+
+        if self._leases.count() == 0:
+            self.recovered = not self.created
+            self.was_clean = bool(struct.unpack_from("<I", self._view, _OFF_CLEAN)[0])
+            cold_opens = struct.unpack_from("<Q", self._view, _OFF_COLD_OPENS)[0]
+            struct.pack_into("<Q", self._view, _OFF_COLD_OPENS, cold_opens + 1)
+        for off in lock_offsets:
+            if off < 0 or off + 64 > self._size:
+                raise ValueError(f"lock offset {off} is outside the segment")
+            mtx = Mutex(self._buf[off : off + 64])
+            owner = mtx.owner_pid()
+            if owner and (new_boot or not _pid_alive(owner)):
+                mtx.force_release()
+
+        self._lease_index = self._leases.claim(self._lease_key)
+        # Dirty until the last process detaches cleanly.
+        struct.pack_into("<I", self._view, _OFF_CLEAN, 0)
+        self._mmap.flush(0, mmap.PAGESIZE)
+
+    def flush(self, offset: int = 0, length: Optional[int] = None) -> None:
+        """
+        Write dirty pages of ``buf[offset:offset + length]`` back to the file (msync).
+
+        Args:
+            offset: Start of the range in ``buf``.
+            length: Bytes to flush; None flushes to the end.
+        """
+        if self._mmap is None:
+            raise ValueError("Shared memory is closed")
+        if length is None:
+            length = self._size - offset
+        if offset < 0 or length < 0 or offset + length > self._size:
+            raise ValueError("flush range is outside the segment")
+        start = self._data_offset + offset
+        aligned = start - start % mmap.PAGESIZE  # msync needs a page-aligned start
+        self._mmap.flush(aligned, start + length - aligned)
+
+    def checkpoint(self) -> None:
+        """Flush the whole segment and record the checkpoint time in the header."""
+        if self._mmap is None:
+            raise ValueError("Shared memory is closed")
+        self._mmap.flush()
+        struct.pack_into("<Q", self._view, _OFF_CHECKPOINT, time.time_ns())
+        self._mmap.flush(0, mmap.PAGESIZE)
+
+    @property
+    def last_checkpoint_ns(self) -> int:
+        """Wall-clock time of the last ``checkpoint()`` in ns since the epoch, or 0."""
+        if self._view is None:
+            raise ValueError("Shared memory is closed")
+        return struct.unpack_from("<Q", self._view, _OFF_CHECKPOINT)[0]
+
+    def get_num_procs(self) -> int:
+        """Get the number of processes currently attached."""
+        return 0 if self._leases is None else self._leases.count()
+
+    def close(self) -> None:
+        """
+        Detach; the last process to leave flushes the file and marks it clean.
+        """
+        if self._mmap is None:
+            return
+        # A forked child inherits the mapping but not the parent's lease.
+        if os.getpid() == self._pid and self._leases is not None:
+            with self._file_lock():
+                self._leases.release(self._lease_index, self._lease_key)
+                if all(not _lease_alive(key) for key in self._leases.holders()):
+                    self._mmap.flush()
+                    struct.pack_into("<I", self._view, _OFF_CLEAN, 1)
+                    self._mmap.flush(0, mmap.PAGESIZE)
+        self._detach()
+
+    def _detach(self) -> None:
+        self._leases = None
+        for view in (self._buf, self._view):
+            if view is not None:
+                try:
+                    view.release()
+                except BufferError:
+                    pass
+        self._buf = self._view = None
+        if self._mmap is not None:
+            try:
+                self._mmap.close()
+            except Exception:
+                pass
+            self._mmap = None
+        if self._fd is not None:
+            try:
+                os.close(self._fd)
+            except OSError:
+                pass
+            self._fd = None
+
+    def __enter__(self) -> "PersistentSharedMemory":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def __del__(self) -> None:
+        try:
+            self.close()
+        except Exception:
+            pass
+
+    @property
+    def buf(self) -> memoryview:
+        if self._buf is None:
+            raise ValueError("Shared memory is closed")
+        return self._buf
+
+    @property
+    def size(self) -> int:
+        return self._size
+
+    @property
+    def path(self) -> str:
+        return self._path
+
+    @property
+    def effective_options(self) -> Dict[str, bool]:
+        """Which of huge_pages/populate/lock/numa_node actually took effect on this mapping."""
+        return dict(self._effective)
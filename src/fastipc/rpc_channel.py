@@ -0,0 +1,332 @@
+from __future__ import annotations
+
+import os
+import struct
+import threading
+import time
+from typing import Callable, List, Optional, Union
+
+from fastipc._primitives import AtomicU32, FutexWord
+from fastipc.guarded_shared_memory import GuardedSharedMemory, NoShmFoundError, _pid_alive
+
+__all__ = ["RpcChannel", "RpcError"]
+
+# Segment layout:
+#   0x00: u32 magic ('RPCC'), u32 layout version, u32 slots, u32 slot size
+#   0x10: u32 doorbell: request counter in steps of 2, bit 0 = a server is asleep on it
+#   0x40: slots, each a 64B header followed by slot size bytes (request, then response):
+#     +0x00 u32 state (futex): low byte below, _WAITING while the client sleeps on it, and
+#           the pid the slot depends on in the top bits (the server's while PROCESSING or
+#           ABANDONED, else the client's), so slots of dead processes can be reclaimed
+#     +0x04 u32 payload length   +0x08 u32 status (0=ok, 1=handler error)
+#     +0x0C u32 client pid
+_MAGIC = 0x52504343  # 'RPCC'
+_VERSION = 1
+_OFF_DOORBELL = 16
+_FIRST_SLOT = 64
+_SLOT_HDR = 64
+
+_FREE = 0
+_CLAIMED = 1  # a client is writing its request
+_REQUEST = 2
+_PROCESSING = 3  # a server took the request
+_DONE = 4
+_ABANDONED = 5  # the client timed out while a server was processing
+_WAITING = 0x100
+_PID_SHIFT = 9  # Linux pids fit in 22 bits
+_PID_BITS = ~((1 << _PID_SHIFT) - 1) & 0xFFFFFFFF
+
+_LEN_STATUS = struct.Struct("<II")
+_INT_MAX = 0x7FFFFFFF
+
+# Spinning only pays off when the peer can run at the same time.
+_DEFAULT_SPIN_NS = 50_000 if len(os.sched_getaffinity(0)) > 1 else 0
+# How often a sleeping client checks that the server handling its request is alive.
+_LIVENESS_POLL_NS = 100_000_000
+# _claim backs off up to this long between scans of a full channel.
+_CLAIM_MAX_SLEEP = 0.002
+
+Handler = Callable[[memoryview], Union[bytes, bytearray, memoryview, None]]
+
+
+class RpcError(RuntimeError):
+    """The server's handler raised; the message carries the remote exception."""
+
+
+class RpcChannel:
+    """
+    A same-host request/response channel over shared memory.
+
+    Clients claim one of ``slots`` fixed-size mailboxes, write a request and ring
+    a futex doorbell; servers drain every pending mailbox per wakeup and write the
+    response in place. Both sides spin for ``spin_ns`` before sleeping, and each
+    side only issues a futex wake when the other actually went to sleep, so a busy
+    channel runs on atomics alone. Each slot records the process it is waiting on,
+    so slots left behind by dead clients are reclaimed and clients of a dead
+    server get an error instead of waiting forever.
+    """
+
+    def __init__(self, name: str, slots: int = 64, slot_size: int = 4096, spin_ns: int = _DEFAULT_SPIN_NS) -> None:
+        """
+        Create or attach the channel's segment.
+
+        Args:
+            name: Symbolic name shared by clients and servers.
+            slots: Concurrent in-flight calls (when creating; attachers use the creator's).
+            slot_size: Maximum request and response size in bytes (likewise).
+            spin_ns: Default busy-poll time before sleeping, for ``call`` and ``serve_batch``
+                (50 µs, or 0 when this process may only run on one CPU).
+        """
+        if slots <= 0 or slot_size <= 0:
+            raise ValueError("slots and slot_size must be positive integers")
+        stride = _SLOT_HDR + (slot_size + 63) // 64 * 64
+        shm_name = f"__pyfastipc_rpc_{name}"
+        try:
+            self._shm = GuardedSharedMemory(shm_name, size=_FIRST_SLOT, attach_only=True)
+        except NoShmFoundError:
+            self._shm = GuardedSharedMemory(shm_name, size=_FIRST_SLOT + slots * stride)
+        self._buf = self._shm.buf
+        self._name = name
+        self._spin_ns = spin_ns
+        magic = AtomicU32(self._buf[0:4])
+        if self._shm.created:
+            struct.pack_into("<III", self._buf, 4, _VERSION, slots, slot_size)
+            magic.store(_MAGIC)
+        else:
+            deadline = time.monotonic() + 5.0
+            while magic.load() != _MAGIC:
+                if time.monotonic() > deadline:
+                    raise RuntimeError(f"rpc channel '{name}' was never initialized")
+                time.sleep(0.001)
+        _, self._nslots, self._slot_size = struct.unpack_from("<III", self._buf, 4)
+        stride = _SLOT_HDR + (self._slot_size + 63) // 64 * 64
+
+        bell = self._buf[_OFF_DOORBELL : _OFF_DOORBELL + 4]
+        self._bell = AtomicU32(bell)
+        self._bell_futex = FutexWord(bell, shared=True)
+        self._offsets: List[int] = [_FIRST_SLOT + i * stride for i in range(self._nslots)]
+        self._state = [AtomicU32(self._buf[o : o + 4]) for o in self._offsets]
+        self._state_futex = [FutexWord(self._buf[o : o + 4], shared=True) for o in self._offsets]
+        self._data = [self._buf[o + _SLOT_HDR : o + _SLOT_HDR + self._slot_size] for o in self._offsets]
+        self._next_scan = 0
+
+    # ---- client ----
+
+    def _claim(self, deadline: Optional[int]) -> int:
+        n = self._nslots
+        pid = os.getpid()
+        start = (pid * 31 + threading.get_ident()) % n
+        mine = (pid << _PID_SHIFT) | _CLAIMED
+        delay = 0.0
+        reap_at = time.perf_counter_ns() + _LIVENESS_POLL_NS
+        while True:
+            for k in range(n):
+                i = (start + k) % n
+                if self._state[i].load() == _FREE and self._state[i].cas(_FREE, mine):
+                    return i
+            now = time.perf_counter_ns()
+            # Full for a while: hand back slots held up by dead processes.
+            if now >= reap_at:
+                reap_at = now + _LIVENESS_POLL_NS
+                if any([self._reclaim(i) for i in range(n)]):
+                    continue
+            if deadline is not None and now > deadline:
+                raise TimeoutError("no free rpc slot")
+            left = (deadline - now) / 1e9 if deadline is not None else delay
+            time.sleep(min(delay, left))
+            delay = min(max(delay * 2, 1e-5), _CLAIM_MAX_SLEEP)
+
+    def _reclaim(self, i: int) -> bool:
+        """Free slot ``i`` if the process it waits on died; True if it was freed."""
+        state = self._state[i]
+        cur = state.load()
+        base = cur & 0xFF
+        if base == _FREE or _pid_alive(cur >> _PID_SHIFT):
+            return False
+        if base == _PROCESSING:
+            # The server died; the client frees the slot itself unless it died too.
+            client = struct.unpack_from("<I", self._buf, self._offsets[i] + 12)[0]
+            if _pid_alive(client):
+                return False
+        return state.cas(cur, _FREE)
+
+    def _ring(self) -> None:
+        while True:
+            v = self._bell.load()
+            if self._bell.cas(v, (v + 2) & 0xFFFFFFFE):
+                break
+        if v & 1:
+            self._bell_futex.wake(_INT_MAX)
+
+    def call(self, request: Union[bytes, bytearray, memoryview], timeout_ns: int = -1, spin_ns: Optional[int] = None) -> bytes:
+        """
+        Send a request and wait for its response.
+
+        Args:
+            request: Request payload (at most ``slot_size`` bytes).
+            timeout_ns: Overall timeout in nanoseconds; -1 waits forever.
+            spin_ns: Busy-poll time before sleeping on the response (default: the channel's).
+
+        Returns:
+            The response payload.
+
+        Raises:
+            ValueError: The request does not fit in a slot.
+            TimeoutError: No response in time; the request is withdrawn.
+            RpcError: The server's handler raised, or the server died while handling the request.
+        """
+        req = memoryview(request).cast("B")
+        if req.nbytes > self._slot_size:
+            raise ValueError(f"request of {req.nbytes} bytes exceeds slot_size {self._slot_size}")
+        now = time.perf_counter_ns()
+        deadline = now + timeout_ns if timeout_ns >= 0 else None
+        i = self._claim(deadline)
+        state, futex, off = self._state[i], self._state_futex[i], self._offsets[i]
+        pid = os.getpid()
+        self._data[i][: req.nbytes] = req
+        struct.pack_into("<III", self._buf, off + 4, req.nbytes, 0, pid)
+        state.store((pid << _PID_SHIFT) | _REQUEST)
+        self._ring()
+
+        spin_end = time.perf_counter_ns() + (self._spin_ns if spin_ns is None else spin_ns)
+        check_at = spin_end + _LIVENESS_POLL_NS
+        while True:
+            cur = state.load()
+            if cur & 0xFF == _DONE:
+                break
+            now = time.perf_counter_ns()
+            if deadline is not None and now > deadline:
+                if self._withdraw(i):
+                    raise TimeoutError("rpc call timed out")
+                continue  # the response landed meanwhile
+            if now < spin_end:
+                continue
+            if now >= check_at:
+                check_at = now + _LIVENESS_POLL_NS
+                if cur & 0xFF == _PROCESSING and not _pid_alive(cur >> _PID_SHIFT):
+                    if state.cas(cur, _FREE):
+                        raise RpcError(f"server process {cur >> _PID_SHIFT} died while handling the request")
+                    continue
+            if not cur & _WAITING and not state.cas(cur, cur | _WAITING):
+                continue
+            # Wake up now and then to notice a server that died mid-request.
+            wait_ns = _LIVENESS_POLL_NS if deadline is None else min(max(deadline - now, 0), _LIVENESS_POLL_NS)
+            futex.wait(cur | _WAITING, wait_ns)
+
+        length, status = _LEN_STATUS.unpack_from(self._buf, off + 4)
+        response = bytes(self._data[i][:length])
+        state.store(_FREE)
+        if status:
+            raise RpcError(response.decode("utf-8", "replace"))
+        return response
+
+    def _withdraw(self, i: int) -> bool:
+        """Take back a timed-out request; False if its response is already there."""
+        state = self._state[i]
+        while True:
+            cur = state.load()
+            base = cur & 0xFF
+            if base == _DONE:
+                return False
+            # Not picked up yet: free the slot; being processed: the server frees it.
+            if state.cas(cur, _FREE if base == _REQUEST else _ABANDONED | (cur & _PID_BITS)):
+                return True
+
+    # ---- server ----
+
+    def _drain(self, handler: Handler, max_batch: int) -> int:
+        handled = 0
+        n = self._nslots
+        start = self._next_scan
+        me = os.getpid() << _PID_SHIFT
+        for k in range(n):
+            if handled >= max_batch:
+                break
+            i = (start + k) % n
+            state = self._state[i]
+            cur = state.load()
+            if cur & 0xFF != _REQUEST or not state.cas(cur, me | _PROCESSING | (cur & _WAITING)):
+                continue
+            client = cur & _PID_BITS
+            off = self._offsets[i]
+            length = _LEN_STATUS.unpack_from(self._buf, off + 4)[0]
+            status = 0
+            try:
+                response = handler(self._data[i][:length])
+                out = memoryview(b"" if response is None else response).cast("B")
+                if out.nbytes > self._slot_size:
+                    raise ValueError(f"response of {out.nbytes} bytes exceeds slot_size {self._slot_size}")
+            except Exception as exc:
+                status = 1
+                out = memoryview(f"{type(exc).__name__}: {exc}".encode()[: self._slot_size])
+            self._data[i][: out.nbytes] = out
+            _LEN_STATUS.pack_into(self._buf, off + 4, out.nbytes, status)
+            while True:
+                cur = state.load()
+                if cur & 0xFF == _ABANDONED:
+                    state.store(_FREE)
+                    break
+                if state.cas(cur, client | _DONE):
+                    if cur & _WAITING:
+                        self._state_futex[i].wake(1)
+                    break
+            handled += 1
+            self._next_scan = (i + 1) % n
+        return handled
+
+    def serve_batch(self, handler: Handler, max_batch: int = 64, timeout_ns: int = -1, spin_ns: Optional[int] = None) -> int:
+        """
+        Wait for requests and handle every pending one (up to ``max_batch``).
+
+        Args:
+            handler: Called with a memoryview of each request (valid only during the
+                call); returns the response bytes. Exceptions are sent back as RpcError.
+            max_batch: Maximum number of requests handled in this call.
+            timeout_ns: How long to wait for the first request; -1 waits forever.
+            spin_ns: Busy-poll time before sleeping on the doorbell (default: the channel's).
+
+        Returns:
+            The number of requests handled (0 on timeout).
+        """
+        deadline = time.perf_counter_ns() + timeout_ns if timeout_ns >= 0 else None
+        spin_end = time.perf_counter_ns() + (self._spin_ns if spin_ns is None else spin_ns)
+        while True:
+            seen = self._bell.load() & 0xFFFFFFFE
+            handled = self._drain(handler, max_batch)
+            if handled:
+                return handled
+            while True:
+                v = self._bell.load()
+                if v & 0xFFFFFFFE != seen:
+                    break  # rung since the scan
+                now = time.perf_counter_ns()
+                if deadline is not None and now > deadline:
+                    return 0
+                if now < spin_end:
+                    continue
+                if not v & 1 and not self._bell.cas(v, v | 1):
+                    continue
+                self._bell_futex.wait(v | 1, -1 if deadline is None else max(deadline - now, 0))
+
+    # ---- lifecycle ----
+
+    @property
+    def name(self) -> str:
+        return self._name
+
+    @property
+    def slot_size(self) -> int:
+        return self._slot_size
+
+    def close(self) -> None:
+        """Detach from the channel (unlinked when the last process detaches)."""
+        self._state = self._state_futex = self._data = []
+        self._bell = self._bell_futex = None
+        self._buf = None
+        self._shm.close()
+
+    def __enter__(self) -> "RpcChannel":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
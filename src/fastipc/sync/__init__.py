@@ -1,9 +1,11 @@
 from fastipc.sync.named_event import NamedEvent
 from fastipc.sync.named_mutex import NamedMutex
+from fastipc.sync.named_registry import NamedRegistry
 from fastipc.sync.named_semaphore import NamedSemaphore
 
 __all__ = [
     "NamedEvent",
     "NamedMutex",
+    "NamedRegistry",
     "NamedSemaphore",
 ]
\ No newline at end of file
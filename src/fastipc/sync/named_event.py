@@ -1,7 +1,10 @@
 from __future__ import annotations
 
+from typing import Optional
+
 from fastipc._primitives import FutexWord
 from fastipc.guarded_shared_memory import GuardedSharedMemory
+from fastipc.sync.named_registry import NamedRegistry
 
 
 class NamedEvent:
@@ -10,14 +13,22 @@ class NamedEvent:
     This class is designed to be used across different processes.
     """
 
-    def __init__(self, name: str) -> None:
+    def __init__(self, name: str, registry: Optional[NamedRegistry] = None) -> None:
         """
         Initialize the NamedEvent with a shared memory segment.
 
         :param name: The name of the event.
+        :param registry: Place the event in this registry instead of its own segment; it is
+            stored under ``"event:" + name``, so ``name`` may use at most 42 bytes of UTF-8.
         """
-        self._shm = GuardedSharedMemory(f"__pyfastipc_event_{name}", size=4)
         self._name = name
+        self._registry = registry
+        if registry is not None:
+            self._shm = None
+            # Registry payloads start zeroed, which is the cleared state.
+            self._futex = FutexWord(registry.slot(f"event:{name}"), shared=True)
+            return
+        self._shm = GuardedSharedMemory(f"__pyfastipc_event_{name}", size=4)
         self._futex = FutexWord(self._shm.buf, shared=True)
         if self._shm.created:
             self._futex.store_release(0)
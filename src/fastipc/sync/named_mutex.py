@@ -1,9 +1,11 @@
 from __future__ import annotations
 
 import atexit
+from typing import Optional
 
 from fastipc._primitives import Mutex
 from fastipc.guarded_shared_memory import GuardedSharedMemory
+from fastipc.sync.named_registry import NamedRegistry
 
 
 class NamedMutex:
@@ -19,13 +21,20 @@ class NamedMutex:
     Exposed helpers: force_release() for recovery, owner_pid(), last_acquired_ns().
     """
 
-    def __init__(self, name: str) -> None:
+    def __init__(self, name: str, registry: Optional[NamedRegistry] = None) -> None:
         """
         Create or attach a 64B shared-memory header for this mutex.
 
         :param name: Symbolic name for the shared memory region.
+        :param registry: Place the header in this registry instead of its own segment; it is
+            stored under ``"mutex:" + name``, so ``name`` may use at most 42 bytes of UTF-8.
         """
         self._name = name
+        self._registry = registry
+        if registry is not None:
+            self._shm = None
+            self._mutex = Mutex(registry.slot(f"mutex:{name}"), shared=True)
+            return
         self._shm = GuardedSharedMemory(f"__pyfastipc_mutex_{name}", size=64)
         self._mutex = Mutex(self._shm.buf, shared=True)
         # Initialize header only if we created the backing segment
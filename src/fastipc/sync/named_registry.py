@@ -0,0 +1,96 @@
+from __future__ import annotations
+
+import time
+from typing import Callable, Optional
+
+from fastipc._primitives import Registry
+from fastipc.guarded_shared_memory import GuardedSharedMemory, NoShmFoundError
+
+
+class NamedRegistry:
+    """
+    One shared segment holding many small named primitives.
+
+    Each name maps to a 64-byte, cache-line aligned payload inside a single
+    mapping, so attaching a primitive is a hash lookup rather than an
+    shm_open + mmap per name. Pass it as ``registry=`` to NamedEvent,
+    NamedMutex or NamedSemaphore. Names are permanent for the life of the
+    segment; size ``slots`` for every name you expect to register.
+
+    Keys are limited to 48 bytes of UTF-8. The named primitives store theirs
+    with a type prefix (``"event:"``, ``"mutex:"``, ``"sema:"``), which counts
+    towards that limit.
+    """
+
+    def __init__(self, name: str = "default", slots: int = 4096) -> None:
+        """
+        Create or attach the registry segment.
+
+        :param name: Symbolic name of the registry segment.
+        :param slots: Capacity in names when creating it (ignored when attaching).
+        """
+        self._name = name
+        shm_name = f"__pyfastipc_registry_{name}"
+        try:
+            # Attachers take whatever capacity the creator chose.
+            self._shm = GuardedSharedMemory(shm_name, size=64, attach_only=True)
+        except NoShmFoundError:
+            self._shm = GuardedSharedMemory(shm_name, size=Registry.required_size(slots))
+        if self._shm.created:
+            self._registry = Registry(self._shm.buf, slots)
+        else:
+            self._registry = self._attach()
+
+    def _attach(self, timeout: float = 5.0) -> Registry:
+        # The creator formats right after creating the segment; wait for it briefly.
+        deadline = time.monotonic() + timeout
+        while True:
+            try:
+                return Registry(self._shm.buf)
+            except ValueError:
+                if time.monotonic() > deadline:
+                    raise
+                time.sleep(0.001)
+
+    def slot(
+        self,
+        key: str,
+        init: Optional[Callable[[memoryview], None]] = None,
+        timeout_ns: int = -1,
+    ) -> memoryview:
+        """
+        Return the 64-byte payload for ``key``, creating it on first use.
+
+        :param key: Name of the primitive (at most 48 bytes of UTF-8).
+        :param init: Called by the creating process before anyone else sees the payload. If
+            that process dies before publishing, the next process to ask for ``key`` runs
+            ``init`` again over the same payload.
+        :param timeout_ns: How long to wait for another process's ``init`` (-1 = forever).
+        :return: A writable 64-byte view.
+        """
+        offset, created = self._registry.get_or_create(key, timeout_ns)
+        view = self._shm.buf[offset : offset + 64]
+        if created:
+            try:
+                if init is not None:
+                    init(view)
+            finally:
+                self._registry.publish(offset)
+        return view
+
+    def __contains__(self, key: str) -> bool:
+        try:
+            return self._registry.lookup(key, 0) >= 0
+        except TimeoutError:
+            return True  # registered, still being initialized
+
+    def __len__(self) -> int:
+        return self._registry.count()
+
+    @property
+    def name(self) -> str:
+        return self._name
+
+    def close(self) -> None:
+        """Detach from the registry segment (unlinked when the last process detaches)."""
+        self._shm.close()
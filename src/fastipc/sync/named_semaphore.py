@@ -1,7 +1,10 @@
 from __future__ import annotations
 
+from typing import Optional
+
 from fastipc._primitives import Semaphore
 from fastipc.guarded_shared_memory import GuardedSharedMemory
+from fastipc.sync.named_registry import NamedRegistry
 
 
 class NamedSemaphore:
@@ -21,15 +24,27 @@ class NamedSemaphore:
         self,
         name: str,
         initial: int | None = None,
+        registry: Optional[NamedRegistry] = None,
     ):
         """
         Create or attach a 64B shared-memory header for this semaphore.
 
         :param name: Symbolic name for the shared memory region.
         :param initial: Initial count if we created the segment (attach-only otherwise).
+        :param registry: Place the header in this registry instead of its own segment; it is
+            stored under ``"sema:" + name``, so ``name`` may use at most 43 bytes of UTF-8.
         """
-        self._shm = GuardedSharedMemory(f"__pyfastipc_sema_{name}", size=64)
         self._name = name
+        self._registry = registry
+        if registry is not None:
+            self._shm = None
+            # The creator sets the initial count before other processes can see the slot.
+            view = registry.slot(
+                f"sema:{name}", init=lambda v: Semaphore(v, initial=initial or 0, shared=True)
+            )
+            self._semaphore = Semaphore(view, shared=True)
+            return
+        self._shm = GuardedSharedMemory(f"__pyfastipc_sema_{name}", size=64)
         # Only set initial value if we created the backing segment
         init_val = initial if getattr(self._shm, "created", False) else None
         self._semaphore = Semaphore(self._shm.buf, initial=init_val, shared=True)
@@ -0,0 +1,104 @@
+import mmap
+import os
+import sys
+import threading
+import time
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only futex tests", allow_module_level=True)
+
+from fastipc._primitives import AtomicBitset  # type: ignore
+
+
+def test_claim_release_and_popcount():
+    bits = AtomicBitset(memoryview(mmap.mmap(-1, AtomicBitset.required_size(130))), nbits=130)
+    assert bits.nbits() == 130 and bits.popcount() == 0
+    claimed = {bits.claim_first_free() for _ in range(130)}
+    assert claimed == set(range(130))  # the partial last word is never over-claimed
+    assert bits.claim_first_free() == -1 and bits.popcount() == 130
+    assert bits.test(129)
+    bits.release(129)
+    assert not bits.test(129) and bits.popcount() == 129
+    with pytest.raises(ValueError):
+        bits.release(129)
+    with pytest.raises(IndexError):
+        bits.test(130)
+    assert bits.claim_first_free() == 129
+
+
+def test_claim_n_is_all_or_nothing():
+    bits = AtomicBitset(memoryview(mmap.mmap(-1, AtomicBitset.required_size(200))), nbits=200)
+    first = bits.claim_n(150)
+    assert len(set(first)) == 150 and bits.popcount() == 150
+    assert bits.claim_n(51) is None and bits.popcount() == 150  # partial claim handed back
+    rest = bits.claim_n(50)
+    assert set(first) | set(rest) == set(range(200))
+    assert bits.claim_n(0) == []
+    with pytest.raises(ValueError):
+        bits.claim_n(201)
+
+
+def test_attach_and_validation():
+    mm = mmap.mmap(-1, AtomicBitset.required_size(64))
+    with pytest.raises(ValueError):
+        AtomicBitset(memoryview(mm))  # nothing formatted yet
+    a = AtomicBitset(memoryview(mm), nbits=64)
+    b = AtomicBitset(memoryview(mm))
+    i = a.claim_first_free()
+    assert b.nbits() == 64 and b.test(i)
+    b.release(i)
+    assert not a.test(i)
+    with pytest.raises(ValueError):
+        AtomicBitset(memoryview(mmap.mmap(-1, 4096)), nbits=1 << 20)
+    with pytest.raises(ValueError):
+        AtomicBitset.required_size(0)
+
+
+@pytest.mark.timeout(30)
+def test_unique_claims_across_processes():
+    nbits, per_child = 512, 2000
+    mm = mmap.mmap(-1, AtomicBitset.required_size(nbits))
+    AtomicBitset(memoryview(mm), nbits=nbits)
+    errors = mmap.mmap(-1, 1)
+    pids = []
+    for _ in range(3):
+        pid = os.fork()
+        if pid == 0:
+            try:
+                bits = AtomicBitset(memoryview(mm))
+                mine = []
+                for n in range(per_child):
+                    i = bits.claim_first_free()
+                    if i < 0 or i in mine:
+                        errors[0] = 1
+                    mine.append(i)
+                    if len(mine) > 100 or n == per_child - 1:
+                        for j in mine:
+                            bits.release(j)  # ValueError here means someone else held it
+                        mine.clear()
+            except Exception:
+                errors[0] = 1
+            finally:
+                os._exit(0)
+        pids.append(pid)
+    for pid in pids:
+        os.waitpid(pid, 0)
+    assert errors[0] == 0
+    assert AtomicBitset(memoryview(mm)).popcount() == 0
+
+
+@pytest.mark.timeout(10)
+def test_wait_free_wakes_on_release():
+    bits = AtomicBitset(memoryview(mmap.mmap(-1, AtomicBitset.required_size(8))), nbits=8)
+    assert bits.wait_free(0)
+    assert bits.claim_n(8) is not None
+    assert not bits.wait_free(1_000_000)  # full: times out
+    woke = []
+    t = threading.Thread(target=lambda: woke.append(bits.wait_free(5_000_000_000)))
+    t.start()
+    time.sleep(0.05)
+    bits.release(3)
+    t.join(5)
+    assert woke == [True] and bits.claim_first_free() == 3
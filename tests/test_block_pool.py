@@ -0,0 +1,117 @@
+import mmap
+import os
+import sys
+import threading
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only shared memory tests", allow_module_level=True)
+
+from fastipc._primitives import BlockPool  # type: ignore
+
+
+def test_format_alloc_free_and_attach():
+    mm = mmap.mmap(-1, BlockPool.required_size(100, 4))
+    p = BlockPool(mm, 100)
+    assert p.blocks() == 4 and p.block_size() == 100 and p.available() == 4
+    handles = [p.alloc() for _ in range(4)]
+    assert sorted(handles) == [0, 1, 2, 3]
+    assert p.alloc() == -1 and p.available() == 0
+    assert len({p.offset(h) for h in handles}) == 4
+    assert all(p.offset(h) % 64 == 0 for h in handles)
+    p.free(handles[2])
+    other = BlockPool(mm)  # attach reads the layout from the header
+    assert other.blocks() == 4 and other.alloc() == handles[2]
+    with pytest.raises(ValueError):
+        BlockPool(mmap.mmap(-1, 4096))
+
+
+def test_view_is_zero_copy_and_sized():
+    mm = mmap.mmap(-1, BlockPool.required_size(64, 2))
+    p = BlockPool(mm, 64)
+    h = p.alloc()
+    v = p.view(h)
+    assert len(v) == 64 and not v.readonly
+    v[:5] = b"hello"
+    assert mm[p.offset(h) : p.offset(h) + 5] == b"hello"
+    v.release()
+
+
+def test_double_free_and_bad_handles():
+    p = BlockPool(mmap.mmap(-1, BlockPool.required_size(4096, 2)), 4096)
+    h = p.alloc()
+    p.free(h)
+    with pytest.raises(ValueError):
+        p.free(h)
+    with pytest.raises(ValueError):
+        p.free(2)
+    with pytest.raises(ValueError):
+        p.view(-1)
+
+
+def test_alloc_many_free_many_and_cache():
+    mm = mmap.mmap(-1, BlockPool.required_size(4096, 32))
+    p = BlockPool(mm, 4096, cache_size=8)
+    got = p.alloc_many(40)
+    assert len(got) == 32 and len(set(got)) == 32
+    p.free_many(got[:10])
+    assert p.available() == 10
+    other = BlockPool(mm)
+    assert other.available() < 10  # some of the freed blocks sit in p's private cache
+    p.flush()
+    assert other.alloc_many(10) and other.available() == 0
+    with pytest.raises(ValueError):
+        p.free_many([got[10], got[10]])
+
+
+@pytest.mark.timeout(20)
+def test_concurrent_alloc_free_across_processes_and_threads():
+    mm = mmap.mmap(-1, BlockPool.required_size(64, 64))
+    p = BlockPool(mm, 64, cache_size=4)
+
+    def churn(pool, tag, rounds):
+        for _ in range(rounds):
+            hs = pool.alloc_many(3)
+            for h in hs:
+                pool.view(h)[:8] = tag
+            for h in hs:
+                if bytes(pool.view(h)[:8]) != tag:
+                    raise AssertionError("block handed out twice")
+            pool.free_many(hs)
+
+    pids = []
+    for w in range(2):
+        pid = os.fork()
+        if pid == 0:
+            code = 0
+            try:
+                child = BlockPool(mm, cache_size=4)
+                churn(child, b"proc%04d" % w, 3000)
+                child.flush()
+            except BaseException:
+                code = 1
+            finally:
+                os._exit(code)
+        pids.append(pid)
+
+    errors = []
+
+    def thread_churn(t):
+        try:
+            churn(p, b"thrd%04d" % t, 3000)
+        except AssertionError as e:
+            errors.append(e)
+
+    ts = [threading.Thread(target=thread_churn, args=(t,)) for t in range(2)]
+    for t in ts:
+        t.start()
+    for t in ts:
+        t.join()
+    for pid in pids:
+        _, status = os.waitpid(pid, 0)
+        assert os.waitstatus_to_exitcode(status) == 0
+    assert errors == []
+    p.flush()
+    assert p.available() == 64
+    assert sorted(p.alloc_many(64)) == list(range(64))
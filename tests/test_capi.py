@@ -0,0 +1,124 @@
+import ctypes
+import os
+import sys
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only (futex)", allow_module_level=True)
+
+import fastipc
+from fastipc._primitives import Mutex, Semaphore, _C_API
+
+EBUSY, EPERM, ETIMEDOUT = 16, 1, 110
+
+_void_p = ctypes.c_void_p
+_u32_p = ctypes.POINTER(ctypes.c_uint32)
+_u64_p = ctypes.POINTER(ctypes.c_uint64)
+
+
+class FastIPC_CAPI(ctypes.Structure):
+    _fields_ = [
+        ("version", ctypes.c_uint32),
+        ("size", ctypes.c_uint32),
+        ("mutex_init", ctypes.CFUNCTYPE(ctypes.c_int, _void_p)),
+        ("mutex_try_acquire", ctypes.CFUNCTYPE(ctypes.c_int, _void_p)),
+        ("mutex_acquire", ctypes.CFUNCTYPE(ctypes.c_int, _void_p, ctypes.c_int)),
+        ("mutex_acquire_ns", ctypes.CFUNCTYPE(ctypes.c_int, _void_p, ctypes.c_int, ctypes.c_int64, ctypes.c_int)),
+        ("mutex_release", ctypes.CFUNCTYPE(ctypes.c_int, _void_p, ctypes.c_int)),
+        ("mutex_force_release", ctypes.CFUNCTYPE(ctypes.c_int, _void_p, ctypes.c_int)),
+        ("semaphore_init", ctypes.CFUNCTYPE(ctypes.c_int, _void_p, ctypes.c_uint32)),
+        ("semaphore_post", ctypes.CFUNCTYPE(ctypes.c_int, _void_p, ctypes.c_int, ctypes.c_uint32)),
+        ("semaphore_wait", ctypes.CFUNCTYPE(ctypes.c_int, _void_p, ctypes.c_int, ctypes.c_int64, ctypes.c_int)),
+        ("futex_wait", ctypes.CFUNCTYPE(ctypes.c_int, _u32_p, ctypes.c_uint32, ctypes.c_int64, ctypes.c_int)),
+        ("futex_wake", ctypes.CFUNCTYPE(ctypes.c_int, _u32_p, ctypes.c_int, ctypes.c_int)),
+        ("u32_fetch_add", ctypes.CFUNCTYPE(ctypes.c_uint32, _u32_p, ctypes.c_uint32)),
+        ("u64_fetch_add", ctypes.CFUNCTYPE(ctypes.c_uint64, _u64_p, ctypes.c_uint64)),
+        ("u32_exchange", ctypes.CFUNCTYPE(ctypes.c_uint32, _u32_p, ctypes.c_uint32)),
+        ("u64_exchange", ctypes.CFUNCTYPE(ctypes.c_uint64, _u64_p, ctypes.c_uint64)),
+        ("u32_cas", ctypes.CFUNCTYPE(ctypes.c_int, _u32_p, _u32_p, ctypes.c_uint32)),
+        ("u64_cas", ctypes.CFUNCTYPE(ctypes.c_int, _u64_p, _u64_p, ctypes.c_uint64)),
+    ]
+
+
+@pytest.fixture(scope="module")
+def api():
+    get_pointer = ctypes.pythonapi.PyCapsule_GetPointer
+    get_pointer.restype = ctypes.c_void_p
+    get_pointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+    ptr = get_pointer(_C_API, b"fastipc._primitives._C_API")
+    return ctypes.cast(ptr, ctypes.POINTER(FastIPC_CAPI)).contents
+
+
+def _addr(buf):
+    return ctypes.addressof(ctypes.c_char.from_buffer(buf))
+
+
+def test_header_is_shipped():
+    assert os.path.isfile(os.path.join(fastipc.get_include(), "fastipc_capi.h"))
+
+
+def test_version_and_size(api):
+    assert api.version == 1
+    assert api.size == ctypes.sizeof(FastIPC_CAPI)
+
+
+@pytest.mark.timeout(5)
+def test_mutex_interops_with_python_object(api):
+    buf = bytearray(64)
+    base = _addr(buf)
+    assert api.mutex_init(base) == 0
+    m = Mutex(buf)
+    assert api.mutex_try_acquire(base) == 0
+    assert m.owner_pid() == os.getpid()  # owner stamped by the native path
+    assert not m.try_acquire()
+    assert api.mutex_try_acquire(base) == -EBUSY
+    assert api.mutex_acquire_ns(base, 0, 1_000_000, 4) == -ETIMEDOUT
+    m.release()
+    assert api.mutex_acquire(base, 0) == 0
+    assert api.mutex_release(base, 0) == 0
+    assert m.try_acquire()
+    m.release()
+
+
+def test_mutex_release_requires_owner(api):
+    buf = bytearray(64)
+    base = _addr(buf)
+    api.mutex_init(base)
+    assert api.mutex_try_acquire(base) == 0
+    ctypes.c_uint32.from_buffer(buf, 12).value = 0  # pretend another process owns it
+    assert api.mutex_release(base, 0) == -EPERM
+    assert api.mutex_force_release(base, 0) == 0
+    assert api.mutex_try_acquire(base) == 0
+
+
+@pytest.mark.timeout(5)
+def test_semaphore_interops_with_python_object(api):
+    buf = bytearray(64)
+    base = _addr(buf)
+    assert api.semaphore_init(base, 0) == 0
+    s = Semaphore(buf)
+    assert api.semaphore_wait(base, 0, 0, 1) == -ETIMEDOUT
+    assert api.semaphore_post(base, 0, 2) == 0
+    assert s.value() == 2
+    assert s.wait(blocking=False)
+    assert api.semaphore_wait(base, 0, -1, 16) == 0
+    assert api.semaphore_wait(base, 0, 1_000_000, 1) == -ETIMEDOUT
+    s.post()
+    assert api.semaphore_wait(base, 0, 0, 1) == 0
+
+
+def test_futex_and_atomics(api):
+    w32 = ctypes.c_uint32(5)
+    w64 = ctypes.c_uint64(7)
+    assert api.futex_wait(ctypes.byref(w32), 6, 0, 0) == -11  # EAGAIN: value changed
+    assert api.futex_wake(ctypes.byref(w32), 1, 0) == 0
+    assert api.u32_fetch_add(ctypes.byref(w32), 3) == 5 and w32.value == 8
+    assert api.u64_fetch_add(ctypes.byref(w64), 1 << 40) == 7
+    assert api.u32_exchange(ctypes.byref(w32), 1) == 8 and w32.value == 1
+    assert api.u64_exchange(ctypes.byref(w64), 2) == 7 + (1 << 40)
+    exp32 = ctypes.c_uint32(0)
+    assert api.u32_cas(ctypes.byref(w32), ctypes.byref(exp32), 9) == 0 and exp32.value == 1
+    assert api.u32_cas(ctypes.byref(w32), ctypes.byref(exp32), 9) == 1 and w32.value == 9
+    exp64 = ctypes.c_uint64(2)
+    assert api.u64_cas(ctypes.byref(w64), ctypes.byref(exp64), 3) == 1 and w64.value == 3
@@ -0,0 +1,72 @@
+import os
+import sys
+import sysconfig
+import threading
+from array import array
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only futex tests", allow_module_level=True)
+
+from fastipc._primitives import (  # type: ignore
+    AtomicU64,
+    Mutex,
+    Semaphore,
+    Sequencer,
+    ShardedCounter,
+)
+
+FREE_THREADED = bool(sysconfig.get_config_var("Py_GIL_DISABLED"))
+
+
+@pytest.mark.skipif(not FREE_THREADED, reason="requires a free-threaded (t) build")
+def test_import_keeps_gil_disabled():
+    assert sys._is_gil_enabled() is False
+
+
+def test_reinit_is_rejected():
+    m = Mutex(memoryview(bytearray(64)))
+    with pytest.raises(RuntimeError):
+        m.__init__(memoryview(bytearray(64)))
+
+
+@pytest.mark.timeout(30)
+def test_parallel_threads_stress():
+    threads = max(8, 2 * (os.cpu_count() or 4))
+    iters = 2000
+    mutex = Mutex(memoryview(bytearray(64)))
+    sem = Semaphore(memoryview(bytearray(64)), initial=0)
+    cas_word = AtomicU64(memoryview(array("Q", [0])))
+    counter = ShardedCounter(memoryview(bytearray(16 * 64)))
+    seq = Sequencer(memoryview(bytearray(64 + 16 * threads)), initial=0)
+    guarded = [0]
+    start = threading.Barrier(threads)
+
+    def worker(i):
+        start.wait()
+        for _ in range(iters):
+            with mutex:
+                guarded[0] += 1
+            while True:
+                v = cas_word.load()
+                if cas_word.cas(v, v + 1):
+                    break
+            counter.add()
+            sem.post1()
+            assert sem.wait(timeout_ns=1_000_000_000)
+        # hand off in thread order through the sequencer
+        assert seq.wait_until(i, timeout_ns=10_000_000_000)
+        seq.publish(i + 1)
+
+    ts = [threading.Thread(target=worker, args=(i,)) for i in range(threads)]
+    for t in ts:
+        t.start()
+    for t in ts:
+        t.join()
+    total = threads * iters
+    assert guarded[0] == total
+    assert cas_word.load() == total
+    assert counter.read_exact() == total
+    assert sem.value() == 0
+    assert seq.value() == threads
@@ -1,16 +1,21 @@
 from __future__ import annotations
 
+import gc
 import os
+import sys
 import time
+from pathlib import Path
 from multiprocessing import Pipe, get_context
 
 import pytest
 
+from fastipc._primitives import Mutex  # type: ignore
 from fastipc.guarded_shared_memory import GuardedSharedMemory
 
+SHM_ROOT = Path("/dev/shm")
+
 
 def _child_hold_shm(name: str, size: int, conn):
-    # Inherit FASTIPC_PID_DIR from parent; just open and hold
     shm = GuardedSharedMemory(name, size)
     try:
         conn.send("ready")
@@ -21,38 +26,29 @@ def _child_hold_shm(name: str, size: int, conn):
 
 
 @pytest.mark.bench_heavy
-def test_created_and_cleanup_benchmark(benchmark, tmp_path, monkeypatch):
-    """Benchmark create+close cycles and verify cleanup of PID dir."""
-    pid_root = tmp_path / "pids_root"
-    monkeypatch.setenv("FASTIPC_PID_DIR", str(pid_root))
-
+def test_created_and_cleanup_benchmark(benchmark):
+    """Benchmark create+close cycles and verify the segment is unlinked."""
     counter = {"i": 0}
 
     def create_and_close():
         i = counter["i"]
         counter["i"] = i + 1
         name = f"bench_gshm_{os.getpid()}_{int(time.time()*1e6)}_{i}"
-        pdir = pid_root / f"{name}.pids"
         shm = GuardedSharedMemory(name, size=64)
         try:
             assert shm.created is True
-            assert pdir.is_dir()
-            files = list(pdir.iterdir())
-            assert any(f.name == str(os.getpid()) for f in files if f.name.isdigit())
+            assert shm.get_num_procs() == 1
         finally:
             shm.close()
-        assert not pdir.exists()
+        assert not (SHM_ROOT / name).exists()
 
     benchmark.group = "GuardedSharedMemory:create_close"
     benchmark.pedantic(create_and_close, iterations=1, rounds=20)
 
 
 @pytest.mark.bench_heavy
-def test_pid_tracking_get_num_procs_benchmark(benchmark, tmp_path, monkeypatch):
+def test_pid_tracking_get_num_procs_benchmark(benchmark):
     """Start a child once, then benchmark get_num_procs() while child alive."""
-    pid_root = tmp_path / "pids_root3"
-    monkeypatch.setenv("FASTIPC_PID_DIR", str(pid_root))
-
     name = f"bench_procs_{os.getpid()}_{int(time.time()*1e6)}"
     parent = GuardedSharedMemory(name, size=64)
     assert parent.created is True
@@ -63,13 +59,7 @@ def test_pid_tracking_get_num_procs_benchmark(benchmark, tmp_path, monkeypatch):
     p = ctx.Process(target=_child_hold_shm, args=(name, 64, child_conn))
     p.start()
     assert parent_conn.recv() == "ready"
-
-    # Allow small time for child to register
-    for _ in range(50):
-        if parent.get_num_procs() >= 2:
-            break
-        time.sleep(0.01)
-    assert parent.get_num_procs() >= 2
+    assert parent.get_num_procs() == 2
 
     try:
         def poll_num():
@@ -85,22 +75,244 @@ def test_pid_tracking_get_num_procs_benchmark(benchmark, tmp_path, monkeypatch):
         parent.close()
 
 
-def test_consistency_with_auto_cleanup_disabled(tmp_path, monkeypatch):
-    """Verify that with auto-cleanup disabled, PID dir remains after close."""
-    pid_root = tmp_path / "pids_root2"
-    monkeypatch.setenv("FASTIPC_PID_DIR", str(pid_root))
-
+def test_consistency_with_auto_cleanup_disabled():
+    """Verify that with auto-cleanup disabled, the segment outlives the object."""
     name = f"test_no_cleanup_{os.getpid()}_{int(time.time()*1e6)}"
     shm = GuardedSharedMemory(name, size=64, try_cleanup_on_exit=False)
     assert shm.created is True
-    pdir = pid_root / f"{name}.pids"
-    assert pdir.is_dir()
-    files = list(pdir.iterdir())
-    assert any(f.name == str(os.getpid()) for f in files if f.name.isdigit())
+    assert shm.get_num_procs() == 1
     del shm
-    
-    # Try to attach again on same name; should succeed
+    assert (SHM_ROOT / name).exists()
+
+    # Attach again on the same name; our own lease from the first object is still held.
     shm2 = GuardedSharedMemory(name, size=64, try_cleanup_on_exit=True)
     assert shm2.created is False
+    assert shm2.get_num_procs() == 2
     shm2.close()
-    assert not pdir.exists()
\ No newline at end of file
+    assert (SHM_ROOT / name).exists()
+    GuardedSharedMemory(name, size=64).unlink()
+
+
+def test_user_buffer_excludes_lease_header():
+    name = f"test_gshm_buf_{os.getpid()}_{int(time.time()*1e6)}"
+    shm = GuardedSharedMemory(name, size=100)
+    try:
+        assert shm.size == len(shm.buf) >= 100
+        shm.buf[:4] = b"abcd"
+        other = GuardedSharedMemory(name, size=100, attach_only=True)
+        assert bytes(other.buf[:4]) == b"abcd"
+        assert other.get_num_procs() == 2
+        other.close()
+        assert shm.get_num_procs() == 1
+    finally:
+        shm.close()
+    assert not (SHM_ROOT / name).exists()
+
+
+def test_last_close_unlinks_only_after_child_detaches():
+    name = f"test_gshm_child_{os.getpid()}_{int(time.time()*1e6)}"
+    parent = GuardedSharedMemory(name, size=64)
+    parent_conn, child_conn = Pipe()
+    p = get_context("fork").Process(target=_child_hold_shm, args=(name, 64, child_conn))
+    p.start()
+    try:
+        assert parent_conn.recv() == "ready"
+        parent.close()
+        assert (SHM_ROOT / name).exists()  # child still holds a lease
+    finally:
+        parent_conn.send("exit")
+        p.join(timeout=5)
+    assert p.exitcode == 0
+    assert not (SHM_ROOT / name).exists()
+
+
+def _child_crash(name: str, conn):
+    GuardedSharedMemory(name, size=64, try_cleanup_on_exit=False)
+    conn.send("ready")
+    os._exit(0)  # leave the lease behind
+
+
+def test_dead_and_recycled_leases_are_evicted():
+    name = f"test_gshm_dead_{os.getpid()}_{int(time.time()*1e6)}"
+    shm = GuardedSharedMemory(name, size=64)
+    parent_conn, child_conn = Pipe()
+    p = get_context("fork").Process(target=_child_crash, args=(name, child_conn))
+    p.start()
+    assert parent_conn.recv() == "ready"
+    p.join(timeout=5)
+    # A live PID with the wrong start time is a recycled PID, not a holder.
+    assert shm._leases.claim(((12345 << 24) | os.getpid())) >= 0
+    assert shm.get_num_procs() == 3
+    shm.close()
+    assert not (SHM_ROOT / name).exists()
+
+
+def _child_retire_and_die(name: str, conn):
+    shm = GuardedSharedMemory(name, size=64, try_cleanup_on_exit=False)
+    shm._leases.release(shm._lease_index, shm._lease_key)
+    conn.send(shm._retire_if_last())
+    os._exit(0)  # die between retiring the segment and unlinking it
+
+
+def test_dead_retirer_is_taken_over():
+    name = f"test_gshm_retire_{os.getpid()}_{int(time.time()*1e6)}"
+    parent_conn, child_conn = Pipe()
+    p = get_context("fork").Process(target=_child_retire_and_die, args=(name, child_conn))
+    p.start()
+    assert parent_conn.recv() is True
+    p.join(timeout=5)
+    assert (SHM_ROOT / name).exists()
+    shm = GuardedSharedMemory(name, size=64)
+    try:
+        assert shm.created and shm.get_num_procs() == 1
+    finally:
+        shm.close()
+    assert not (SHM_ROOT / name).exists()
+
+
+def _child_close_inherited(shm, conn):
+    shm.close()
+    conn.send(shm.get_num_procs())
+
+
+def test_forked_child_close_keeps_parent_lease():
+    name = f"test_gshm_fork_{os.getpid()}_{int(time.time()*1e6)}"
+    shm = GuardedSharedMemory(name, size=64)
+    try:
+        parent_conn, child_conn = Pipe()
+        p = get_context("fork").Process(target=_child_close_inherited, args=(shm, child_conn))
+        p.start()
+        assert parent_conn.recv() == 0
+        p.join(timeout=5)
+        assert shm.get_num_procs() == 1
+        assert (SHM_ROOT / name).exists()
+    finally:
+        shm.close()
+    assert not (SHM_ROOT / name).exists()
+
+
+def test_placement_options_are_best_effort():
+    name = f"test_gshm_opts_{os.getpid()}_{int(time.time()*1e6)}"
+    shm = GuardedSharedMemory(
+        name, size=1 << 20, huge_pages=True, populate=True, lock=True, numa_node=0
+    )
+    try:
+        eff = shm.effective_options
+        assert set(eff) == {"huge_pages", "populate", "lock", "numa_node"}
+        assert eff["populate"] is True
+        shm.buf[-1] = 7
+        plain = GuardedSharedMemory(name, size=1 << 20, attach_only=True)
+        assert plain.effective_options == dict.fromkeys(eff, False)
+        assert plain.buf[-1] == 7
+        plain.close()
+    finally:
+        shm.close()
+    assert not (SHM_ROOT / name).exists()
+
+
+def test_numa_node_rejects_bad_ids(monkeypatch):
+    name = f"test_gshm_numa_{os.getpid()}_{int(time.time()*1e6)}"
+    unraisable = []
+    monkeypatch.setattr(sys, "unraisablehook", unraisable.append)
+    with pytest.raises(ValueError):
+        GuardedSharedMemory(name, size=64, numa_node=[])
+    gc.collect()
+    assert not unraisable  # __del__ of the half-built object must not raise
+    assert not (SHM_ROOT / name).exists()
+
+
+def test_grow_remaps_attachers_lazily():
+    name = f"test_gshm_grow_{os.getpid()}_{int(time.time()*1e6)}"
+    shm = GuardedSharedMemory(name, size=4096)
+    other = GuardedSharedMemory(name, size=4096, attach_only=True)
+    try:
+        early = other.buf
+        mtx = Mutex(shm.buf[:64])
+        assert shm.generation == 0
+        shm.grow(1 << 20)
+        assert shm.size == len(shm.buf) == 1 << 20 and shm.generation == 1
+        shm.buf[(1 << 20) - 1] = 9
+        assert other.size == 1 << 20  # remapped on access
+        assert other.buf[(1 << 20) - 1] == 9 and other.generation == 1
+        early[0] = 5  # views from before the grow stay valid
+        assert shm.buf[0] == 5
+        with mtx:
+            assert Mutex(other.buf[:64]).owner_pid() == os.getpid()
+        shm.grow(4096)  # never shrinks
+        assert shm.size == 1 << 20 and shm.generation == 1
+        late = GuardedSharedMemory(name, size=1 << 20, attach_only=True)
+        assert late.size == 1 << 20 and late.buf[(1 << 20) - 1] == 9
+        late.close()
+        early.release()
+    finally:
+        other.close()
+        shm.close()
+    assert not (SHM_ROOT / name).exists()
+
+
+def test_grow_closes_mappings_nothing_exports():
+    name = f"test_gshm_grow_close_{os.getpid()}_{int(time.time()*1e6)}"
+    shm = GuardedSharedMemory(name, size=4096, lock=True)
+    try:
+        for size in (8192, 16384, 32768):
+            shm.grow(size)
+        assert len(shm._retired_maps) == 1  # the first mapping holds the lease table
+        held = shm.buf
+        shm.grow(1 << 20)
+        assert len(shm._retired_maps) == 2  # still exported through `held`
+        held.release()
+        shm.grow(2 << 20)
+        assert len(shm._retired_maps) == 1 and shm.size == 2 << 20
+    finally:
+        shm.close()
+    assert not (SHM_ROOT / name).exists()
+
+
+def _child_watch_grow(name: str, conn):
+    shm = GuardedSharedMemory(name, size=64, attach_only=True)
+    conn.send(shm.size)
+    conn.recv()
+    conn.send((shm.size, shm.buf[-1]))
+    shm.close()
+
+
+def test_grow_is_seen_by_other_processes():
+    name = f"test_gshm_grow_mp_{os.getpid()}_{int(time.time()*1e6)}"
+    shm = GuardedSharedMemory(name, size=64)
+    parent_conn, child_conn = Pipe()
+    p = get_context("fork").Process(target=_child_watch_grow, args=(name, child_conn))
+    p.start()
+    try:
+        assert parent_conn.recv() == 64
+        shm.grow(3 * 4096)
+        shm.buf[-1] = 42
+        parent_conn.send("grown")
+        assert parent_conn.recv() == (3 * 4096, 42)
+    finally:
+        p.join(timeout=5)
+        shm.close()
+    assert p.exitcode == 0
+    assert not (SHM_ROOT / name).exists()
+
+
+def test_unreadable_proc_never_evicts_live_holders(monkeypatch):
+    import fastipc.guarded_shared_memory as gsm
+
+    def no_proc(pid):
+        raise PermissionError(13, "Permission denied")
+
+    name = f"test_gshm_noproc_{os.getpid()}_{int(time.time()*1e6)}"
+    shm = GuardedSharedMemory(name, size=64)
+    monkeypatch.setattr(gsm, "_proc_stat_fields", no_proc)
+    try:
+        assert gsm._lease_alive(gsm._lease_key())
+        child = get_context("fork").Process(target=int)
+        child.start()
+        child.join()
+        assert not gsm._lease_alive(child.pid)  # the PID is gone: still detected
+        other = GuardedSharedMemory(name, size=64, attach_only=True)
+        other.close()  # our first lease is live, so this must not unlink
+        assert (SHM_ROOT / name).exists()
+    finally:
+        shm.close()
+    assert not (SHM_ROOT / name).exists()
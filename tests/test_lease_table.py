@@ -0,0 +1,76 @@
+import sys
+import threading
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only futex tests", allow_module_level=True)
+
+from fastipc._primitives import LeaseTable  # type: ignore
+
+
+def test_format_and_attach():
+    buf = bytearray(64 + 8 * 4)
+    t = LeaseTable(buf, 4)
+    assert t.slots() == 4 and t.state() == 1 and t.count() == 0
+    other = LeaseTable(buf)
+    assert other.slots() == 4
+    with pytest.raises(ValueError):
+        LeaseTable(bytearray(128))  # never formatted
+
+
+def test_claim_release_and_full():
+    t = LeaseTable(bytearray(64 + 8 * 2), 2)
+    a = t.claim(11)
+    b = t.claim(22)
+    assert {a, b} == {0, 1}
+    assert sorted(t.holders()) == [11, 22]
+    with pytest.raises(RuntimeError):
+        t.claim(33)
+    assert not t.release(a, 99)  # wrong key leaves the slot alone
+    assert t.release(a, 11)
+    assert t.holders() == [22]
+    with pytest.raises(ValueError):
+        t.claim(0)
+
+
+def test_evict_clears_every_slot_of_key():
+    t = LeaseTable(bytearray(64 + 8 * 4), 4)
+    t.claim(7)
+    t.claim(7)
+    t.claim(8)
+    assert t.evict(7) == 2
+    assert t.holders() == [8]
+
+
+def test_retire_only_when_empty_and_blocks_claims():
+    t = LeaseTable(bytearray(64 + 8 * 4), 4)
+    i = t.claim(5)
+    assert t.retire() is False and t.state() == 1
+    t.release(i, 5)
+    assert t.retire() is True and t.state() == 2
+    assert t.claim(6) == -1
+    assert t.count() == 0
+    assert t.retire() is False
+
+
+@pytest.mark.timeout(10)
+def test_concurrent_claims_get_distinct_slots():
+    t = LeaseTable(bytearray(64 + 8 * 64), 64)
+    got = []
+    lock = threading.Lock()
+
+    def worker(k):
+        for _ in range(200):
+            i = t.claim(k)
+            with lock:
+                got.append(i)
+            assert t.release(i, k)
+
+    ts = [threading.Thread(target=worker, args=(k,)) for k in range(1, 9)]
+    for th in ts:
+        th.start()
+    for th in ts:
+        th.join()
+    assert t.count() == 0
+    assert len(got) == 8 * 200
@@ -0,0 +1,95 @@
+from __future__ import annotations
+
+import os
+import socket
+import struct
+import sys
+from multiprocessing import get_context
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only (memfd_create)", allow_module_level=True)
+
+from fastipc import MemfdSharedMemory
+from fastipc._primitives import Mutex  # type: ignore
+
+
+def _child_add(shm: MemfdSharedMemory, value: int) -> None:
+    m = Mutex(shm.buf[:64])
+    with m:
+        (v,) = struct.unpack_from("<Q", shm.buf, 64)
+        struct.pack_into("<Q", shm.buf, 64, v + value)
+    del m
+    shm.close()
+
+
+def _child_recv(sock: socket.socket) -> None:
+    shm = MemfdSharedMemory.recv_fd(sock)
+    shm.buf[:5] = b"hello"
+    sock.send(b"done")
+    shm.close()
+
+
+def test_create_and_adopt_fd():
+    shm = MemfdSharedMemory(4096)
+    try:
+        assert shm.created is True and shm.size == 4096
+        shm.buf[:3] = b"abc"
+        other = MemfdSharedMemory(fd=os.dup(shm.fileno()))
+        assert other.created is False
+        assert bytes(other.buf[:3]) == b"abc"
+        other.close()
+        with pytest.raises(OSError):
+            os.ftruncate(shm.fileno(), 1024)  # shrinking is sealed
+    finally:
+        shm.close()
+    with pytest.raises(ValueError):
+        shm.buf
+
+
+@pytest.mark.parametrize("method", ["fork", "spawn"])
+@pytest.mark.timeout(30)
+def test_inherit_across_processes(method):
+    shm = MemfdSharedMemory(4096)
+    try:
+        Mutex(shm.buf[:64])
+        ctx = get_context(method)
+        procs = [ctx.Process(target=_child_add, args=(shm, i)) for i in (1, 2, 3)]
+        for p in procs:
+            p.start()
+        for p in procs:
+            p.join(timeout=20)
+            assert p.exitcode == 0
+        assert struct.unpack_from("<Q", shm.buf, 64)[0] == 6
+    finally:
+        shm.close()
+
+
+@pytest.mark.timeout(10)
+def test_send_fd_over_unix_socket():
+    parent_sock, child_sock = socket.socketpair(socket.AF_UNIX, socket.SOCK_STREAM)
+    shm = MemfdSharedMemory(4096)
+    p = get_context("fork").Process(target=_child_recv, args=(child_sock,))
+    p.start()
+    try:
+        shm.send_fd(parent_sock)
+        assert parent_sock.recv(4) == b"done"
+        assert bytes(shm.buf[:5]) == b"hello"
+    finally:
+        p.join(timeout=5)
+        shm.close()
+        parent_sock.close()
+        child_sock.close()
+    assert p.exitcode == 0
+
+
+def test_recv_rejects_plain_message():
+    a, b = socket.socketpair(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        a.send(b"x" * 13)
+        with pytest.raises(RuntimeError):
+            MemfdSharedMemory.recv_fd(b)
+    finally:
+        a.close()
+        b.close()
@@ -2,7 +2,6 @@ import os
 import sys
 import time
 import multiprocessing as mp
-from pathlib import Path
 
 import pytest
 
@@ -10,12 +9,6 @@ if sys.platform != "linux":
     pytest.skip("Linux-only futex tests", allow_module_level=True)
 
 
-def _ensure_pid_dir():
-    pid_dir = Path(".fastipc_pids").resolve()
-    pid_dir.mkdir(parents=True, exist_ok=True)
-    os.environ["FASTIPC_PID_DIR"] = str(pid_dir)
-
-
 # Top-level worker functions for spawn compatibility
 def _worker_named_mutex(name: str, iters: int, counter) -> None:
     from fastipc import NamedMutex  # type: ignore
@@ -54,7 +47,6 @@ def _waiter_named_semaphore(name: str, n: int, waited) -> None:
 
 @pytest.mark.timeout(10)
 def test_named_mutex_exclusion_multiprocess_spawn():
-    _ensure_pid_dir()
     name = f"mtx_mp_{os.getpid()}_{time.time_ns()}"
     procs = max(2, min(4, (os.cpu_count() or 2)))
     per_proc = 10000
@@ -78,7 +70,6 @@ def test_named_mutex_exclusion_multiprocess_spawn():
 
 @pytest.mark.timeout(10)
 def test_named_semaphore_basic_multiprocess_spawn():
-    _ensure_pid_dir()
     name = f"sem_mp_{os.getpid()}_{time.time_ns()}"
     posts = 10000
     ctx = mp.get_context("spawn")
@@ -101,7 +92,6 @@ def test_named_semaphore_basic_multiprocess_spawn():
 @pytest.mark.timeout(15)
 @pytest.mark.bench_heavy
 def test_named_semaphore_multiprocess_benchmark(benchmark):
-    _ensure_pid_dir()
     name = f"sem_mp_b_{os.getpid()}_{time.time_ns()}"
     posts = 5000
     ctx = mp.get_context("spawn")
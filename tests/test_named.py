@@ -2,7 +2,6 @@ import os
 import time
 import threading
 from multiprocessing import shared_memory, resource_tracker
-from pathlib import Path
 
 import pytest
 
@@ -24,18 +23,11 @@ _SKIP_NAMED = not _shm_available()
 from fastipc import NamedEvent, NamedMutex, NamedSemaphore
 
 
-def _ensure_pid_dir():
-    pid_dir = Path(".fastipc_pids").resolve()
-    pid_dir.mkdir(parents=True, exist_ok=True)
-    os.environ["FASTIPC_PID_DIR"] = str(pid_dir)
-
-
 @pytest.mark.skipif(
     _SKIP_NAMED, reason="shared_memory denied; skipping Named* tests"
 )
 @pytest.mark.timeout(10)
 def test_named_event_threads():
-    _ensure_pid_dir()
     name = f"evt_{os.getpid()}_{time.time_ns()}"
     e1 = NamedEvent(name)
     e2 = NamedEvent(name)
@@ -60,7 +52,6 @@ def test_named_event_threads():
 )
 @pytest.mark.timeout(10)
 def test_named_mutex_threads():
-    _ensure_pid_dir()
     name = f"mtx_{os.getpid()}_{time.time_ns()}"
     m1 = NamedMutex(name)
     m2 = NamedMutex(name)
@@ -91,7 +82,6 @@ def test_named_mutex_threads():
 )
 @pytest.mark.timeout(10)
 def test_named_semaphore_threads():
-    _ensure_pid_dir()
     name = f"sem_{os.getpid()}_{time.time_ns()}"
     s1 = NamedSemaphore(name, initial=0)
     # second attach should not reset value (pass None)
@@ -123,7 +113,6 @@ def test_named_semaphore_threads():
 )
 @pytest.mark.timeout(5)
 def test_named_semaphore_attach_does_not_reset():
-    _ensure_pid_dir()
     name = f"sem_init_{os.getpid()}_{time.time_ns()}"
     s1 = NamedSemaphore(name, initial=2)
     # Attach with no initial should not reset
@@ -137,7 +126,6 @@ def test_named_semaphore_attach_does_not_reset():
 @pytest.mark.timeout(10)
 @pytest.mark.bench_heavy
 def test_named_mutex_benchmark(benchmark):
-    _ensure_pid_dir()
     name = f"mtx_b_{os.getpid()}_{time.time_ns()}"
     m = NamedMutex(name)
 
@@ -156,7 +144,6 @@ def test_named_mutex_benchmark(benchmark):
 @pytest.mark.timeout(10)
 @pytest.mark.bench_heavy
 def test_named_semaphore_benchmark(benchmark):
-    _ensure_pid_dir()
     name = f"sem_b_{os.getpid()}_{time.time_ns()}"
     s = NamedSemaphore(name, initial=0)
 
@@ -175,7 +162,6 @@ def test_named_semaphore_benchmark(benchmark):
 @pytest.mark.timeout(10)
 @pytest.mark.bench_heavy
 def test_named_event_benchmark(benchmark):
-    _ensure_pid_dir()
     name = f"evt_b_{os.getpid()}_{time.time_ns()}"
     e = NamedEvent(name)
 
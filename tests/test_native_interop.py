@@ -0,0 +1,96 @@
+import mmap
+import os
+import shutil
+import struct
+import subprocess
+import sys
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only futex tests", allow_module_level=True)
+
+import fastipc
+from fastipc._primitives import Mutex, Semaphore  # type: ignore
+
+# Valid as both C11 and C++11: the same header must serve either kind of native peer.
+NATIVE_SRC = r"""
+#include "fastipc.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+        return 2;
+    int fd = open(argv[1], O_RDWR);
+    if (fd < 0)
+        return 3;
+    unsigned char *base = (unsigned char *)mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == (unsigned char *)MAP_FAILED)
+        return 4;
+    if (fipc_header_check(base, FASTIPC_MUTEX_MAGIC) != 0 || fipc_header_check(base + 128, FASTIPC_SEM_MAGIC) != 0)
+        return 5;
+    long iters = strtol(argv[2], NULL, 10);
+    /* Wait for the Python side's start signal so both sides contend. */
+    if (fipc_semaphore_wait(base + 128, 1, 5000000000LL, 64) != 0)
+        return 6;
+    for (long i = 0; i < iters; i++)
+    {
+        if (fipc_mutex_acquire(base, 1) != 0)
+            return 7;
+        uint64_t v = fipc_u64_load_unaligned(base, 64);
+        fipc_u64_store_unaligned(base, 64, v + 1);
+        if (fipc_mutex_release(base, 1) != 0)
+            return 8;
+    }
+    return fipc_semaphore_post(base + 192, 1, 1) == 0 ? 0 : 9;
+}
+"""
+
+
+@pytest.fixture(params=["cc", "c++"])
+def native_peer(request, tmp_path):
+    compiler = shutil.which(request.param)
+    if compiler is None:
+        pytest.skip(f"no {request.param} compiler available")
+    src = tmp_path / ("peer.c" if request.param == "cc" else "peer.cpp")
+    src.write_text(NATIVE_SRC)
+    exe = tmp_path / "peer"
+    std = "-std=c11" if request.param == "cc" else "-std=c++11"
+    subprocess.run(
+        [compiler, std, "-O2", "-Wall", "-Wextra", "-I", fastipc.get_include(), str(src), "-o", str(exe)],
+        check=True,
+    )
+    return exe
+
+
+@pytest.mark.timeout(30)
+def test_native_and_python_contend_on_same_mutex(native_peer, tmp_path):
+    path = tmp_path / "segment"
+    path.write_bytes(b"\0" * 4096)
+    iters = 20000
+    with open(path, "r+b") as f:
+        mm = mmap.mmap(f.fileno(), 4096)
+    view = memoryview(mm)
+    m = Mutex(view[0:64])
+    start = Semaphore(view[128:192], initial=0)
+    done = Semaphore(view[192:256], initial=0)
+    try:
+        assert m.layout_version() == start.layout_version() == 1
+        proc = subprocess.Popen([str(native_peer), str(path), str(iters)])
+        start.post(1)
+        for _ in range(iters):
+            with m:
+                (v,) = struct.unpack_from("<Q", view, 64)
+                struct.pack_into("<Q", view, 64, v + 1)
+        assert done.wait(timeout_ns=20_000_000_000)
+        assert proc.wait(timeout=20) == 0
+        assert struct.unpack_from("<Q", view, 64)[0] == 2 * iters
+        assert m.owner_pid() == 0
+    finally:
+        del m, start, done
+        view.release()
+        mm.close()
@@ -0,0 +1,117 @@
+import array
+import os
+import sys
+import uuid
+from multiprocessing import get_context
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only shared memory tests", allow_module_level=True)
+
+from fastipc import SharedObjectStore
+
+
+@pytest.fixture
+def store():
+    s = SharedObjectStore(f"t_{uuid.uuid4().hex[:8]}", size=1 << 20)
+    yield s
+    s.close()
+
+
+@pytest.mark.timeout(10)
+def test_publish_open_round_trip(store):
+    src = array.array("d", [1.5, 2.5, 3.5])
+    h = store.publish(src)
+    with store.open(h) as view:
+        assert view.format == "d" and view.shape == (3,) and view.strides == (8,)
+        assert view.buffer.readonly
+        assert view.buffer.tolist() == [1.5, 2.5, 3.5]
+        with pytest.raises(TypeError):
+            view.buffer[0] = 0.0
+
+
+@pytest.mark.timeout(10)
+def test_multidimensional_and_non_contiguous(store):
+    grid = memoryview(bytearray(range(24))).cast("B", (4, 6))
+    with store.open(store.publish(grid)) as view:
+        assert view.shape == (4, 6) and view.strides == (6, 1)
+        assert view.buffer.tolist() == grid.tolist()
+    sliced = memoryview(bytes(range(20)))[::2]
+    with store.open(store.publish(sliced)) as view:
+        assert bytes(view.buffer) == bytes(range(0, 20, 2))
+
+
+@pytest.mark.timeout(10)
+def test_last_reference_frees_and_stale_handle(store):
+    free = store.stats()["free_bytes"]
+    h = store.publish(b"x" * 1000, refs=2)
+    assert store.stats()["used_blocks"] == 1
+    v1 = store.open(h)
+    v2 = store.open(h, adopt=False)  # extra reference on top of the two published ones
+    v1.release()
+    v2.release()
+    assert store.stats()["used_blocks"] == 1
+    store.release(h)  # the second published reference, never opened
+    stats = store.stats()
+    assert stats["used_blocks"] == 0 and stats["free_bytes"] == free
+    with pytest.raises(KeyError):
+        store.open(h)
+    # The freed block is reused; the old handle stays invalid.
+    h2 = store.publish(b"y" * 1000)
+    assert h2 & 0xFFFFFFFFFFFF == h & 0xFFFFFFFFFFFF and h2 != h
+    with pytest.raises(KeyError):
+        store.open(h)
+    store.release(h2)
+
+
+@pytest.mark.timeout(10)
+def test_full_arena_raises(store):
+    with pytest.raises(MemoryError):
+        store.publish(bytes(2 << 20))
+    handles = [store.publish(bytes(4000)) for _ in range(8)]
+    for h in handles:
+        store.release(h)
+    assert store.stats()["used_blocks"] == 0
+
+
+def _reader(name, handle, q):
+    s = SharedObjectStore(name)  # attaches at the creator's size
+    try:
+        with s.open(handle) as view:
+            q.put((view.shape, view.buffer.tolist()))
+    finally:
+        s.close()
+
+
+@pytest.mark.timeout(10)
+def test_dead_lock_holder_is_recovered(store):
+    pid = os.fork()
+    if pid == 0:
+        store._mutex.acquire()  # dies holding the allocation lock
+        os._exit(0)
+    os.waitpid(pid, 0)
+    assert store._mutex.owner_pid() == pid
+    h = store.publish(b"after the crash")
+    with store.open(h) as view:
+        assert bytes(view.buffer) == b"after the crash"
+    assert store._mutex.owner_pid() == 0
+
+
+@pytest.mark.timeout(20)
+def test_cross_process_handle_exchange():
+    name = f"t_{uuid.uuid4().hex[:8]}"
+    s = SharedObjectStore(name, size=1 << 20)
+    try:
+        h = s.publish(array.array("i", range(10)))
+        ctx = get_context("spawn")
+        q = ctx.Queue()
+        p = ctx.Process(target=_reader, args=(name, h, q))
+        p.start()
+        assert q.get(timeout=15) == ((10,), list(range(10)))
+        p.join(10)
+        assert p.exitcode == 0
+        assert s.stats()["used_blocks"] == 0  # the reader dropped the only reference
+    finally:
+        s.close()
+    assert not os.path.exists(f"/dev/shm/__pyfastipc_store_{name}")
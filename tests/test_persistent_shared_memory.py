@@ -0,0 +1,106 @@
+import os
+import sys
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only shared memory tests", allow_module_level=True)
+
+from fastipc import PersistentSharedMemory
+from fastipc._primitives import Mutex  # type: ignore
+
+
+@pytest.fixture
+def path(tmp_path):
+    return tmp_path / "segment.fipc"
+
+
+def _crash_holder(path, acquire_at=None):
+    """Attach in a child that exits without closing (optionally holding a lock)."""
+    pid = os.fork()
+    if pid == 0:
+        try:
+            shm = PersistentSharedMemory(path)
+            if acquire_at is not None:
+                Mutex(shm.buf[acquire_at : acquire_at + 64]).acquire()
+        finally:
+            os._exit(0)
+    _, status = os.waitpid(pid, 0)
+    assert os.waitstatus_to_exitcode(status) == 0
+
+
+@pytest.mark.timeout(10)
+def test_contents_survive_close_and_reopen(path):
+    with PersistentSharedMemory(path, 8192) as shm:
+        assert shm.created and shm.size == 8192 and len(shm.buf) == 8192
+        shm.buf[:5] = b"warm!"
+    with PersistentSharedMemory(path) as shm:
+        assert not shm.created and shm.recovered and shm.was_clean
+        assert bytes(shm.buf[:5]) == b"warm!"
+        shm.buf[8187:] = b"tail!"
+        shm.flush(8000, 192)
+        shm.checkpoint()
+        assert shm.last_checkpoint_ns > 0
+    with PersistentSharedMemory(path, 8192) as shm:
+        assert bytes(shm.buf[8187:]) == b"tail!"
+
+
+@pytest.mark.timeout(10)
+def test_second_attacher_is_warm(path):
+    with PersistentSharedMemory(path, 4096) as a:
+        with PersistentSharedMemory(path) as b:
+            assert not b.recovered
+            assert a.get_num_procs() == 2
+            b.buf[0] = 7
+            assert a.buf[0] == 7
+        assert a.get_num_procs() == 1
+
+
+@pytest.mark.timeout(10)
+def test_crash_is_reported_and_dead_owner_locks_reset(path):
+    PersistentSharedMemory(path, 4096).close()
+    _crash_holder(path, acquire_at=64)
+    with PersistentSharedMemory(path, lock_offsets=[64]) as shm:
+        assert shm.recovered and not shm.was_clean
+        mtx = Mutex(shm.buf[64:128])
+        assert mtx.owner_pid() == 0
+        assert mtx.try_acquire()
+        mtx.release()
+    with PersistentSharedMemory(path) as shm:
+        assert shm.was_clean
+
+
+@pytest.mark.timeout(10)
+def test_header_validation(path, tmp_path):
+    with pytest.raises(FileNotFoundError):
+        PersistentSharedMemory(tmp_path / "missing")
+    junk = tmp_path / "junk"
+    junk.write_bytes(b"\x00" * 8192)
+    with pytest.raises(ValueError, match="not a fastipc"):
+        PersistentSharedMemory(junk)
+    PersistentSharedMemory(path, 4096).close()
+    with pytest.raises(ValueError):
+        PersistentSharedMemory(path, 8192)
+    with pytest.raises(ValueError):
+        PersistentSharedMemory(path, lock_offsets=[4090])
+    with PersistentSharedMemory(path) as shm:  # failed opens left no lease behind
+        assert shm.get_num_procs() == 1
+
+
+@pytest.mark.timeout(10)
+def test_foreign_file_is_never_reformatted(path):
+    data = b"\x00" * 8192 + b"user data" + b"\x00" * 4087
+    path.write_bytes(data)  # zero where our magic would be, but not ours
+    with pytest.raises(ValueError, match="not a fastipc"):
+        PersistentSharedMemory(path)
+    with pytest.raises(ValueError, match="not a fastipc"):
+        PersistentSharedMemory(path, 4096)
+    assert path.read_bytes() == data
+
+
+def test_create_leaves_no_temporary_files(path):
+    with PersistentSharedMemory(path, 4096) as shm:
+        assert shm.created and shm.size == 4096
+    with PersistentSharedMemory(path, 4096) as shm:
+        assert not shm.created and shm.recovered and shm.was_clean
+    assert os.listdir(path.parent) == [path.name]
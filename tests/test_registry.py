@@ -0,0 +1,136 @@
+import mmap
+import os
+import sys
+import threading
+import time
+from multiprocessing import get_context
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only futex tests", allow_module_level=True)
+
+from fastipc import NamedEvent, NamedMutex, NamedRegistry, NamedSemaphore
+from fastipc._primitives import Registry  # type: ignore
+
+
+def test_get_or_create_lookup_and_publish():
+    buf = bytearray(Registry.required_size(8))
+    r = Registry(buf, 8)
+    off, created = r.get_or_create("alpha")
+    assert created is True and off % 64 == 0
+    r.publish(off)
+    assert r.get_or_create("alpha") == (off, False)
+    assert r.lookup("alpha") == off
+    assert r.lookup("beta") == -1
+    assert r.count() == 1
+    assert Registry(buf).lookup("alpha") == off  # attach to the formatted table
+
+
+def test_unpublished_entry_times_out_for_others():
+    r = Registry(bytearray(Registry.required_size(8)), 8)
+    off, _ = r.get_or_create("slow")
+    with pytest.raises(TimeoutError):
+        r.lookup("slow", timeout_ns=1_000_000)
+    r.publish(off)
+    assert r.lookup("slow", timeout_ns=0) == off
+
+
+def test_full_and_bad_names():
+    r = Registry(bytearray(Registry.required_size(2)), 2)
+    for n in ("a", "b"):
+        r.publish(r.get_or_create(n)[0])
+    with pytest.raises(RuntimeError):
+        r.get_or_create("c")
+    with pytest.raises(ValueError):
+        r.get_or_create("x" * 49)
+    with pytest.raises(ValueError):
+        r.lookup("")
+    with pytest.raises(ValueError):
+        r.publish(3)
+
+
+@pytest.mark.timeout(10)
+def test_concurrent_create_has_single_winner():
+    r = Registry(bytearray(Registry.required_size(64)), 64)
+    results = []
+    start = threading.Barrier(8)
+
+    def worker():
+        start.wait()
+        for i in range(32):
+            off, created = r.get_or_create(f"name{i}")
+            if created:
+                time.sleep(0)
+                r.publish(off)
+            results.append((i, off, created))
+
+    ts = [threading.Thread(target=worker) for _ in range(8)]
+    for t in ts:
+        t.start()
+    for t in ts:
+        t.join()
+    assert r.count() == 32
+    for i in range(32):
+        mine = [(off, c) for j, off, c in results if j == i]
+        assert sum(c for _, c in mine) == 1
+        assert len({off for off, _ in mine}) == 1
+
+
+@pytest.mark.timeout(10)
+def test_dead_creator_hands_entry_over():
+    mm = mmap.mmap(-1, Registry.required_size(8))
+    r = Registry(memoryview(mm), 8)
+    claimed = mmap.mmap(-1, 1)
+    pid = os.fork()
+    if pid == 0:
+        Registry(memoryview(mm)).get_or_create("orphan")
+        claimed[0] = 1
+        time.sleep(0.2)
+        os._exit(0)  # dies without publishing
+    while claimed[0] == 0:
+        time.sleep(0.001)
+    reaper = threading.Thread(target=os.waitpid, args=(pid, 0))
+    reaper.start()
+    off, created = r.get_or_create("orphan")  # blocks until the creator is gone
+    reaper.join()
+    assert created is True
+    with pytest.raises(TimeoutError):
+        r.lookup("orphan", timeout_ns=1_000_000)  # we hold it now, unpublished
+    r.publish(off)
+    assert r.get_or_create("orphan") == (off, False) and r.count() == 1
+
+
+def _child_named(reg_name: str, conn_sem: str) -> None:
+    reg = NamedRegistry(reg_name)
+    sem = NamedSemaphore(conn_sem, registry=reg)
+    evt = NamedEvent("go", registry=reg)
+    mtx = NamedMutex("m", registry=reg)
+    evt.wait(timeout_ns=5_000_000_000)  # returns False if already set
+    assert evt.is_set()
+    with mtx:
+        sem.post(1)
+
+
+@pytest.mark.timeout(20)
+def test_named_primitives_share_one_segment():
+    reg_name = f"reg_{os.getpid()}_{time.time_ns()}"
+    reg = NamedRegistry(reg_name, slots=16)
+    try:
+        sem = NamedSemaphore("done", initial=0, registry=reg)
+        evt = NamedEvent("go", registry=reg)
+        NamedMutex("m", registry=reg)
+        assert len(reg) == 3 and "sema:done" in reg
+        ctx = get_context("fork")
+        ps = [ctx.Process(target=_child_named, args=(reg_name, "done")) for _ in range(3)]
+        for p in ps:
+            p.start()
+        evt.set()
+        for _ in range(3):
+            assert sem.wait(timeout=5.0)
+        for p in ps:
+            p.join(timeout=5)
+            assert p.exitcode == 0
+        assert len(reg) == 3
+    finally:
+        reg.close()
@@ -0,0 +1,228 @@
+import os
+import socket
+import sys
+import threading
+import time
+import uuid
+from multiprocessing import get_context
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only futex tests", allow_module_level=True)
+
+from fastipc import RpcChannel, RpcError
+
+
+def _name():
+    return f"t_{uuid.uuid4().hex[:8]}"
+
+
+def _echo_upper(req):
+    if bytes(req) == b"boom":
+        raise KeyError("boom")
+    return bytes(req).upper()
+
+
+def _serve(name, stop_after):
+    ch = RpcChannel(name)
+    try:
+        handled = 0
+        while handled < stop_after:
+            handled += ch.serve_batch(_echo_upper, timeout_ns=10_000_000_000)
+    finally:
+        ch.close()
+
+
+@pytest.mark.timeout(20)
+def test_call_round_trip_across_processes():
+    name = _name()
+    ch = RpcChannel(name, slots=4, slot_size=64)
+    p = get_context("fork").Process(target=_serve, args=(name, 101))
+    p.start()
+    try:
+        for i in range(100):
+            assert ch.call(b"ping %d" % i, timeout_ns=5_000_000_000) == b"PING %d" % i
+        with pytest.raises(RpcError, match="KeyError"):
+            ch.call(b"boom", timeout_ns=5_000_000_000)
+    finally:
+        p.join(10)
+        ch.close()
+    assert p.exitcode == 0
+
+
+@pytest.mark.timeout(10)
+def test_sleeping_sides_are_woken():
+    ch = RpcChannel(_name(), slots=2, slot_size=64, spin_ns=0)
+    t = threading.Thread(target=lambda: ch.serve_batch(lambda r: b"ok", timeout_ns=5_000_000_000))
+    try:
+        t.start()
+        time.sleep(0.05)  # server is asleep on the doorbell
+        assert ch.call(b"x", timeout_ns=5_000_000_000) == b"ok"
+    finally:
+        t.join(5)
+        ch.close()
+
+
+@pytest.mark.timeout(10)
+def test_serve_batch_drains_pending_requests():
+    ch = RpcChannel(_name(), slots=8, slot_size=64, spin_ns=0)
+    results = []
+    clients = [threading.Thread(target=lambda i=i: results.append(ch.call(b"%d" % i, timeout_ns=5_000_000_000))) for i in range(4)]
+    try:
+        for t in clients:
+            t.start()
+        deadline = time.monotonic() + 5
+        while sum(s.load() != 0 for s in ch._state) < 4 and time.monotonic() < deadline:
+            time.sleep(0.001)
+        assert ch.serve_batch(lambda r: bytes(r) * 2, timeout_ns=0) == 4
+    finally:
+        for t in clients:
+            t.join(5)
+        ch.close()
+    assert sorted(results) == [b"00", b"11", b"22", b"33"]
+
+
+@pytest.mark.timeout(10)
+def test_timeout_withdraws_request_and_limits():
+    ch = RpcChannel(_name(), slots=1, slot_size=16)
+    try:
+        with pytest.raises(TimeoutError):
+            ch.call(b"nobody home", timeout_ns=20_000_000, spin_ns=0)
+        assert ch.serve_batch(lambda r: b"late", timeout_ns=0) == 0  # withdrawn, not served
+        with pytest.raises(ValueError):
+            ch.call(b"x" * 17)
+        with pytest.raises(ValueError):
+            RpcChannel(_name(), slots=0)
+    finally:
+        ch.close()
+
+
+@pytest.mark.timeout(10)
+def test_slot_of_dead_client_is_reclaimed():
+    ch = RpcChannel(_name(), slots=1, slot_size=16, spin_ns=0)
+    try:
+        pid = os.fork()
+        if pid == 0:
+            ch._claim(None)  # dies holding the only slot
+            os._exit(0)
+        os.waitpid(pid, 0)
+        t = threading.Thread(target=lambda: ch.serve_batch(lambda r: b"ok", timeout_ns=5_000_000_000))
+        t.start()
+        assert ch.call(b"x", timeout_ns=5_000_000_000) == b"ok"
+        t.join(5)
+    finally:
+        ch.close()
+
+
+@pytest.mark.timeout(10)
+def test_client_of_dead_server_gets_an_error():
+    ch = RpcChannel(_name(), slots=2, slot_size=16, spin_ns=0)
+    try:
+        pid = os.fork()
+        if pid == 0:
+            ch.serve_batch(lambda r: os._exit(0), timeout_ns=5_000_000_000)
+            os._exit(1)
+        with pytest.raises(RpcError, match="died"):
+            ch.call(b"x")  # no timeout: must not hang
+        os.waitpid(pid, 0)
+        assert all(s.load() == 0 for s in ch._state)
+    finally:
+        ch.close()
+
+
+# ---- benchmarks: same-host round trips ----
+
+_ROUNDS = 2000
+_PAYLOAD = b"x" * 64
+
+
+def _pipe_server(conn):
+    while True:
+        msg = conn.recv_bytes()
+        if msg == b"":
+            break
+        conn.send_bytes(msg)
+
+
+def _socket_server(sock):
+    while True:
+        msg = sock.recv(4096)
+        if msg in (b"", b"stop"):
+            break
+        sock.sendall(msg)
+
+
+def _rpc_server(name):
+    ch = RpcChannel(name)
+    try:
+        stop = []
+
+        def handler(req):
+            if bytes(req) == b"stop":
+                stop.append(True)
+            return req
+
+        while not stop:
+            ch.serve_batch(handler)
+    finally:
+        ch.close()
+
+
+@pytest.mark.timeout(60)
+@pytest.mark.bench_heavy
+def test_rpc_channel_round_trip_benchmark(benchmark):
+    name = _name()
+    ch = RpcChannel(name)
+    p = get_context("fork").Process(target=_rpc_server, args=(name,))
+    p.start()
+    try:
+        benchmark.group = "RPC:round_trip"
+        benchmark.pedantic(lambda: [ch.call(_PAYLOAD) for _ in range(_ROUNDS)], rounds=5)
+        ch.call(b"stop")
+    finally:
+        p.join(10)
+        ch.close()
+
+
+@pytest.mark.timeout(60)
+@pytest.mark.bench_heavy
+def test_pipe_round_trip_benchmark(benchmark):
+    ctx = get_context("fork")
+    parent, child = ctx.Pipe()
+    p = ctx.Process(target=_pipe_server, args=(child,))
+    p.start()
+
+    def rounds():
+        for _ in range(_ROUNDS):
+            parent.send_bytes(_PAYLOAD)
+            parent.recv_bytes()
+
+    try:
+        benchmark.group = "RPC:round_trip"
+        benchmark.pedantic(rounds, rounds=5)
+        parent.send_bytes(b"")
+    finally:
+        p.join(10)
+
+
+@pytest.mark.timeout(60)
+@pytest.mark.bench_heavy
+def test_socketpair_round_trip_benchmark(benchmark):
+    a, b = socket.socketpair()
+    p = get_context("fork").Process(target=_socket_server, args=(b,))
+    p.start()
+
+    def rounds():
+        for _ in range(_ROUNDS):
+            a.sendall(_PAYLOAD)
+            a.recv(4096)
+
+    try:
+        benchmark.group = "RPC:round_trip"
+        benchmark.pedantic(rounds, rounds=5)
+        a.sendall(b"stop")
+    finally:
+        p.join(10)
+        a.close()
+        b.close()
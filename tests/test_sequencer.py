@@ -0,0 +1,98 @@
+import sys
+import threading
+import time
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only futex tests", allow_module_level=True)
+
+from fastipc._primitives import Sequencer  # type: ignore
+
+
+@pytest.mark.timeout(5)
+def test_sequencer_publish_and_wait():
+    s = Sequencer(memoryview(bytearray(64 + 16 * 8)), initial=0)
+    assert s.waiter_slots() == 8
+    assert s.wait_until(0) is True
+    assert s.wait_until(1, timeout_ns=1_000_000) is False
+    s.publish(5)
+    assert s.value() == 5
+    assert s.wait_until(5, timeout_ns=0) is True
+    # publish never lowers the sequence
+    s.publish(3)
+    assert s.value() == 5
+
+
+@pytest.mark.timeout(10)
+@pytest.mark.parametrize("slots", [0, 16])
+def test_sequencer_wakes_only_reached_waiters(slots: int):
+    s = Sequencer(memoryview(bytearray(64 + 16 * slots)), initial=0)
+    done = []
+    lock = threading.Lock()
+
+    def waiter(k):
+        assert s.wait_until(k, timeout_ns=5_000_000_000)
+        with lock:
+            done.append(k)
+
+    ts = [threading.Thread(target=waiter, args=(k,)) for k in range(1, 9)]
+    for t in ts:
+        t.start()
+    time.sleep(0.05)
+    s.publish(4)
+    deadline = time.monotonic() + 2.0
+    while len(done) < 4 and time.monotonic() < deadline:
+        time.sleep(0.005)
+    assert sorted(done) == [1, 2, 3, 4]
+    s.publish(8)
+    for t in ts:
+        t.join(timeout=2)
+    assert sorted(done) == list(range(1, 9))
+
+
+@pytest.mark.timeout(10)
+def test_sequencer_publish_range_ordered():
+    s = Sequencer(memoryview(bytearray(64 + 16 * 8)), initial=0)
+    order = []
+
+    def producer(first, last):
+        assert s.publish_range(first, last, timeout_ns=5_000_000_000)
+        order.append(last)
+
+    later = threading.Thread(target=producer, args=(11, 20))
+    later.start()
+    time.sleep(0.05)
+    assert s.value() == 0  # blocked behind the first batch
+    producer(1, 10)
+    later.join(timeout=2)
+    assert order == [10, 20]
+    assert s.value() == 20
+    assert s.publish_range(30, 40, timeout_ns=1_000_000) is False
+
+
+def test_sequencer_small_buffer_raises():
+    with pytest.raises(ValueError):
+        Sequencer(memoryview(bytearray(32)))
+
+
+def test_sequencer_attach_uses_stored_slot_count():
+    buf = bytearray(64 + 16 * 8)
+    Sequencer(memoryview(buf), initial=0)
+    wider = Sequencer(memoryview(buf + bytearray(64)))  # copy carries the formatted header
+    assert wider.waiter_slots() == 8
+    with pytest.raises(ValueError):
+        Sequencer(memoryview(buf)[: 64 + 16 * 4])
+
+
+@pytest.mark.timeout(10)
+def test_sequencer_overflow_waiter_sees_wraparound():
+    # No table slots: the waiter must still wake when the value moves by exactly 2**32.
+    s = Sequencer(memoryview(bytearray(64)), initial=0)
+    for k in range(1, 51):
+        target = k << 32
+        t = threading.Thread(target=lambda: s.wait_until(target, timeout_ns=5_000_000_000, spin=0))
+        t.start()
+        s.publish(target)
+        t.join(timeout=2)
+        assert not t.is_alive()
@@ -0,0 +1,234 @@
+import mmap
+import os
+import struct
+import sys
+import threading
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only shared memory tests", allow_module_level=True)
+
+from fastipc._primitives import SharedHashMap  # type: ignore
+
+
+def k(i):
+    return struct.pack("<Q", i)
+
+
+def v(i):
+    return struct.pack("<QQ", i, ~i & 0xFFFFFFFFFFFFFFFF)
+
+
+def test_put_get_update_and_attach():
+    buf = bytearray(SharedHashMap.required_size(8, 16, 64))
+    m = SharedHashMap(buf, 8, 16, 64)
+    assert m.capacity() == 64
+    assert m.get(k(1)) is None and m.get(k(1), b"?") == b"?"
+    assert m.put(k(1), v(1)) is True
+    assert m.put(k(1), v(2)) is False
+    assert m.get(k(1)) == v(2)
+    assert m.count() == 1
+    other = SharedHashMap(buf)  # attach reads sizes from the header
+    assert other.get(k(1)) == v(2)
+    with pytest.raises(ValueError):
+        m.get(b"short")
+    with pytest.raises(ValueError):
+        m.put(k(1), b"x")
+    with pytest.raises(ValueError):
+        SharedHashMap(bytearray(128))
+
+
+def test_delete_leaves_revivable_tombstone():
+    m = SharedHashMap(bytearray(SharedHashMap.required_size(8, 16, 64)), 8, 16, 64)
+    m.put(k(7), v(7))
+    assert m.delete(k(7)) is True
+    assert m.delete(k(7)) is False
+    assert m.get(k(7)) is None
+    assert m.stats()["tombstones"] == 1 and m.count() == 0
+    assert m.put(k(7), v(8)) is True
+    assert m.get(k(7)) == v(8)
+    stats = m.stats()
+    assert stats["tombstones"] == 0 and stats["count"] == 1
+    assert stats["load_factor"] == pytest.approx(1 / 64)
+
+
+def test_batched_get_and_put():
+    m = SharedHashMap(bytearray(SharedHashMap.required_size(8, 16, 256)), 8, 16, 256)
+    keys = b"".join(k(i) for i in range(100))
+    values = b"".join(v(i) for i in range(100))
+    assert m.put_many(keys, values) == 100
+    assert m.put_many(keys[:80], values[:160]) == 0  # all updates
+    probe = keys + k(1000)
+    got, found = m.get_many(probe)
+    assert found == b"\x01" * 100 + b"\x00"
+    assert got[: 100 * 16] == values and got[100 * 16 :] == bytes(16)
+    with pytest.raises(ValueError):
+        m.put_many(keys, values[:16])
+    with pytest.raises(ValueError):
+        m.get_many(keys + b"x")
+
+
+def test_full_map_raises():
+    m = SharedHashMap(bytearray(SharedHashMap.required_size(8, 16, 4)), 8, 16, 4)
+    for i in range(4):
+        m.put(k(i), v(i))
+    with pytest.raises(RuntimeError):
+        m.put(k(99), v(99))
+    with pytest.raises(RuntimeError):
+        m.put_many(k(100) + k(101), v(100) + v(101))
+    assert m.get(k(3)) == v(3)
+
+
+def test_fresh_keys_reuse_tombstones():
+    m = SharedHashMap(bytearray(SharedHashMap.required_size(8, 16, 8)), 8, 16, 8)
+    for i in range(4):
+        m.put(k(i), v(i))
+    for i in range(4, 2000):  # far more distinct keys than buckets
+        assert m.put(k(i), v(i)) is True
+        assert m.delete(k(i - 4)) is True
+    assert [m.get(k(i)) for i in range(1996, 2000)] == [v(i) for i in range(1996, 2000)]
+    assert m.get(k(0)) is None and m.count() == 4
+    assert m.stats()["count"] + m.stats()["tombstones"] <= 8
+
+
+def _dead_pid():
+    pid = os.fork()
+    if pid == 0:
+        os._exit(0)
+    os.waitpid(pid, 0)
+    return pid
+
+
+def _bucket_meta_offset(buf, key):
+    i = bytes(buf).index(key, 64)
+    return i - 8
+
+
+@pytest.mark.timeout(10)
+def test_dead_writer_does_not_wedge_the_map():
+    buf = bytearray(SharedHashMap.required_size(8, 16, 16))
+    m = SharedHashMap(buf, 8, 16, 16)
+    m.put(k(1), v(1))
+    m.put(k(2), v(2))
+    off = _bucket_meta_offset(buf, k(1))
+    meta = struct.unpack_from("<Q", buf, off)[0]
+    # k(1)'s writer died mid-update: BUSY (came from FULL), tagged with its pid.
+    busy = (_dead_pid() << 32) | ((meta >> 4) + 1 & 0x0FFFFFFF) << 4 | 2 << 2 | 1
+    struct.pack_into("<Q", buf, off, busy)
+    assert m.get(k(1)) is None  # retired as a tombstone instead of spinning forever
+    assert m.stats()["tombstones"] == 1 and m.count() == 1
+    assert m.put(k(1), v(3)) is True and m.get(k(1)) == v(3)
+    # A put that died before its duplicate scan left a second live copy further on.
+    assert m.put(k(4), v(4)) is True
+    off = next(o for o in range(64, len(buf), 32) if buf[o + 8 : o + 16] == k(4))
+    j = (off - 64) // 32
+    while struct.unpack_from("<Q", buf, 64 + j * 32)[0]:
+        j = (j + 1) % 16
+    buf[64 + j * 32 : 96 + j * 32] = buf[off : off + 32]
+    struct.pack_into("<I", buf, 24, m.count() + 1)
+    assert m.delete(k(4)) is True and m.get(k(4)) is None
+    assert m.count() == 2
+
+
+@pytest.mark.timeout(20)
+def test_concurrent_writers_and_readers_across_processes():
+    size = SharedHashMap.required_size(8, 16, 1024)
+    mm = mmap.mmap(-1, size)
+    m = SharedHashMap(mm, 8, 16, 1024)
+    for i in range(256):
+        m.put(k(i), v(i))
+
+    pids = []
+    for w in range(2):
+        pid = os.fork()
+        if pid == 0:  # child: keep rewriting values, each internally consistent
+            try:
+                child = SharedHashMap(mm)
+                for r in range(200):
+                    for i in range(w, 256, 2):
+                        child.put(k(i), v(i + r * 1000))
+            finally:
+                os._exit(0)
+        pids.append(pid)
+
+    torn = []
+    stop = threading.Event()
+
+    def reader():
+        keys = b"".join(k(i) for i in range(256))
+        while not stop.is_set():
+            got, found = m.get_many(keys)
+            if found != b"\x01" * 256:
+                torn.append("missing")
+            for j in range(256):
+                a, b = struct.unpack_from("<QQ", got, j * 16)
+                if b != ~a & 0xFFFFFFFFFFFFFFFF or a % 1000 != j:
+                    torn.append((j, a, b))
+
+    ts = [threading.Thread(target=reader) for _ in range(2)]
+    for t in ts:
+        t.start()
+    for pid in pids:
+        _, status = os.waitpid(pid, 0)
+        assert os.waitstatus_to_exitcode(status) == 0
+    stop.set()
+    for t in ts:
+        t.join()
+    assert torn == []
+    assert m.count() == 256
+
+
+@pytest.mark.timeout(20)
+def test_churn_of_fresh_keys_across_processes():
+    size = SharedHashMap.required_size(8, 16, 32)
+    mm = mmap.mmap(-1, size)
+    m = SharedHashMap(mm, 8, 16, 32)
+    pids = []
+    for w in range(3):
+        pid = os.fork()
+        if pid == 0:
+            code = 1
+            try:
+                child = SharedHashMap(mm)
+                base = (w + 1) << 32
+                for i in range(3000):
+                    child.put(k(base + i), v(base + i))
+                    if i >= 4 and not child.delete(k(base + i - 4)):
+                        raise AssertionError("lost key")
+                code = 0
+            finally:
+                os._exit(code)
+        pids.append(pid)
+    for pid in pids:
+        _, status = os.waitpid(pid, 0)
+        assert os.waitstatus_to_exitcode(status) == 0
+    assert m.count() == 12
+    for w in range(3):
+        base = (w + 1) << 32
+        assert [m.get(k(base + i)) for i in range(2996, 3000)] == [v(base + i) for i in range(2996, 3000)]
+
+
+@pytest.mark.timeout(30)
+def test_racing_puts_of_the_same_fresh_keys_keep_one_copy():
+    n, capacity = 2048, 4096
+    mm = mmap.mmap(-1, SharedHashMap.required_size(8, 16, capacity))
+    m = SharedHashMap(mm, 8, 16, capacity)
+    pids = []
+    for _ in range(3):
+        pid = os.fork()
+        if pid == 0:
+            try:
+                child = SharedHashMap(mm)
+                for i in range(n):
+                    child.put(k(i), v(i))
+            finally:
+                os._exit(0)
+        pids.append(pid)
+    for pid in pids:
+        _, status = os.waitpid(pid, 0)
+        assert os.waitstatus_to_exitcode(status) == 0
+    data = bytes(mm)
+    live = [data[o + 8 : o + 16] for o in range(64, len(data), 32) if data[o] & 3 == 2]
+    assert sorted(live) == sorted(k(i) for i in range(n))
+    assert m.count() == n
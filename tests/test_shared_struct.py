@@ -0,0 +1,183 @@
+import mmap
+import os
+import sys
+import threading
+import time
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only futex tests", allow_module_level=True)
+
+from fastipc._primitives import Mutex, Semaphore, SharedStruct, StructLayout  # type: ignore
+
+FIELDS = [
+    ("flags", "u8"),
+    ("ratio", "f64"),
+    ("epoch", "i32"),
+    ("ready", "futex"),
+    ("hits", "atomic_u64"),
+    ("lanes", "atomic_u32", 4),
+    ("history", "u16", 8),
+    ("lock", "mutex"),
+    ("slots", "semaphore"),
+]
+
+
+def test_layout_places_fields_by_cache_line():
+    layout = StructLayout(FIELDS)
+    offs = {name: off for name, _, _, off in layout.fields()}
+    assert layout.size() % 64 == 0
+    assert offs["lock"] == 64 and offs["slots"] == 128
+    for name in ("ready", "hits", "lanes"):
+        assert offs[name] % 64 == 0
+    assert len({offs[n] // 64 for n in ("ready", "hits", "lanes")}) == 3
+    # plain fields share one line, widest first
+    assert offs["ratio"] % 64 == 0 and offs["epoch"] == offs["ratio"] + 8
+    assert offs["history"] == offs["epoch"] + 4 and offs["flags"] == offs["history"] + 16
+    assert layout.offset("hits") == offs["hits"]
+    assert layout.hash() == StructLayout(FIELDS).hash()
+    assert layout.hash() != StructLayout(FIELDS + [("extra", "u8")]).hash()
+
+
+@pytest.mark.parametrize(
+    "fields",
+    [
+        [],
+        [("x", "u128")],
+        [("x", "u8", 0)],
+        [("x", "u8"), ("x", "u16")],
+        [("_x", "u8")],
+        [("load", "u8")],
+        [("not an identifier", "u8")],
+    ],
+)
+def test_layout_rejects_bad_declarations(fields):
+    with pytest.raises(ValueError):
+        StructLayout(fields)
+
+
+def test_attribute_access_and_batches():
+    layout = StructLayout(FIELDS)
+    mm = mmap.mmap(-1, layout.size())
+    s = SharedStruct(memoryview(mm), layout)
+    assert (s.flags, s.ratio, s.hits, s.lanes) == (0, 0.0, 0, (0, 0, 0, 0))
+    s.flags = 255
+    s.ratio = 0.25
+    s.epoch = -7
+    assert (s.flags, s.ratio, s.epoch) == (255, 0.25, -7)
+    with pytest.raises(OverflowError):
+        s.flags = 256
+    with pytest.raises(OverflowError):
+        s.epoch = 1 << 31
+
+    s.history[3] = 513
+    assert s.load("history", 3) == 513 and list(s.history)[:4] == [0, 0, 0, 513]
+    s.store("lanes", 9, 2)
+    assert s.lanes == (0, 0, 9, 0)
+    with pytest.raises(IndexError):
+        s.load("lanes", 4)
+    with pytest.raises(AttributeError):
+        s.lanes = 1
+    with pytest.raises(AttributeError):
+        s.missing
+
+    assert s.fetch_add("hits", 5) == 0 and s.fetch_add("hits", -2) == 5 and s.hits == 3
+    assert s.cas("ready", 0, 1) and not s.cas("ready", 0, 2)
+    with pytest.raises(TypeError):
+        s.fetch_add("epoch", 1)
+
+    s.store_fields({"epoch": 11}, ratio=1.5, hits=40)
+    assert s.load_fields(["epoch", "ratio", "hits", "flags"]) == (11, 1.5, 40, 255)
+    with pytest.raises(TypeError):
+        s.load_fields(["history"])
+
+    assert isinstance(s.lock, Mutex) and isinstance(s.slots, Semaphore)
+    with s.lock:
+        assert s.lock.owner_pid() == os.getpid()
+    s.slots.post(2)
+    assert s.slots.wait(blocking=False) and s.slots.value() == 1
+    assert s.layout is layout
+    s.history.release()
+    del s
+
+
+def test_attach_checks_layout_hash():
+    layout = StructLayout(FIELDS)
+    mm = mmap.mmap(-1, layout.size() + 64)
+    a = SharedStruct(memoryview(mm), layout)
+    a.epoch = 42
+    b = SharedStruct(memoryview(mm), StructLayout(list(FIELDS)))
+    assert b.epoch == 42
+    with pytest.raises(ValueError, match="layout"):
+        SharedStruct(memoryview(mm), StructLayout(FIELDS[:-1]))
+    junk = mmap.mmap(-1, layout.size())
+    junk[:24] = b"\xff" * 20 + (2).to_bytes(4, "little")  # marked ready, but not ours
+    with pytest.raises(ValueError, match="does not hold"):
+        SharedStruct(memoryview(junk), layout)
+    with pytest.raises(ValueError):
+        SharedStruct(memoryview(mm)[8:], layout)  # misaligned
+    with pytest.raises(ValueError):
+        SharedStruct(bytearray(32), layout)
+
+
+@pytest.mark.timeout(10)
+def test_attacher_takes_over_from_dead_formatter():
+    layout = StructLayout(FIELDS)
+    mm = mmap.mmap(-1, layout.size())
+    pid = os.fork()
+    if pid == 0:
+        os._exit(0)
+    os.waitpid(pid, 0)
+    mm[20:24] = ((pid << 2) | 1).to_bytes(4, "little")  # died while formatting
+    mm[64:72] = b"\xff" * 8  # half-written fields
+    s = SharedStruct(memoryview(mm), layout)
+    assert s.hits == 0 and s.ratio == 0.0
+    with s.lock:
+        assert s.lock.owner_pid() == os.getpid()
+    assert SharedStruct(memoryview(mm), layout).layout is layout
+
+
+@pytest.mark.timeout(10)
+def test_futex_field_wait_and_wake_across_fork():
+    layout = StructLayout(FIELDS)
+    mm = mmap.mmap(-1, layout.size())
+    s = SharedStruct(memoryview(mm), layout)
+    pid = os.fork()
+    if pid == 0:
+        code = 1
+        try:
+            child = SharedStruct(memoryview(mm), layout)
+            while child.ready == 0:
+                child.wait("ready", 0, 1_000_000_000)
+            child.fetch_add("hits", child.ready)
+            code = 0
+        finally:
+            os._exit(code)
+    time.sleep(0.05)
+    s.ready = 7
+    s.wake("ready", 1)
+    _, status = os.waitpid(pid, 0)
+    assert os.waitstatus_to_exitcode(status) == 0
+    assert s.hits == 7
+    assert s.wait("ready", 0, 1_000) is False  # value already differs
+
+
+@pytest.mark.timeout(10)
+def test_threads_counting_through_atomic_field():
+    layout = StructLayout([("count", "atomic_u64"), ("lock", "mutex"), ("plain", "u64")])
+    mm = mmap.mmap(-1, layout.size())
+    s = SharedStruct(memoryview(mm), layout, shared=False)
+
+    def work():
+        for _ in range(2000):
+            s.fetch_add("count", 1)
+            with s.lock:
+                s.plain = s.plain + 1
+
+    threads = [threading.Thread(target=work) for _ in range(4)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert s.count == 8000 and s.plain == 8000
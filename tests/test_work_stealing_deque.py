@@ -0,0 +1,138 @@
+import mmap
+import os
+import struct
+import sys
+import threading
+import time
+
+import pytest
+
+if sys.platform != "linux":
+    pytest.skip("Linux-only shared memory tests", allow_module_level=True)
+
+from fastipc._primitives import WorkStealingDeque  # type: ignore
+
+_ITEM = struct.Struct("<Q")
+
+
+def _ids(items):
+    return [_ITEM.unpack(x)[0] for x in items]
+
+
+def test_owner_lifo_thief_fifo():
+    mm = mmap.mmap(-1, WorkStealingDeque.required_size(8))
+    dq = WorkStealingDeque(memoryview(mm), capacity=8)
+    assert dq.pop() is None and dq.steal() is None
+    for i in range(8):
+        assert dq.push(_ITEM.pack(i))
+    assert not dq.push(_ITEM.pack(8))  # full
+    assert dq.size() == 8 and dq.capacity() == 8 and dq.item_size() == 8
+    assert _ids([dq.pop()]) == [7]
+    assert _ids([dq.steal()]) == [0]
+    assert _ids(dq.steal_half()) == [1, 2, 3]
+    assert _ids(dq.steal_half(max_items=1)) == [4]
+    assert _ids([dq.pop(), dq.pop()]) == [6, 5] and dq.pop() is None
+    assert dq.size() == 0
+    # the ring wraps around
+    for i in range(100):
+        assert dq.push(_ITEM.pack(i))
+        assert _ids([dq.steal() if i % 2 else dq.pop()]) == [i]
+
+
+def test_attach_and_validation():
+    size = WorkStealingDeque.required_size(4, 24)
+    mm = mmap.mmap(-1, size)
+    with pytest.raises(ValueError):
+        WorkStealingDeque(memoryview(mm))  # nothing formatted yet
+    owner = WorkStealingDeque(memoryview(mm), capacity=4, item_size=24)
+    thief = WorkStealingDeque(memoryview(mm))
+    assert thief.capacity() == 4 and thief.item_size() == 24
+    owner.push(b"a" * 24)
+    assert thief.steal() == b"a" * 24
+    with pytest.raises(ValueError):
+        owner.push(b"short")
+    with pytest.raises(ValueError):
+        WorkStealingDeque(memoryview(mmap.mmap(-1, size)), capacity=6)
+    with pytest.raises(ValueError):
+        WorkStealingDeque(memoryview(mmap.mmap(-1, 256)), capacity=64)
+    with pytest.raises(ValueError):
+        thief.prepare_park()  # no idle word
+
+
+def _thief(mm, taken, slot, stop):
+    dq = WorkStealingDeque(memoryview(mm))
+    mine = memoryview(taken)[slot::3]
+    while True:
+        got = dq.steal_half(4) if slot % 2 else [dq.steal()]
+        got = [g for g in got if g is not None]
+        for i in _ids(got):
+            mine[i] = 1
+        if not got and stop[0]:
+            break
+
+
+@pytest.mark.timeout(30)
+def test_every_item_taken_once_across_processes():
+    n = 20000
+    mm = mmap.mmap(-1, WorkStealingDeque.required_size(256))
+    taken = mmap.mmap(-1, 3 * n)
+    stop = mmap.mmap(-1, 1)
+    dq = WorkStealingDeque(memoryview(mm), capacity=256)
+    pids = []
+    for slot in (1, 2):
+        pid = os.fork()
+        if pid == 0:
+            code = 1
+            try:
+                _thief(mm, taken, slot, stop)
+                code = 0
+            finally:
+                os._exit(code)
+        pids.append(pid)
+
+    mine = memoryview(taken)[0::3]
+    i = 0
+    while i < n:
+        if dq.push(_ITEM.pack(i)):
+            i += 1
+        if i % 3 == 0:
+            item = dq.pop()
+            if item is not None:
+                mine[_ITEM.unpack(item)[0]] = 1
+    while True:
+        item = dq.pop()
+        if item is None:
+            break
+        mine[_ITEM.unpack(item)[0]] = 1
+    stop[0] = 1
+    for pid in pids:
+        _, status = os.waitpid(pid, 0)
+        assert os.waitstatus_to_exitcode(status) == 0
+    counts = [taken[3 * k] + taken[3 * k + 1] + taken[3 * k + 2] for k in range(n)]
+    assert counts == [1] * n
+
+
+@pytest.mark.timeout(10)
+def test_thief_parks_until_push():
+    idle = bytearray(4)
+    mm = mmap.mmap(-1, WorkStealingDeque.required_size(8))
+    owner = WorkStealingDeque(memoryview(mm), capacity=8, idle=idle)
+    thief = WorkStealingDeque(memoryview(mm), idle=idle)
+    got = []
+
+    def run():
+        while not got:
+            token = thief.prepare_park()
+            item = thief.steal()
+            if item is not None:
+                got.append(item)
+            elif not thief.park(token, 5_000_000_000):
+                break
+
+    t = threading.Thread(target=run)
+    t.start()
+    time.sleep(0.05)
+    assert owner.push(_ITEM.pack(42))
+    t.join(5)
+    assert _ids(got) == [42]
+    assert not thief.park(thief.prepare_park(), 1_000)  # nothing pushed: times out